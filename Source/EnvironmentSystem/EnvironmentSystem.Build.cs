@@ -7,8 +7,8 @@ public class EnvironmentSystem : ModuleRules
 	public EnvironmentSystem(ReadOnlyTargetRules Target) : base(Target)
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
-		PublicDependencyModuleNames.AddRange([ "Core", "CoreUObject", "PhysicsCore", "Engine", "Landscape", "InputCore", "EnhancedInput", "NiagaraCore", "Niagara" ]);
-		PrivateDependencyModuleNames.AddRange([ "DeveloperSettings" ]);
+		PublicDependencyModuleNames.AddRange([ "Core", "CoreUObject", "PhysicsCore", "Engine", "Landscape", "InputCore", "EnhancedInput", "NiagaraCore", "Niagara", "MassEntity", "MassCommon", "MassSpawner" ]);
+		PrivateDependencyModuleNames.AddRange([ "DeveloperSettings", "AssetRegistry", "Json", "Projects", "RHI" ]);
 		CppStandard = CppStandardVersion.Latest;
 	}
 }
@@ -3,10 +3,14 @@
 
 #include "AnimNotify_SpawnFootEffects.h"
 
+#include "EnvironmentSystemStats.h"
 #include "LandscapeProxy.h"
 #include "NiagaraFunctionLibrary.h"
+#include "PrecipitationOcclusionSubsystem.h"
+#include "WeatherAccumulationSubsystem.h"
+#include "WeatherEffectDensitySubsystem.h"
 #include "Logging/StructuredLog.h"
-#include "Materials/MaterialParameterCollectionInstance.h"
+#include "Misc/App.h"
 
 UAnimNotify_SpawnFootEffects::UAnimNotify_SpawnFootEffects()
 {
@@ -15,6 +19,12 @@ UAnimNotify_SpawnFootEffects::UAnimNotify_SpawnFootEffects()
 #endif
 }
 
+bool UAnimNotify_SpawnFootEffects::IsSheltered(UWorld const* World, FVector const& Location)
+{
+	UPrecipitationOcclusionSubsystem const* Occlusion = World->GetSubsystem<UPrecipitationOcclusionSubsystem>();
+	return Occlusion && Occlusion->IsPointSheltered(Location);
+}
+
 FString UAnimNotify_SpawnFootEffects::GetNotifyName_Implementation() const
 {
 	return "Spawn Footprints";
@@ -23,31 +33,27 @@ FString UAnimNotify_SpawnFootEffects::GetNotifyName_Implementation() const
 void UAnimNotify_SpawnFootEffects::Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation,
 	const FAnimNotifyEventReference& EventReference)
 {
-	WeatherMaterialParameterCollectionInstance = MeshComp->GetWorld()->GetParameterCollectionInstance(WeatherMaterialParameterCollection);
-	if(not WeatherMaterialParameterCollectionInstance)
-	{
-		UE_LOG(LogTemp, Error, TEXT("Could not find weather material parameters collection in the world"));
-		return;
-	}
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(FootEffectsNotify);
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Footprints);
 
-	// Check if snow has accumulated
-	float SnowStrength;
-	if(not WeatherMaterialParameterCollectionInstance->GetScalarParameterValue(SnowStrengthParameterName, SnowStrength))
+	// Nobody sees footprints or splashes on a dedicated server
+	if(MeshComp->GetWorld()->IsNetMode(NM_DedicatedServer) || not FApp::CanEverRender())
 	{
-		UE_LOG(LogTemp, Error, TEXT("Could not fetch value of SnowStrength"));
 		return;
 	}
 
-	// Check if it is raining or has rained recently
-	float ShowPuddles;
-	if(not WeatherMaterialParameterCollectionInstance->GetScalarParameterValue(ShowPuddlesParameterName, ShowPuddles))
+	ENVIRONMENT_INC_COUNTER(Footsteps, 1);
+
+	UWeatherAccumulationSubsystem const* Accumulation = MeshComp->GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>();
+	if(not Accumulation)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Could not fetch value of SnowStrength"));
 		return;
 	}
 
-	bool bIsSnowing = SnowStrength >= SpawnSnowFootprintsThreshold; 
-	bool bIsRaining = ShowPuddles >= SpawnSnowFootprintsThreshold; 
+	// Check if snow has accumulated, or if it is raining or has rained recently
+	FVector const Location = MeshComp->GetComponentLocation();
+	bool bIsSnowing = Accumulation->GetChannelValueAt(SnowChannelName, Location) >= SpawnSnowFootprintsThreshold; 
+	bool bIsRaining = Accumulation->GetChannelValueAt(PuddlesChannelName, Location) >= SpawnSnowFootprintsThreshold; 
 	
 	if(not bIsSnowing && not bIsRaining)
 	{
@@ -69,6 +75,7 @@ void UAnimNotify_SpawnFootEffects::Notify(USkeletalMeshComponent* MeshComp, UAni
 		TraceEnd,
 		ObjectQueryParams,
 		CollisionQueryParams);
+	ENVIRONMENT_INC_COUNTER(Traces, 1);
 
 	// If hit landscape, should be replaced by physical material
 	if(bHit && Cast<ALandscapeProxy>(HitResult.HitObjectHandle.FetchActor()))
@@ -78,13 +85,19 @@ void UAnimNotify_SpawnFootEffects::Notify(USkeletalMeshComponent* MeshComp, UAni
 			if(UNiagaraSystem* System = (CurrentLandingFoot == EFootType::LeftFoot ? LeftFootDecalSpawner : RightFootDecalSpawner))
 			{
 				UNiagaraFunctionLibrary::SpawnSystemAtLocation(MeshComp->GetWorld(), System, HitResult.Location, MeshComp->GetOwner()->GetActorRotation());
+				ENVIRONMENT_INC_COUNTER(NiagaraSpawns, 1);
 			}	
 		}
-		else
+		else if(not IsSheltered(MeshComp->GetWorld(), HitResult.Location))
 		{
-			if(RainSplashMaterial && HitResult.PhysMaterial.IsValid() && HitResult.PhysMaterial == RainSplashMaterial && RainSplashSpawner)
+			// Splashes are thinned out along with the weather effects
+			UWeatherEffectDensitySubsystem const* Density = MeshComp->GetWorld()->GetSubsystem<UWeatherEffectDensitySubsystem>();
+			bool const bWithinDensity = not Density || FMath::FRand() < Density->GetDensity();
+
+			if(RainSplashMaterial && HitResult.PhysMaterial.IsValid() && HitResult.PhysMaterial == RainSplashMaterial && RainSplashSpawner && bWithinDensity)
 			{
 				UNiagaraFunctionLibrary::SpawnSystemAtLocation(MeshComp->GetWorld(), RainSplashSpawner, HitResult.Location, MeshComp->GetOwner()->GetActorRotation());
+				ENVIRONMENT_INC_COUNTER(NiagaraSpawns, 1);
 			}
 		}
 	}
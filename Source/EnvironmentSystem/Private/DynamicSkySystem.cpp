@@ -2,9 +2,21 @@
 
 #include "DynamicSkySystem.h"
 
+#include "EnvironmentSubsystem.h"
+#include "EnvironmentSystemStats.h"
+#include "EnvironmentViewSubsystem.h"
+#include "LensRainComponent.h"
+#include "LightningComponent.h"
 #include "NiagaraComponent.h"
 #include "NiagaraSystem.h"
+#include "PrecipitationOcclusionSubsystem.h"
+#include "SolarEventSubsystem.h"
+#include "WeatherAccumulationSubsystem.h"
+#include "WeatherAmbienceComponent.h"
 #include "WeatherDataAssetBase.h"
+#include "WeatherEffectDensitySubsystem.h"
+#include "WeatherExposureSubsystem.h"
+#include "WindSubsystem.h"
 #include "Components/DirectionalLightComponent.h"
 #include "Components/SkyAtmosphereComponent.h"
 #include "Components/SkyLightComponent.h"
@@ -12,19 +24,51 @@
 #include "Components/PostProcessComponent.h"
 #include "Components/TimelineComponent.h"
 #include "Components/VolumetricCloudComponent.h"
-#include "Kismet/KismetMaterialLibrary.h"
-#include "Kismet/KismetMathLibrary.h"
 #include "Logging/StructuredLog.h"
+#include "Materials/MaterialInstanceDynamic.h"
 #include "Materials/MaterialParameterCollectionInstance.h"
 #include "HAL/Platform.h"
+#include "Misc/App.h"
+#include "CoreGlobals.h"
+
+void FDynamicSkyApplyFrameStateTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if(Target && IsValid(Target))
+	{
+		Target->ApplyPendingFrameState();
+	}
+}
+
+FString FDynamicSkyApplyFrameStateTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[ApplyFrameState]") : TEXT("<NULL>[ApplyFrameState]");
+}
+
+FName FDynamicSkyApplyFrameStateTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("DynamicSkyApplyFrameState"));
+}
 
 ADynamicSkySystem::ADynamicSkySystem()
 {
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Sky);
+
 	PrimaryActorTick.bCanEverTick = true;
 
+	ApplyFrameStateTick.bCanEverTick = true;
+	ApplyFrameStateTick.bStartWithTickEnabled = true;
+	ApplyFrameStateTick.TickGroup = TG_PostPhysics;
+
     Root = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
 	SetRootComponent(Root);
 
+	WeatherTransitionAnimationComponent = CreateDefaultSubobject<UTimelineComponent>(TEXT("WeatherTransitionTimeline"));
+	WeatherTransitionAnimationComponent->SetPlayRate(.1f); // 10s, hard coded for now
+
+	Lightning = CreateDefaultSubobject<ULightningComponent>(TEXT("Lightning"));
+
+	// The visual components exist in every process, so Blueprints and saved levels have the same layout on servers and
+	// clients. Dedicated servers leave them unregistered, see PreRegisterAllComponents.
 	SkySphere = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Sky Sphere"));
 	SkySphere->SetupAttachment(Root);
 	SkySphere->SetWorldScale3D(FVector(SkySphereScale));
@@ -62,12 +106,12 @@ ADynamicSkySystem::ADynamicSkySystem()
 	PostProcessComponent->Settings.AutoExposureMaxBrightness = .5f;
 	PostProcessComponent->Settings.bOverride_AutoExposureMaxBrightness = true;
 
+	LensRain = CreateDefaultSubobject<ULensRainComponent>(TEXT("LensRain"));
+	Ambience = CreateDefaultSubobject<UWeatherAmbienceComponent>(TEXT("Ambience"));
+
 	// WeatherEffectsComponent = CreateDefaultSubobject<UNiagaraComponent>(TEXT("NiagaraComponent"));
 	// WeatherEffectsComponent->SetupAttachment(Root);
 	// WeatherEffectsComponent->SetAutoActivate(false);
-	
-	WeatherTransitionAnimationComponent = CreateDefaultSubobject<UTimelineComponent>(TEXT("WeatherTransitionTimeline"));
-	WeatherTransitionAnimationComponent->SetPlayRate(.1f); // 10s, hard coded for now
 }
 
 void ADynamicSkySystem::StartWeatherAndAnimateTransition()
@@ -76,29 +120,224 @@ void ADynamicSkySystem::StartWeatherAndAnimateTransition()
 	ToggleWeatherEffects(true);
 }
 
+float ADynamicSkySystem::GetWeatherTransitionProgress() const
+{
+	float const Length = WeatherTransitionAnimationComponent->GetTimelineLength();
+	return Length > 0.f ? WeatherTransitionAnimationComponent->GetPlaybackPosition() / Length : 0.f;
+}
+
+void ADynamicSkySystem::SetWeatherTransitionProgress(float const Progress)
+{
+	WeatherTransitionAnimationComponent->Stop();
+	WeatherTransitionAnimationComponent->SetPlaybackPosition(FMath::Clamp(Progress, 0.f, 1.f) * WeatherTransitionAnimationComponent->GetTimelineLength(), true);
+}
+
 void ADynamicSkySystem::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// A lightning flash is applied on top of the frame state
+	if(Lightning && ApplyFrameStateTick.IsTickFunctionRegistered())
+	{
+		Lightning->PrimaryComponentTick.AddPrerequisite(this, ApplyFrameStateTick);
+	}
+
+	UEnvironmentSubsystem* Environment = GetWorld()->GetSubsystem<UEnvironmentSubsystem>();
+
+	// Another sky already drives the environment, this one stands by until it leaves
+	if(Environment && not Environment->RegisterSky(this))
+	{
+		return;
+	}
+
+	// A save loaded before play replaces the initial setup and weather transition
+	if(Environment && Environment->RestorePendingSnapshot())
+	{
+		return;
+	}
+
+	StartEnvironment();
+}
+
+void ADynamicSkySystem::StartEnvironment()
+{
 	InitSubsystems();
+	UpdateWeatherZoneBlend();
 
 	// TODO: Stubs to test weather change blending
-	if(CurrentWeatherPreset->WeatherType == EWeatherTypes::Snowy || CurrentWeatherPreset->WeatherType == EWeatherTypes::Rainy)
+	UWeatherDataAssetBase const* Preset = GetActiveWeatherPreset();
+	if(Preset && Preset->HasWeatherEffects())
 	{
 		StartWeatherAndAnimateTransition();
 	}
 }
 
+void ADynamicSkySystem::RestoreEnvironment(UWeatherDataAssetBase* Preset, float const NewTimeOfDay, float const TransitionProgress)
+{
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(RestoreEnvironment);
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Sky);
+
+	TimeOfDay = FMath::Clamp(NewTimeOfDay, 0.f, Midnight);
+	if(Preset)
+	{
+		CurrentWeatherPreset = Preset;
+	}
+	SampleWeatherZones();
+
+	if(not SkySphereMaterialInstance)
+	{
+		InitSkySphere();
+	}
+
+	UWeatherDataAssetBase const* ActivePreset = GetActiveWeatherPreset();
+	if(ActivePreset)
+	{
+		ENVIRONMENT_TRACE_EVENT(TEXT("Weather restored to %s"), *ActivePreset->GetName());
+		SetWeatherEffects();
+		ApplyWeatherToSubsystems();
+		BindWeatherTransitionCurve();
+	}
+
+	// Jumps to the saved state of the transition instead of playing it from the start, a save taken during the
+	// transition plays the rest of it
+	SetWeatherTransitionProgress(TransitionProgress);
+	if(TransitionProgress < 1.f)
+	{
+		WeatherTransitionAnimationComponent->Play();
+	}
+	ToggleWeatherEffects(ActivePreset && ActivePreset->HasWeatherEffects());
+
+	// Clouds, lights and sun from a single frame state, the cloud parameters are written once by ApplyFrameState
+	if(ShouldUpdateVisuals())
+	{
+		ToggleCloudMode();
+		ApplyFrameState(ComputeFrameState());
+	}
+}
+
+void ADynamicSkySystem::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(FrameStateTask.IsValid())
+	{
+		FrameStateTask.Wait();
+		FrameStateTask = {};
+	}
+
+	if(UEnvironmentSubsystem* Environment = GetWorld()->GetSubsystem<UEnvironmentSubsystem>())
+	{
+		Environment->UnregisterSky(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ADynamicSkySystem::SetIsActiveSky(bool const bActive)
+{
+	if(bIsActiveSky == bActive)
+	{
+		return;
+	}
+
+	bIsActiveSky = bActive;
+
+	SetActorTickEnabled(bActive);
+	if(ApplyFrameStateTick.IsTickFunctionRegistered())
+	{
+		ApplyFrameStateTick.SetTickFunctionEnable(bActive);
+	}
+
+	// A sky standing by is hidden, taking over shows it again unless it was hidden before
+	if(bActive)
+	{
+		SetActorHiddenInGame(bWasHiddenBeforeStandby);
+	}
+	else
+	{
+		bWasHiddenBeforeStandby = IsHidden();
+		SetActorHiddenInGame(true);
+	}
+
+	if(PostProcessComponent)
+	{
+		PostProcessComponent->bEnabled = bActive;
+	}
+
+	if(Lightning)
+	{
+		Lightning->SetComponentTickEnabled(bActive);
+	}
+
+	if(LensRain)
+	{
+		LensRain->SetComponentTickEnabled(bActive);
+	}
+
+	if(not bActive)
+	{
+		WeatherTransitionAnimationComponent->Stop();
+		ToggleWeatherEffects(false);
+		if(LensRain)
+		{
+			LensRain->ClearViews();
+		}
+		if(Ambience)
+		{
+			Ambience->SetWeatherPreset(nullptr);
+		}
+		return;
+	}
+
+	// Takes over the environment as if it had just begun play
+	UEnvironmentSubsystem* Environment = GetWorld()->GetSubsystem<UEnvironmentSubsystem>();
+	if(not Environment || not Environment->RestorePendingSnapshot())
+	{
+		StartEnvironment();
+	}
+}
+
+void ADynamicSkySystem::RegisterActorTickFunctions(bool bRegister)
+{
+	Super::RegisterActorTickFunctions(bRegister);
+
+	if(bRegister)
+	{
+		if(PrimaryActorTick.IsTickFunctionRegistered() && ShouldUpdateVisuals())
+		{
+			ApplyFrameStateTick.Target = this;
+			ApplyFrameStateTick.SetTickFunctionEnable(true);
+			ApplyFrameStateTick.RegisterTickFunction(GetLevel());
+			ApplyFrameStateTick.AddPrerequisite(this, PrimaryActorTick);
+		}
+	}
+	else if(ApplyFrameStateTick.IsTickFunctionRegistered())
+	{
+		ApplyFrameStateTick.UnRegisterTickFunction();
+	}
+}
+
 void ADynamicSkySystem::InitSubsystems()
 {
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(InitSubsystems);
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Sky);
+
 	InitSkySphere();
 	HandleWeatherSettings();
 	HandleCloudMode();
 	HandleSunAndMoonRotation();
 }
 
+bool ADynamicSkySystem::ShouldUpdateVisuals() const
+{
+	return SkySphere != nullptr && FApp::CanEverRender() && not IsNetMode(NM_DedicatedServer);
+}
+
 void ADynamicSkySystem::InitSkySphere()
 {
+	if(not ShouldUpdateVisuals())
+	{
+		return;
+	}
+
 	UMaterialInterface* Material = SkySphere->GetMaterial(0);
 	if(not Material)
 	{
@@ -118,43 +357,58 @@ void ADynamicSkySystem::OnConstruction(const FTransform& Transform)
 	InitSubsystems();
 }
 
-void ADynamicSkySystem::HandleSunAndMoonRotation()
+void ADynamicSkySystem::PreRegisterAllComponents()
 {
-	// Sun rotation between dawn and dusk
-	double const SunAngle = UKismetMathLibrary::MapRangeUnclamped(TimeOfDay, DawnTime, DuskTime, static_cast<double>(ESunPositions::SunRise), static_cast<double>(ESunPositions::SunSet));
-	SunDirectionalLight->SetWorldRotation(FRotator::MakeFromEuler(FVector{ 0, SunAngle, SunMoonRotationYaw }));
+	Super::PreRegisterAllComponents();
 
-	// Moon rotation after dusk
-	if(TimeOfDay > GetTrueDuskTime())
+	// Dedicated servers only keep the time and weather logic
+	if(not IsNetMode(NM_DedicatedServer))
 	{
-		double const MoonAnglePreMidnight = UKismetMathLibrary::MapRangeUnclamped(TimeOfDay, GetTrueDuskTime(), 24.f, static_cast<double>(EMoonPositions::MoonRise), static_cast<double>(EMoonPositions::Midnight));
-		MoonDirectionalLight->SetWorldRotation(FRotator::MakeFromEuler(FVector{ 0, MoonAnglePreMidnight, SunMoonRotationYaw }));	
+		return;
 	}
 
-	// Moon rotation before dawn
-	if(TimeOfDay < GetTrueDawnTime())
+	UActorComponent* const VisualComponents[] = {
+		SkySphere, SunDirectionalLight, MoonDirectionalLight, SkyAtmosphere, SkyLight, Fog, VolumetricClouds,
+		PostProcessComponent, LensRain, Ambience
+	};
+	for(UActorComponent* Component : VisualComponents)
 	{
-		double const MoonAnglePostMidnight = UKismetMathLibrary::MapRangeUnclamped(TimeOfDay, 0, GetTrueDawnTime(), static_cast<double>(EMoonPositions::Midnight), static_cast<double>(EMoonPositions::MoonSet));
-		MoonDirectionalLight->SetWorldRotation(FRotator::MakeFromEuler(FVector{ 0, MoonAnglePostMidnight, SunMoonRotationYaw }));	
+		if(Component)
+		{
+			Component->bAutoRegister = false;
+		}
 	}
-	
-	HandleVisibility();
 }
 
-void ADynamicSkySystem::HandleVisibility() const
+void ADynamicSkySystem::HandleSunAndMoonRotation()
 {
-	SunDirectionalLight->SetVisibility(IsDaytime());
-	MoonDirectionalLight->SetVisibility(not IsDaytime());
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(HandleSunAndMoonRotation);
+
+	if(not ShouldUpdateVisuals())
+	{
+		return;
+	}
+
+	bHasAppliedFrameState = false;
+	ApplySunAndMoonRotation(ComputeFrameState());
 }
 
-float ADynamicSkySystem::GetTrueDawnTime() const
+void ADynamicSkySystem::ApplySunAndMoonRotation(FEnvironmentFrameState const& State) const
 {
-	return DawnTime - DawnTimeOffset;
+	SunDirectionalLight->SetWorldRotation(State.SunRotation);
+
+	if(State.bUpdateMoonRotation)
+	{
+		MoonDirectionalLight->SetWorldRotation(State.MoonRotation);
+	}
+	
+	HandleVisibility(State.bIsDaytime);
 }
 
-float ADynamicSkySystem::GetTrueDuskTime() const
+void ADynamicSkySystem::HandleVisibility(bool const bIsDaytime) const
 {
-	return DuskTime + DuskTimeOffset;
+	SunDirectionalLight->SetVisibility(bIsDaytime);
+	MoonDirectionalLight->SetVisibility(not bIsDaytime);
 }
 
 // TODO: Generalize
@@ -174,22 +428,12 @@ void ADynamicSkySystem::ToggleWeatherEffects(bool bShowEffect) const
 	// }
 }
 
-void ADynamicSkySystem::SetSnowStrength(float SnowStrength) const
-{
-	UMaterialParameterCollectionInstance* ParametersCollection = GetWorld()->GetParameterCollectionInstance(WeatherMaterialParameterCollection);
-	ParametersCollection->SetScalarParameterValue(SnowStrengthParameterName, SnowStrength);
-}
-
-void ADynamicSkySystem::SetRainStrength(float RainStrength) const
-{
-	UMaterialParameterCollectionInstance* ParametersCollection = GetWorld()->GetParameterCollectionInstance(WeatherMaterialParameterCollection);
-	ParametersCollection->SetScalarParameterValue(ShowPuddlesCollectionParameterName, RainStrength);
-}
-
 void ADynamicSkySystem::SetIsSNowing(bool bIsSNowing) const
 {
-	UMaterialParameterCollectionInstance* ParametersCollection = GetWorld()->GetParameterCollectionInstance(WeatherMaterialParameterCollection);
-	ParametersCollection->SetScalarParameterValue(SnowStrengthParameterName, bIsSNowing);
+	if(UWeatherAccumulationSubsystem* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>())
+	{
+		Accumulation->SetChannelValue(SnowChannelName, bIsSNowing ? 1.f : 0.f);
+	}
 }
 
 // Temporary hack 
@@ -197,14 +441,17 @@ void ADynamicSkySystem::SetIsSNowing(bool bIsSNowing) const
 // TODO: Define animation in weather presets?
 void ADynamicSkySystem::WeatherAnimationUpdate(float Update)
 {
-	switch(CurrentWeatherPreset->WeatherType)
+	PrecipitationScale = Update;
+
+	if(UWeatherExposureSubsystem* Exposure = GetWorld()->GetSubsystem<UWeatherExposureSubsystem>())
 	{
-	case EWeatherTypes::Snowy:
-		SetSnowStrength(Update);
-		break;
-	case EWeatherTypes::Rainy:
-		SetRainStrength(Update);
-		break;
+		Exposure->SetPrecipitationScale(Update);
+	}
+
+	// The ambience crossfades in step with the transition
+	if(Ambience)
+	{
+		Ambience->SetTransitionProgress(GetWeatherTransitionProgress());
 	}
 }
 
@@ -212,6 +459,390 @@ void ADynamicSkySystem::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	UpdateWeatherZoneBlend();
+	UpdatePrecipitationOcclusion();
+	UpdatePrecipitationVolume(DeltaTime);
+	UpdateWeatherEffectDensity();
+	UpdateWind();
+	UpdateAccumulationView();
+	LaunchFrameStateTask();
+}
+
+FEnvironmentFrameInputs ADynamicSkySystem::MakeFrameInputs() const
+{
+	FEnvironmentFrameInputs Inputs;
+	Inputs.TimeOfDay = TimeOfDay;
+	Inputs.DawnTime = DawnTime;
+	Inputs.DawnTimeOffset = DawnTimeOffset;
+	Inputs.DuskTime = DuskTime;
+	Inputs.DuskTimeOffset = DuskTimeOffset;
+	Inputs.SunMoonRotationYaw = SunMoonRotationYaw;
+
+	// At the border of a zone we blend from the zone below it, or from the global preset
+	Inputs.ActivePreset = GetActiveWeatherPreset();
+	Inputs.BlendFromPreset = ViewZoneSample.FallbackPreset ? ViewZoneSample.FallbackPreset.Get() : CurrentWeatherPreset.Get();
+	Inputs.BlendToPreset = ViewZoneSample.Preset;
+	Inputs.BlendWeight = ViewZoneSample.BlendWeight;
+
+	Inputs.Cloud2DTiling = Tiling;
+	float const CloudWindScale = GetCloudWindScale();
+	Inputs.Cloud2DPanningSpeed = PanningSpeed * CloudWindScale;
+	Inputs.Cloud2DBrightness = Brightness;
+	Inputs.DaytimeAtmosphereCloudTint = DaytimeAtmosphereCloudTint;
+	Inputs.NighttimeAtmosphereCloudTint = NighttimeAtmosphereCloudTint;
+
+	Inputs.VolumetricCloudPanningSpeed = VolumetricCloudPanningSpeed * CloudWindScale;
+	Inputs.DayVolumetricCloudBrightness = DayVolumetricCloudBrightness;
+	Inputs.NightVolumetricCloudBrightness = NightVolumetricCloudBrightness;
+	Inputs.VolumetricCloudTint = VolumetricCloudTint;
+
+	return Inputs;
+}
+
+void ADynamicSkySystem::LaunchFrameStateTask()
+{
+	if(not ApplyFrameStateTick.IsTickFunctionRegistered())
+	{
+		return;
+	}
+
+	FrameStateTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Inputs = MakeFrameInputs()]
+	{
+		ENVIRONMENT_SCOPE_CYCLE_COUNTER(ComputeFrameState);
+		return FEnvironmentFrameState::Compute(Inputs);
+	});
+}
+
+void ADynamicSkySystem::ApplyPendingFrameState()
+{
+	if(not FrameStateTask.IsValid())
+	{
+		return;
+	}
+
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(ApplyFrameState);
+
+	FEnvironmentFrameState const State = FrameStateTask.GetResult();
+	FrameStateTask = {};
+
+	ApplyFrameState(State);
+}
+
+void ADynamicSkySystem::ApplyFrameState(FEnvironmentFrameState const& State)
+{
+	// Most frames nothing changed, and touching the components would dirty their render state
+	if(bHasAppliedFrameState && State == AppliedFrameState)
+	{
+		return;
+	}
+
+	ApplySunAndMoonRotation(State);
+	ApplyWeatherLightProperties(State);
+	SetCloud2DSettings(State);
+	SetVolumetricCloudMaterialParameters(State);
+
+	AppliedFrameState = State;
+	bHasAppliedFrameState = true;
+}
+
+void ADynamicSkySystem::UpdatePrecipitationOcclusion()
+{
+	UPrecipitationOcclusionSubsystem const* Occlusion = GetWorld()->GetSubsystem<UPrecipitationOcclusionSubsystem>();
+	if(not Occlusion || Occlusion->GetGridVersion() == AppliedOcclusionGridVersion || not ShouldUpdateVisuals())
+	{
+		return;
+	}
+
+	// The effects kill particles below the occluder height, so they stop falling through roofs. The grid is centered on
+	// the primary view, the effects of other views are left without it rather than culled by a grid around someone else.
+	if(not WeatherViews.IsEmpty())
+	{
+		for(UNiagaraComponent* NC : WeatherViews[0].Components)
+		{
+			Occlusion->ApplyToNiagaraComponent(NC);
+		}
+	}
+
+	AppliedOcclusionGridVersion = Occlusion->GetGridVersion();
+}
+
+void ADynamicSkySystem::UpdateWeatherEffectDensity()
+{
+	UWeatherEffectDensitySubsystem const* Density = GetWorld()->GetSubsystem<UWeatherEffectDensitySubsystem>();
+	UWeatherDataAssetBase const* Preset = GetActiveWeatherPreset();
+	if(not Density || not Preset || not ShouldUpdateVisuals())
+	{
+		return;
+	}
+
+	bool const bDensityChanged = Density->GetDensityVersion() != AppliedEffectDensityVersion;
+
+	// Only the parameters change, the effects keep running. Each view gets its share of the density, so more views
+	// do not spawn more particles.
+	float const ViewShare = 1.f / FMath::Max(WeatherViews.Num(), 1);
+	for(FDynamicSkyWeatherView& View : WeatherViews)
+	{
+		if(not bDensityChanged && View.SpawnScale == View.AppliedSpawnScale)
+		{
+			continue;
+		}
+
+		for(int32 i = 0; i < Preset->WeatherEffects.Num() && i < View.Components.Num(); ++i)
+		{
+			Density->ApplyToNiagaraComponent(View.Components[i], Preset->WeatherEffects[i], View.SpawnScale * ViewShare);
+		}
+
+		View.AppliedSpawnScale = View.SpawnScale;
+	}
+
+	AppliedEffectDensityVersion = Density->GetDensityVersion();
+}
+
+void ADynamicSkySystem::UpdatePrecipitationVolume(float const DeltaTime)
+{
+	if(not ShouldUpdateVisuals() || DeltaTime <= 0.f)
+	{
+		return;
+	}
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	GetWeatherViewLocations(ViewLocations);
+
+	// A view joined or left, the effects are split among the views again and the views start from rest
+	UWeatherDataAssetBase const* Preset = GetActiveWeatherPreset();
+	if(Preset && ViewLocations.Num() != WeatherViews.Num())
+	{
+		SetWeatherEffects();
+		ToggleWeatherEffects(Preset->HasWeatherEffects());
+
+		for(FDynamicSkyWeatherView& View : WeatherViews)
+		{
+			View.Velocity = FVector::ZeroVector;
+			View.bHasLastLocation = false;
+		}
+	}
+
+	for(int32 i = 0; i < WeatherViews.Num() && i < ViewLocations.Num(); ++i)
+	{
+		UpdatePrecipitationVolume(WeatherViews[i], ViewLocations[i], DeltaTime);
+	}
+}
+
+void ADynamicSkySystem::UpdatePrecipitationVolume(FDynamicSkyWeatherView& View, FVector const& ViewLocation, float const DeltaTime) const
+{
+	// Cuts and teleports are not movement, the volume snaps to the new position instead of leading far ahead
+	constexpr float MaxCameraSpeed = 100000.f;
+	FVector const FrameVelocity = View.bHasLastLocation ? (ViewLocation - View.LastLocation) / DeltaTime : FVector::ZeroVector;
+	View.Velocity = FrameVelocity.Size() > MaxCameraSpeed ? FVector::ZeroVector : FMath::VInterpTo(View.Velocity, FrameVelocity, DeltaTime, 5.f);
+	View.LastLocation = ViewLocation;
+	View.bHasLastLocation = true;
+
+	// The cloud layer altitude is in kilometers above the ground of the atmosphere, which is at the world origin
+	constexpr float KilometersToCentimeters = 100000.f;
+	FPrecipitationVolume const Volume = FPrecipitationVolume::Compute(PrecipitationVolumeSettings, ViewLocation, View.Velocity, VolumetricCloudLayerBottomAltitude * KilometersToCentimeters);
+
+	for(UNiagaraComponent* NC : View.Components)
+	{
+		if(NC && NC->GetAsset())
+		{
+			NC->SetVariableVec3(SpawnVolumeOriginParameterName, ViewLocation);
+			NC->SetVariableVec3(SpawnVolumeOffsetParameterName, Volume.Offset);
+			NC->SetVariableVec3(SpawnVolumeExtentParameterName, Volume.Extent);
+			NC->SetVariableFloat(SpawnVolumeYawParameterName, Volume.Yaw);
+		}
+	}
+
+	// In steps, so the spawn rates are not set again every frame while the camera climbs
+	constexpr float Steps = 32.f;
+	View.SpawnScale = FMath::RoundToFloat(Volume.SpawnScale * Steps) / Steps;
+}
+
+void ADynamicSkySystem::UpdateWind() const
+{
+	UWindSubsystem const* Wind = GetWorld()->GetSubsystem<UWindSubsystem>();
+	if(not Wind || not ShouldUpdateVisuals())
+	{
+		return;
+	}
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	GetWeatherViewLocations(ViewLocations);
+
+	// Gusts change every frame, the effects of each view follow the wind at its camera
+	for(int32 i = 0; i < WeatherViews.Num() && i < ViewLocations.Num(); ++i)
+	{
+		for(UNiagaraComponent* NC : WeatherViews[i].Components)
+		{
+			Wind->ApplyToNiagaraComponent(NC, ViewLocations[i]);
+		}
+	}
+}
+
+float ADynamicSkySystem::GetCloudWindScale() const
+{
+	UWindSubsystem const* Wind = GetWorld() ? GetWorld()->GetSubsystem<UWindSubsystem>() : nullptr;
+	if(not Wind || CloudReferenceWindSpeed <= 0.f)
+	{
+		return 1.f;
+	}
+
+	// Gusts are left out and the scale moves in steps, so the clouds do not change the frame state every frame
+	constexpr float Steps = 32.f;
+	return FMath::RoundToFloat(Wind->GetBaseWindSpeed() / (CloudReferenceWindSpeed * 100.f) * Steps) / Steps;
+}
+
+void ADynamicSkySystem::UpdateWeatherZoneBlend()
+{
+	UWeatherDataAssetBase const* PreviousPreset = GetActiveWeatherPreset();
+	if(not SampleWeatherZones())
+	{
+		return;
+	}
+
+	if(GetActiveWeatherPreset() != PreviousPreset)
+	{
+		HandleActivePresetChanged();
+	}
+	else if(GetActiveWeatherPreset() && not ApplyFrameStateTick.IsTickFunctionRegistered())
+	{
+		// Otherwise the blended lights follow through the frame state
+		SetWeatherLightProperties();
+	}
+}
+
+bool ADynamicSkySystem::SampleWeatherZones()
+{
+	UWeatherZoneSubsystem const* Zones = GetWorld()->GetSubsystem<UWeatherZoneSubsystem>();
+
+	FWeatherZoneSample Sample;
+	if(bBlendWeatherZones && Zones && Zones->HasZones())
+	{
+		Sample = Zones->QueryWeatherAt(GetViewLocation());
+
+		// Small camera movements inside the blend region should not touch the lights every frame
+		Sample.BlendWeight = FMath::RoundToFloat(Sample.BlendWeight * 255.f) / 255.f;
+	}
+
+	if(Sample == ViewZoneSample)
+	{
+		return false;
+	}
+
+	ViewZoneSample = Sample;
+	ZoneWeatherPreset = Sample.GetDominantPreset();
+	return true;
+}
+
+void ADynamicSkySystem::HandleActivePresetChanged()
+{
+	HandleWeatherSettings();
+	HandleCloudMode();
+
+	UWeatherDataAssetBase const* Preset = GetActiveWeatherPreset();
+	if(Preset && Preset->HasWeatherEffects())
+	{
+		WeatherTransitionAnimationComponent->PlayFromStart();
+		ToggleWeatherEffects(true);
+	}
+}
+
+void ADynamicSkySystem::SetWeatherPreset(UWeatherDataAssetBase* Preset)
+{
+	if(not Preset || Preset == CurrentWeatherPreset)
+	{
+		return;
+	}
+
+	UWeatherDataAssetBase const* PreviousPreset = GetActiveWeatherPreset();
+	CurrentWeatherPreset = Preset;
+
+	if(GetActiveWeatherPreset() != PreviousPreset)
+	{
+		HandleActivePresetChanged();
+	}
+	else
+	{
+		// A weather zone hides the change from the camera, but not from gameplay and the ground outside the zone
+		if(UWeatherExposureSubsystem* Exposure = GetWorld()->GetSubsystem<UWeatherExposureSubsystem>())
+		{
+			Exposure->SetGlobalWeather(CurrentWeatherPreset);
+		}
+
+		if(UWeatherAccumulationSubsystem* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>())
+		{
+			Accumulation->SetWeatherPreset(CurrentWeatherPreset);
+		}
+	}
+}
+
+void ADynamicSkySystem::SetTimeOfDay(float const NewTimeOfDay)
+{
+	TimeOfDay = FMath::Clamp(NewTimeOfDay, 0.f, Midnight);
+
+	if(not ApplyFrameStateTick.IsTickFunctionRegistered())
+	{
+		RefreshEnvironment();
+	}
+}
+
+void ADynamicSkySystem::SetDawnAndDuskTime(float const NewDawnTime, float const NewDuskTime)
+{
+	DawnTime = FMath::Clamp(NewDawnTime, 0.f, Midnight);
+	DuskTime = FMath::Clamp(NewDuskTime, DawnTime, Midnight);
+
+	if(USolarEventSubsystem* SolarEvents = bIsActiveSky ? GetWorld()->GetSubsystem<USolarEventSubsystem>() : nullptr)
+	{
+		SolarEvents->Reschedule();
+	}
+
+	if(not ApplyFrameStateTick.IsTickFunctionRegistered())
+	{
+		RefreshEnvironment();
+	}
+}
+
+void ADynamicSkySystem::RefreshEnvironment()
+{
+	if(ShouldUpdateVisuals())
+	{
+		ApplyFrameState(ComputeFrameState());
+	}
+}
+
+void ADynamicSkySystem::UpdateAccumulationView()
+{
+	if(UWeatherAccumulationSubsystem* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>())
+	{
+		Accumulation->SetViewLocation(GetViewLocation());
+	}
+}
+
+FVector ADynamicSkySystem::GetViewLocation() const
+{
+	UEnvironmentViewSubsystem const* Views = GetWorld()->GetSubsystem<UEnvironmentViewSubsystem>();
+	return Views ? Views->GetPrimaryViewLocation(GetActorLocation()) : GetActorLocation();
+}
+
+void ADynamicSkySystem::GetWeatherViewLocations(TArray<FVector, TInlineAllocator<4>>& OutLocations) const
+{
+	OutLocations.Reset();
+	if(UEnvironmentViewSubsystem const* Views = GetWorld()->GetSubsystem<UEnvironmentViewSubsystem>())
+	{
+		for(FEnvironmentView const& View : Views->GetViews())
+		{
+			OutLocations.Add(View.Location);
+		}
+	}
+
+	if(OutLocations.IsEmpty())
+	{
+		OutLocations.Add(GetActorLocation());
+	}
+}
+
+UWeatherDataAssetBase* ADynamicSkySystem::GetActiveWeatherPreset() const
+{
+	return ZoneWeatherPreset ? ZoneWeatherPreset.Get() : CurrentWeatherPreset.Get();
 }
 
 bool ADynamicSkySystem::IsDaytime() const
@@ -226,14 +857,33 @@ bool ADynamicSkySystem::IsNightTime() const
 
 void ADynamicSkySystem::HandleCloudMode()
 {
-	if(CurrentWeatherPreset && CurrentWeatherPreset->bShouldHideClouds)
+	if(ShouldUpdateVisuals())
+	{
+		HandleCloudMode(ComputeFrameState());
+	}
+}
+
+void ADynamicSkySystem::HandleCloudMode(FEnvironmentFrameState const& State)
+{
+	ToggleCloudMode();
+
+	SetCloud2DSettings(State);
+	SetVolumetricCloudMaterialParameters(State);
+}
+
+void ADynamicSkySystem::ToggleCloudMode()
+{
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Clouds);
+	bHasAppliedFrameState = false;
+
+	if(GetActiveWeatherPreset() && GetActiveWeatherPreset()->bShouldHideClouds)
 	{
 		ToggleClouds2D(false);
 		ToggleVolumetricClouds(false);
 		return;
 	}
-	
-	switch (CurrentCloudMode)
+
+	switch (GetCloudMode())
 	{
 	case ECloudTypes::None:
 		ToggleClouds2D(false);
@@ -241,15 +891,13 @@ void ADynamicSkySystem::HandleCloudMode()
 		break;
 	case ECloudTypes::Texture2D:
 		ToggleClouds2D(true);
-		SetCloud2DSettings();
-
 		ToggleVolumetricClouds(false);
 		break;
 	case ECloudTypes::Volumetric:
 		ToggleClouds2D(false);
 		
 		ToggleVolumetricClouds(true);
-		SetVolumetricCloudSettings();
+		SetVolumetricCloudLayer();
 		break;
 	}
 }
@@ -262,12 +910,11 @@ void ADynamicSkySystem::ToggleClouds2D(bool bShouldShow)
 	}
 }
 
-void ADynamicSkySystem::SetCloud2DSettings()
+void ADynamicSkySystem::SetCloud2DSettings(FEnvironmentFrameState const& State) const
 {
 	if(SkySphereMaterialInstance)
 	{
-		FLinearColor const Params { Tiling, PanningSpeed, Brightness, IsDaytime() ? DaytimeAtmosphereCloudTint : NighttimeAtmosphereCloudTint };
-		SkySphereMaterialInstance->SetVectorParameterValue(Clouds2DSettingsMaterialParameterName, Params);
+		SkySphereMaterialInstance->SetVectorParameterValue(Clouds2DSettingsMaterialParameterName, State.Cloud2DSettings);
 	}
 }
 
@@ -277,38 +924,57 @@ void ADynamicSkySystem::ToggleVolumetricClouds(bool bShouldShow)
 	VolumetricClouds->SetVisibility(bShouldShow);
 }
 
-void ADynamicSkySystem::SetVolumetricCloudSettings()
+void ADynamicSkySystem::SetVolumetricCloudLayer()
 {
-	if(VolumetricCloudMasterMaterial)
+	// Only create the instance once, this is called on every cloud mode or weather change
+	if(VolumetricCloudMasterMaterial && (not VolumetricCloudMaterialInstance || VolumetricCloudMaterialInstance->Parent != VolumetricCloudMasterMaterial))
 	{
-		VolumetricCloudMaterialInstance = UKismetMaterialLibrary::CreateDynamicMaterialInstance(GetWorld(), VolumetricCloudMasterMaterial);
+		VolumetricCloudMaterialInstance = UMaterialInstanceDynamic::Create(VolumetricCloudMasterMaterial, this);
 		VolumetricClouds->SetMaterial(VolumetricCloudMaterialInstance);
 	}
 
 	VolumetricClouds->SetLayerBottomAltitude(VolumetricCloudLayerBottomAltitude);
 	VolumetricClouds->SetLayerHeight(VolumetricCloudLayerHeight);
+}
 
+void ADynamicSkySystem::SetVolumetricCloudMaterialParameters(FEnvironmentFrameState const& State) const
+{
 	if(VolumetricCloudMaterialInstance)
 	{
-		VolumetricCloudMaterialInstance->SetScalarParameterValue(VolumetricCloudSettingsMaterialParameterName, VolumetricCloudPanningSpeed);
-
-		float const CloudBrightness = IsDaytime() ? DayVolumetricCloudBrightness : NightVolumetricCloudBrightness;
-		FLinearColor const Tint { VolumetricCloudTint.R, VolumetricCloudTint.G, VolumetricCloudTint.B, CloudBrightness };
-		VolumetricCloudMaterialInstance->SetVectorParameterValue(VolumetricCloudAlbedoMaterialParameterName, Tint);
+		VolumetricCloudMaterialInstance->SetVectorParameterValue(VolumetricCloudAlbedoMaterialParameterName, State.VolumetricCloudAlbedo);
+		VolumetricCloudMaterialInstance->SetScalarParameterValue(VolumetricCloudSettingsMaterialParameterName, State.VolumetricCloudPanningSpeed);
 	}
 }
 
 void ADynamicSkySystem::SetWeatherEffects()
 {
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(SetWeatherEffects);
+	LLM_SCOPE_BYTAG(EnvironmentSystem_WeatherEffects);
+
+	UWeatherDataAssetBase const* Preset = GetActiveWeatherPreset();
+
+	if(not Preset || not ShouldUpdateVisuals())
+	{
+		return;
+	}
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	GetWeatherViewLocations(ViewLocations);
+
+	// Every view gets its own effects, in place of another sky
+	int32 const NumEffects = Preset->WeatherEffects.Num();
+	int32 const NumRequired = ViewLocations.Num() * NumEffects;
+
 	// TODO: Refactor - move to own member function
-	if(WeatherEffectsComponents.Num() < CurrentWeatherPreset->WeatherEffects.Num())
+	if(WeatherEffectsComponents.Num() < NumRequired)
 	{
-		auto NumComponents = CurrentWeatherPreset->WeatherEffects.Num() - WeatherEffectsComponents.Num();
+		auto NumComponents = NumRequired - WeatherEffectsComponents.Num();
 		for(decltype(NumComponents) i = 0; i < NumComponents; ++i)
 		{
 			UNiagaraComponent* NC = NewObject<UNiagaraComponent>(this, UNiagaraComponent::StaticClass());
 			NC->SetupAttachment(Root);
 			NC->RegisterComponent(); 
+			ENVIRONMENT_INC_COUNTER(NiagaraSpawns, 1);
 			
 			WeatherEffectsComponents.Add(NC);
 		}
@@ -320,28 +986,50 @@ void ADynamicSkySystem::SetWeatherEffects()
 		NC->SetAsset(nullptr);
 	}
 
-	for(auto i = 0; i < CurrentWeatherPreset->WeatherEffects.Num(); ++i)
+	UWeatherEffectDensitySubsystem const* Density = GetWorld()->GetSubsystem<UWeatherEffectDensitySubsystem>();
+
+	// The views keep their camera velocity, the density is split among them
+	WeatherViews.SetNum(ViewLocations.Num());
+	float const ViewShare = 1.f / WeatherViews.Num();
+
+	for(int32 ViewIndex = 0; ViewIndex < WeatherViews.Num(); ++ViewIndex)
 	{
-		FWeatherEffectDefinition const& Effect = CurrentWeatherPreset->WeatherEffects[i];
-		UNiagaraComponent* NC = WeatherEffectsComponents[i];
-		
-		if(Effect.WeatherEffects)
+		FDynamicSkyWeatherView& View = WeatherViews[ViewIndex];
+		View.Components.Reset();
+		View.Components.Append(WeatherEffectsComponents.GetData() + ViewIndex * NumEffects, NumEffects);
+
+		for(auto i = 0; i < NumEffects; ++i)
 		{
-			NC->SetAsset(Effect.WeatherEffects);
+			FWeatherEffectDefinition const& Effect = Preset->WeatherEffects[i];
+			UNiagaraComponent* NC = View.Components[i];
 			
-			for(auto [Name, Float] : Effect.WeatherEffectsFloatParameters)
+			if(Effect.WeatherEffects)
 			{
-				NC->SetVariableFloat(Name, Float);
-			}
+				NC->SetAsset(Effect.WeatherEffects);
+				
+				for(auto [Name, Float] : Effect.WeatherEffectsFloatParameters)
+				{
+					NC->SetVariableFloat(Name, Float);
+				}
 
-			for(auto [Name, Vector] : Effect.WeatherEffectsVectorParameters)
-			{
-				NC->SetVariableVec3(Name, Vector);
+				for(auto [Name, Vector] : Effect.WeatherEffectsVectorParameters)
+				{
+					NC->SetVariableVec3(Name, Vector);
+				}
+
+				if(Density)
+				{
+					Density->ApplyToNiagaraComponent(NC, Effect, View.SpawnScale * ViewShare);
+				}
 			}
 		}
+
+		View.AppliedSpawnScale = View.SpawnScale;
 	}
 
-	TogglePuddleMaterialEffects(CurrentWeatherPreset->bShouldShowRainPuddles, CurrentWeatherPreset->bShouldShowRainPuddleRipples);
+	// New assets lose their user parameters, so the occlusion grid has to be bound again
+	AppliedOcclusionGridVersion = 0;
+	AppliedEffectDensityVersion = Density ? Density->GetDensityVersion() : 0;
 	
 	//WeatherEffectsComponent->SetAsset(CurrentWeatherPreset->WeatherEffects);
 
@@ -358,74 +1046,110 @@ void ADynamicSkySystem::SetWeatherEffects()
 	// 		WeatherEffectsComponent->SetVariableVec3(Name, Vector);
 	// 	}
 	// }
-
-	// TogglePuddleMaterialEffects(CurrentWeatherPreset->bShouldShowRainPuddles, CurrentWeatherPreset->bShouldShowRainPuddleRipples);
 }
 
-void ADynamicSkySystem::TogglePuddleMaterialEffects(bool bShowPuddles, bool bShowRipples) const
+ECloudTypes ADynamicSkySystem::GetCloudMode() const
 {
-	UMaterialParameterCollectionInstance* ParametersCollection = GetWorld()->GetParameterCollectionInstance(WeatherMaterialParameterCollection);
-	ParametersCollection->SetScalarParameterValue(ShowPuddlesCollectionParameterName, static_cast<float>(bShowPuddles));
-	ParametersCollection->SetScalarParameterValue(ShowRipplesCollectionParameterName, static_cast<float>(bShowRipples));
+	UWeatherDataAssetBase const* Preset = GetActiveWeatherPreset();
+	return Preset && Preset->bOverrideCloudMode ? Preset->CloudMode : CurrentCloudMode;
 }
 
 void ADynamicSkySystem::HandleWeatherSettings()
 {
-	if(not CurrentWeatherPreset)
+	UWeatherDataAssetBase const* Preset = GetActiveWeatherPreset();
+	if(not Preset)
 	{
 		return;
 	}
 
+	ENVIRONMENT_TRACE_EVENT(TEXT("Weather changed to %s"), *Preset->GetName());
+
 	SetWeatherEffects();
 	SetWeatherLightProperties();
-	
-	if(WeatherMaterialParameterCollection && GetWorld())
+	ApplyWeatherToSubsystems();
+	ToggleWeatherEffects(Preset->HasWeatherEffects());
+	BindWeatherTransitionCurve();
+}
+
+void ADynamicSkySystem::ApplyWeatherToSubsystems()
+{
+	if(Ambience && not IsNetMode(NM_DedicatedServer))
 	{
-		switch(CurrentWeatherPreset->WeatherType)
-		{
-		case EWeatherTypes::Snowy:
-			ToggleWeatherEffects(true); // TODO: Generalize name to include rain or any effect
-			SetSnowStrength(1.f);
-			break;
-		case EWeatherTypes::Rainy:
-			ToggleWeatherEffects(true); 
-			CurrentCloudMode = ECloudTypes::Texture2D; // TODO: Move to data asset
-			SetSnowStrength(0.f);
-			break;
-		default:
-			ToggleWeatherEffects(false);
-			SetSnowStrength(0.f);
-		}
+		Ambience->SetWeatherPreset(GetActiveWeatherPreset());
 	}
 
-	if(WeatherTransitionCurve)
+	// Gameplay sees the global weather, weather zones are resolved per position
+	if(UWeatherExposureSubsystem* Exposure = GetWorld() ? GetWorld()->GetSubsystem<UWeatherExposureSubsystem>() : nullptr)
 	{
+		Exposure->SetGlobalWeather(CurrentWeatherPreset);
+	}
+
+	// Surface layers live in the material parameter collection, which is also read by gameplay
+	if(UWeatherAccumulationSubsystem* Accumulation = GetWorld() ? GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>() : nullptr)
+	{
+		Accumulation->SetParameterCollection(WeatherMaterialParameterCollection);
+		Accumulation->SetWeatherPreset(CurrentWeatherPreset);
+	}
+}
+
+void ADynamicSkySystem::BindWeatherTransitionCurve()
+{
+	if(WeatherTransitionCurve && not WeatherAnimationUpdateCallback.IsBound())
+	{
+		LLM_SCOPE_BYTAG(EnvironmentSystem_Sky);
 		WeatherAnimationUpdateCallback.BindDynamic(this, &ADynamicSkySystem::WeatherAnimationUpdate);
 		WeatherTransitionAnimationComponent->AddInterpFloat(WeatherTransitionCurve, WeatherAnimationUpdateCallback);
 	}
 }
 
-void ADynamicSkySystem::SetWeatherLightProperties() const
+void ADynamicSkySystem::SetWeatherLightProperties()
 {
-	bool bIsDaytime = IsDaytime();
-	if(bIsDaytime)
+	if(not ShouldUpdateVisuals())
 	{
-		SetWeatherLightProperties(CurrentWeatherPreset->DayTimeConfiguration, SunDirectionalLight);
+		return;
 	}
-	else
+
+	bHasAppliedFrameState = false;
+	ApplyWeatherLightProperties(ComputeFrameState());
+}
+
+void ADynamicSkySystem::ApplyWeatherLightProperties(FEnvironmentFrameState const& State) const
+{
+	if(not State.bHasWeather)
 	{
-		SetWeatherLightProperties(CurrentWeatherPreset->NightTimeConfiguration, MoonDirectionalLight);
+		return;
 	}
 
+	SetWeatherLightProperties(State.WeatherConfiguration, State.bIsDaytime ? SunDirectionalLight : MoonDirectionalLight);
+
 	if(SkySphereMaterialInstance)
 	{
-		SkySphereMaterialInstance->SetScalarParameterValue(StarsVisibleMaterialParameterName, static_cast<float>(not bIsDaytime && CurrentWeatherPreset->bShouldShowStars));
-		SkySphereMaterialInstance->SetScalarParameterValue(MoonVisibleMaterialParameterName, static_cast<float>(not bIsDaytime && CurrentWeatherPreset->bShouldShowMoon));	
+		SkySphereMaterialInstance->SetScalarParameterValue(StarsVisibleMaterialParameterName, static_cast<float>(State.bStarsVisible));
+		SkySphereMaterialInstance->SetScalarParameterValue(MoonVisibleMaterialParameterName, static_cast<float>(State.bMoonVisible));	
+	}
+}
+
+void ADynamicSkySystem::SetLightningFlash(float const FlashStrength) const
+{
+	if(not GetActiveWeatherPreset() || not ShouldUpdateVisuals())
+	{
+		return;
 	}
+
+	FWeatherConfiguration const Configuration = GetWeatherConfiguration(IsDaytime());
+	SkyLight->SetIntensity(Configuration.SkylightSettings.Intensity * (1.f + FlashStrength));
+	Fog->SetVolumetricFogEmissive(Configuration.ExponentialHeightfogSettings.EmissiveScale + FLinearColor(.6f, .65f, 1.f) * (FlashStrength * LightningFogEmissive));
+}
+
+FWeatherConfiguration ADynamicSkySystem::GetWeatherConfiguration(bool const bIsDaytime) const
+{
+	return FEnvironmentFrameState::GetWeatherConfiguration(MakeFrameInputs(), bIsDaytime);
 }
 
 void ADynamicSkySystem::SetWeatherLightProperties(FWeatherConfiguration const& Configuration, UDirectionalLightComponent* SunOrMoon) const
 {
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(SetWeatherLightProperties);
+
 	SunOrMoon->SetIntensity(Configuration.DirectionalLightSettings.Intensity);
 	SunOrMoon->SetLightColor(Configuration.DirectionalLightSettings.Color);
 	SunOrMoon->SetLightSourceAngle(Configuration.DirectionalLightSettings.SourceAngle);
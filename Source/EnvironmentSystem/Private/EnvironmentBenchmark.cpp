@@ -0,0 +1,537 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnimNotify_SpawnFootEffects.h"
+#include "DynamicSkySystem.h"
+#include "EnvironmentSubsystem.h"
+#include "EnvironmentSystemLogging.h"
+#include "WeatherAccumulationSubsystem.h"
+#include "WeatherDataAssetBase.h"
+#include "WorldTimeSubsystem.h"
+#include "Animation/SkeletalMeshActor.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Interfaces/IPluginManager.h"
+#include "Logging/StructuredLog.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	// Where the shipped presets live, every DA_* asset in it is measured
+	const TCHAR* PresetPath = TEXT("/EnvironmentSystem/Environment/Data");
+	const TCHAR* FootEffectsNotifyClassPath = TEXT("/EnvironmentSystem/Environment/Blueprints/Animation/AN_SpawnFootprints.AN_SpawnFootprints_C");
+
+	// Simulated time per world time tick, from a millisecond to a year
+	const FTimespan WorldTimeTickRates[] = { FTimespan::FromMilliseconds(1.), FTimespan::FromMinutes(1.), FTimespan::FromDays(1.), FTimespan::FromDays(365.) };
+
+	// Steps of the 24 hour sweep, one per simulated minute
+	constexpr int32 TimeOfDaySteps = 24 * 60;
+
+	// Accumulation channel the foot effects spawn footprints in
+	const FName SnowChannelName = "Snow";
+
+	constexpr int32 DefaultIterations = 20;
+	constexpr int32 DefaultNumMeshes = 64;
+
+	class FBenchmarkTimer
+	{
+	public:
+		explicit FBenchmarkTimer(FString InName) : Name(MoveTemp(InName)) {}
+
+		template<typename FunctionType>
+		void Measure(FunctionType&& Function)
+		{
+			double const Start = FPlatformTime::Seconds();
+			Function();
+			Samples.Add(FPlatformTime::Seconds() - Start);
+		}
+
+		TSharedRef<FJsonObject> ToJson()
+		{
+			Samples.Sort();
+
+			// Nearest rank, so that p99 of a small set is the slowest sample rather than an interpolation
+			auto Percentile = [this](double const P)
+			{
+				int32 const Rank = FMath::CeilToInt32(P * Samples.Num()) - 1;
+				return Samples[FMath::Clamp(Rank, 0, Samples.Num() - 1)] * 1000.;
+			};
+
+			double Total = 0.;
+			for(double const Sample : Samples)
+			{
+				Total += Sample;
+			}
+
+			TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+			Result->SetStringField(TEXT("Name"), Name);
+			Result->SetNumberField(TEXT("Samples"), Samples.Num());
+			if(not Samples.IsEmpty())
+			{
+				Result->SetNumberField(TEXT("P50Ms"), Percentile(.5));
+				Result->SetNumberField(TEXT("P99Ms"), Percentile(.99));
+				Result->SetNumberField(TEXT("MeanMs"), Total * 1000. / Samples.Num());
+				Result->SetNumberField(TEXT("MaxMs"), Samples.Last() * 1000.);
+			}
+
+			UE_LOGFMT(EnvironmentSystem, Display, "es.Benchmark.Run: {Name} p50 {P50} ms, p99 {P99} ms over {Num} samples",
+				Name, Samples.IsEmpty() ? 0. : Percentile(.5), Samples.IsEmpty() ? 0. : Percentile(.99), Samples.Num());
+
+			return Result;
+		}
+
+	private:
+		FString Name;
+		TArray<double> Samples;
+	};
+
+	// Sections that cannot run are listed with the reason, so a missing timing is not mistaken for a dropped one
+	void AddSkipped(FString const& Name, FString const& Reason, TArray<TSharedPtr<FJsonValue>>& OutResults)
+	{
+		UE_LOGFMT(EnvironmentSystem, Display, "es.Benchmark.Run: skipped {Name}, {Reason}", Name, Reason);
+
+		TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+		Result->SetStringField(TEXT("Name"), Name);
+		Result->SetStringField(TEXT("Skipped"), Reason);
+		OutResults.Add(MakeShared<FJsonValueObject>(Result));
+	}
+
+	TArray<UWeatherDataAssetBase*> LoadShippedPresets()
+	{
+		IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+		AssetRegistry.ScanPathsSynchronous({ PresetPath });
+
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssetsByPath(PresetPath, Assets, true);
+
+		TArray<UWeatherDataAssetBase*> Presets;
+		for(FAssetData const& Asset : Assets)
+		{
+			if(Asset.AssetName.ToString().StartsWith(TEXT("DA_")))
+			{
+				if(UWeatherDataAssetBase* Preset = Cast<UWeatherDataAssetBase>(Asset.GetAsset()))
+				{
+					Presets.Add(Preset);
+				}
+			}
+		}
+
+		return Presets;
+	}
+
+	ADynamicSkySystem* FindOrSpawnSky(UWorld* World, bool& bOutSpawned)
+	{
+		bOutSpawned = false;
+		UEnvironmentSubsystem const* Environment = World->GetSubsystem<UEnvironmentSubsystem>();
+		if(ADynamicSkySystem* Sky = Environment ? Environment->GetSky() : nullptr)
+		{
+			return Sky;
+		}
+
+		bOutSpawned = true;
+		return World->SpawnActor<ADynamicSkySystem>();
+	}
+
+	void BenchmarkPresetSwitches(ADynamicSkySystem* Sky, TConstArrayView<UWeatherDataAssetBase*> Presets, int32 const Iterations, TArray<TSharedPtr<FJsonValue>>& OutResults)
+	{
+		if(Presets.Num() < 2)
+		{
+			AddSkipped(TEXT("PresetSwitch"), FString::Printf(TEXT("found %d presets in %s, at least 2 are needed"), Presets.Num(), PresetPath), OutResults);
+			return;
+		}
+
+		TArray<FBenchmarkTimer> Timers;
+		for(UWeatherDataAssetBase const* Preset : Presets)
+		{
+			Timers.Emplace(FString::Printf(TEXT("PresetSwitch/%s"), *Preset->GetName()));
+		}
+
+		for(int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			for(int32 i = 0; i < Presets.Num(); ++i)
+			{
+				Timers[i].Measure([Sky, Preset = Presets[i]] { Sky->SetWeatherPreset(Preset); });
+			}
+		}
+
+		for(FBenchmarkTimer& Timer : Timers)
+		{
+			OutResults.Add(MakeShared<FJsonValueObject>(Timer.ToJson()));
+		}
+	}
+
+	// Loading a save used to go through the setup of BeginPlay, which then plays the weather transition from the start
+	void BenchmarkRestore(ADynamicSkySystem* Sky, UEnvironmentSubsystem* Environment, TConstArrayView<UWeatherDataAssetBase*> Presets, int32 const Iterations, TArray<TSharedPtr<FJsonValue>>& OutResults)
+	{
+		FBenchmarkTimer BeginPlayTimer(TEXT("Restore/BeginPlay"));
+		FBenchmarkTimer SnapshotTimer(TEXT("Restore/Snapshot"));
+
+		for(int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			for(UWeatherDataAssetBase* Preset : Presets)
+			{
+				Sky->SetWeatherPreset(Preset);
+				Sky->SetWeatherTransitionProgress(1.f);
+				FEnvironmentSnapshot const Snapshot = Environment->CaptureSnapshot();
+
+				BeginPlayTimer.Measure([Sky] { Sky->StartEnvironment(); });
+				SnapshotTimer.Measure([Environment, &Snapshot] { Environment->RestoreSnapshot(Snapshot); });
+			}
+		}
+
+		OutResults.Add(MakeShared<FJsonValueObject>(BeginPlayTimer.ToJson()));
+		OutResults.Add(MakeShared<FJsonValueObject>(SnapshotTimer.ToJson()));
+	}
+
+	// The values the sky derives every frame, without copying them into its components
+	void BenchmarkFrameState(TConstArrayView<UWeatherDataAssetBase*> Presets, int32 const Iterations, TArray<TSharedPtr<FJsonValue>>& OutResults)
+	{
+		FBenchmarkTimer Timer(TEXT("FrameState"));
+		FEnvironmentFrameInputs Inputs;
+
+		for(int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			for(UWeatherDataAssetBase const* Preset : Presets)
+			{
+				Inputs.ActivePreset = Preset;
+				for(int32 Step = 0; Step < TimeOfDaySteps; ++Step)
+				{
+					Inputs.TimeOfDay = ADynamicSkySystem::Midnight * Step / TimeOfDaySteps;
+					Timer.Measure([&Inputs] { FEnvironmentFrameState::Compute(Inputs); });
+				}
+			}
+		}
+
+		OutResults.Add(MakeShared<FJsonValueObject>(Timer.ToJson()));
+	}
+
+	void BenchmarkTimeOfDaySweep(ADynamicSkySystem* Sky, int32 const Iterations, TArray<TSharedPtr<FJsonValue>>& OutResults)
+	{
+		FBenchmarkTimer Timer(TEXT("TimeOfDaySweep"));
+
+		// A ticking sky leaves the new time to the next frame state, otherwise SetTimeOfDay applies it right away
+		bool const bDeferred = Sky->PrimaryActorTick.IsTickFunctionRegistered();
+
+		for(int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			for(int32 Step = 0; Step < TimeOfDaySteps; ++Step)
+			{
+				float const Time = ADynamicSkySystem::Midnight * Step / TimeOfDaySteps;
+				Timer.Measure([Sky, Time, bDeferred]
+				{
+					Sky->SetTimeOfDay(Time);
+					if(bDeferred)
+					{
+						Sky->RefreshEnvironment();
+					}
+				});
+			}
+		}
+
+		OutResults.Add(MakeShared<FJsonValueObject>(Timer.ToJson()));
+	}
+
+	void BenchmarkWorldTime(UWorldTimeSubsystem* WorldTime, int32 const Iterations, TArray<TSharedPtr<FJsonValue>>& OutResults)
+	{
+		FTimespan const OriginalTickRate = WorldTime->GetTickRate();
+		FDateTime const OriginalDateTime = WorldTime->GetWorldDateTime();
+
+		// A full step of the simulation on every tick
+		float const DeltaTime = WorldTime->GetRealWorldTickFrequency();
+		FTickableGameObject& Tickable = *WorldTime;
+
+		for(FTimespan const& TickRate : WorldTimeTickRates)
+		{
+			FBenchmarkTimer Timer(FString::Printf(TEXT("WorldTimeTick/%s"), *TickRate.ToString()));
+			WorldTime->SetTickRate(TickRate);
+			WorldTime->SetWorldDateTime(OriginalDateTime);
+
+			for(int32 i = 0; i < Iterations * 100; ++i)
+			{
+				Timer.Measure([&Tickable, DeltaTime] { Tickable.Tick(DeltaTime); });
+			}
+
+			OutResults.Add(MakeShared<FJsonValueObject>(Timer.ToJson()));
+		}
+
+		WorldTime->SetTickRate(OriginalTickRate);
+		WorldTime->SetWorldDateTime(OriginalDateTime);
+	}
+
+	// The mesh passed with Mesh=, otherwise the mesh of the player pawn
+	USkeletalMesh* FindFootEffectsMesh(UWorld const* World, FString const& MeshPath)
+	{
+		if(not MeshPath.IsEmpty())
+		{
+			return LoadObject<USkeletalMesh>(nullptr, *MeshPath);
+		}
+
+		APlayerController const* PlayerController = World->GetFirstPlayerController();
+		APawn const* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		USkeletalMeshComponent const* PawnMesh = Pawn ? Pawn->FindComponentByClass<USkeletalMeshComponent>() : nullptr;
+		return PawnMesh ? PawnMesh->GetSkeletalMeshAsset() : nullptr;
+	}
+
+	void BenchmarkFootEffects(UWorld* World, FVector const& Origin, FString const& MeshPath, int32 const NumMeshes, int32 const Iterations, TArray<TSharedPtr<FJsonValue>>& OutResults)
+	{
+		UClass* NotifyClass = StaticLoadClass(UAnimNotify_SpawnFootEffects::StaticClass(), nullptr, FootEffectsNotifyClassPath);
+		FString const Name = FString::Printf(TEXT("FootEffects/%d"), NumMeshes);
+		if(not NotifyClass)
+		{
+			AddSkipped(Name, FString::Printf(TEXT("could not load %s"), FootEffectsNotifyClassPath), OutResults);
+			return;
+		}
+
+		// The notify traces down from the foot bones, without them it measures an early out
+		USkeletalMesh* Mesh = FindFootEffectsMesh(World, MeshPath);
+		if(not Mesh)
+		{
+			AddSkipped(Name, TEXT("no skeletal mesh, pass Mesh=<Path> or possess a pawn with one"), OutResults);
+			return;
+		}
+
+		// Footprints are only spawned in snow
+		UWeatherAccumulationSubsystem* Accumulation = World->GetSubsystem<UWeatherAccumulationSubsystem>();
+		float const OriginalSnow = Accumulation ? Accumulation->GetChannelValue(SnowChannelName) : 0.f;
+		if(Accumulation)
+		{
+			Accumulation->SetChannelValue(SnowChannelName, 1.f);
+		}
+
+		// The notify is called through the base class, where it is public
+		UAnimNotify* Notify = NewObject<UAnimNotify>(GetTransientPackage(), NotifyClass);
+
+		TArray<ASkeletalMeshActor*> Actors;
+		int32 const GridSize = FMath::CeilToInt32(FMath::Sqrt(static_cast<float>(NumMeshes)));
+		for(int32 i = 0; i < NumMeshes; ++i)
+		{
+			FVector const Location = Origin + FVector((i % GridSize) * 100., (i / GridSize) * 100., 0.);
+			ASkeletalMeshActor* Actor = World->SpawnActor<ASkeletalMeshActor>(Location, FRotator::ZeroRotator);
+			Actor->GetSkeletalMeshComponent()->SetSkeletalMesh(Mesh);
+			Actors.Add(Actor);
+		}
+
+		FBenchmarkTimer Timer(Name);
+		FAnimNotifyEventReference const EventReference;
+
+		for(int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			Timer.Measure([&Actors, Notify, &EventReference]
+			{
+				for(ASkeletalMeshActor const* Actor : Actors)
+				{
+					Notify->Notify(Actor->GetSkeletalMeshComponent(), nullptr, EventReference);
+				}
+			});
+		}
+
+		for(ASkeletalMeshActor* Actor : Actors)
+		{
+			Actor->Destroy();
+		}
+
+		if(Accumulation)
+		{
+			Accumulation->SetChannelValue(SnowChannelName, OriginalSnow);
+		}
+
+		OutResults.Add(MakeShared<FJsonValueObject>(Timer.ToJson()));
+	}
+
+	FString WriteResults(TArray<TSharedPtr<FJsonValue>> const& Results, int32 const Iterations, int32 const NumMeshes)
+	{
+		TSharedPtr<IPlugin> const Plugin = IPluginManager::Get().FindPlugin(TEXT("EnvironmentSystem"));
+
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetStringField(TEXT("PluginVersion"), Plugin ? Plugin->GetDescriptor().VersionName : FString());
+		Root->SetStringField(TEXT("EngineVersion"), FEngineVersion::Current().ToString());
+		Root->SetStringField(TEXT("Platform"), FPlatformProperties::IniPlatformName());
+		Root->SetStringField(TEXT("Timestamp"), FDateTime::UtcNow().ToIso8601());
+		Root->SetNumberField(TEXT("Iterations"), Iterations);
+		Root->SetNumberField(TEXT("NumMeshes"), NumMeshes);
+		Root->SetBoolField(TEXT("Rendering"), FApp::CanEverRender());
+		Root->SetArrayField(TEXT("Results"), Results);
+
+		FString Json;
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+		FJsonSerializer::Serialize(Root, Writer);
+
+		FString const FileName = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / FString::Printf(TEXT("EnvironmentSystem-%s.json"), *FDateTime::Now().ToString());
+		if(not FFileHelper::SaveStringToFile(Json, *FileName))
+		{
+			UE_LOGFMT(EnvironmentSystem, Error, "es.Benchmark.Run: could not write {File}", FileName);
+			return FString();
+		}
+
+		return FileName;
+	}
+
+	// Runs every section and returns the file the results were written to, empty when it could not be written
+	FString RunBenchmark(UWorld* World, int32 const Iterations, int32 const NumMeshes, FString const& MeshPath)
+	{
+		// Without rendering the sky skips its visuals and the foot effects spawn nothing, those timings would only measure the early outs
+		bool const bCanRender = FApp::CanEverRender();
+		FString const NoRenderingReason = TEXT("needs rendering, run with -RenderOffscreen instead of -nullrhi");
+
+		TArray<TSharedPtr<FJsonValue>> Results;
+		TArray<UWeatherDataAssetBase*> const Presets = LoadShippedPresets();
+		BenchmarkFrameState(Presets, Iterations, Results);
+
+		bool bSpawnedSky = false;
+		ADynamicSkySystem* Sky = FindOrSpawnSky(World, bSpawnedSky);
+
+		// The sections change the weather, the time and the surface layers, a year of world time fires season and solar events too
+		UEnvironmentSubsystem* Environment = World->GetSubsystem<UEnvironmentSubsystem>();
+		TOptional<FEnvironmentSnapshot> Snapshot;
+		if(Environment && Sky && Environment->GetSky() == Sky)
+		{
+			Snapshot = Environment->CaptureSnapshot();
+		}
+
+		// A sky that is not the active one is not in the snapshot
+		UWeatherDataAssetBase* const OriginalPreset = Sky ? Sky->GetWeatherPreset() : nullptr;
+		float const OriginalTimeOfDay = Sky ? Sky->GetTimeOfDay() : 0.f;
+
+		if(Sky)
+		{
+			BenchmarkPresetSwitches(Sky, Presets, Iterations, Results);
+
+			if(bCanRender)
+			{
+				BenchmarkTimeOfDaySweep(Sky, Iterations, Results);
+			}
+			else
+			{
+				AddSkipped(TEXT("TimeOfDaySweep"), NoRenderingReason, Results);
+			}
+
+			if(Snapshot.IsSet())
+			{
+				BenchmarkRestore(Sky, Environment, Presets, Iterations, Results);
+			}
+		}
+
+		if(UWorldTimeSubsystem* WorldTime = World->GetSubsystem<UWorldTimeSubsystem>())
+		{
+			BenchmarkWorldTime(WorldTime, Iterations, Results);
+		}
+
+		if(bCanRender)
+		{
+			APlayerController const* PlayerController = World->GetFirstPlayerController();
+			FVector const Origin = PlayerController && PlayerController->GetPawn() ? PlayerController->GetPawn()->GetActorLocation() : FVector::ZeroVector;
+			BenchmarkFootEffects(World, Origin, MeshPath, NumMeshes, Iterations, Results);
+		}
+		else
+		{
+			AddSkipped(FString::Printf(TEXT("FootEffects/%d"), NumMeshes), NoRenderingReason, Results);
+		}
+
+		if(Snapshot.IsSet())
+		{
+			Environment->RestoreSnapshot(Snapshot.GetValue());
+		}
+		else if(Sky && not bSpawnedSky)
+		{
+			Sky->SetWeatherPreset(OriginalPreset);
+			Sky->SetTimeOfDay(OriginalTimeOfDay);
+		}
+
+		if(bSpawnedSky && Sky)
+		{
+			Sky->Destroy();
+		}
+
+		return WriteResults(Results, Iterations, NumMeshes);
+	}
+}
+
+static void RunEnvironmentBenchmark(TArray<FString> const& Args, UWorld* World)
+{
+	if(not World || not World->IsGameWorld())
+	{
+		UE_LOGFMT(EnvironmentSystem, Warning, "es.Benchmark.Run: needs a game world");
+		return;
+	}
+
+	bool bQuit = false;
+	FString MeshPath;
+
+	TArray<int32> Numbers;
+	for(FString const& Arg : Args)
+	{
+		if(Arg.Equals(TEXT("-quit"), ESearchCase::IgnoreCase))
+		{
+			bQuit = true;
+		}
+		else if(Arg.StartsWith(TEXT("Mesh="), ESearchCase::IgnoreCase))
+		{
+			MeshPath = Arg.RightChop(5);
+		}
+		else if(Arg.IsNumeric())
+		{
+			Numbers.Add(FMath::Max(1, FCString::Atoi(*Arg)));
+		}
+	}
+
+	int32 const Iterations = Numbers.Num() > 0 ? Numbers[0] : DefaultIterations;
+	int32 const NumMeshes = Numbers.Num() > 1 ? Numbers[1] : DefaultNumMeshes;
+
+	FString const FileName = RunBenchmark(World, Iterations, NumMeshes, MeshPath);
+	if(not FileName.IsEmpty())
+	{
+		UE_LOGFMT(EnvironmentSystem, Display, "es.Benchmark.Run: wrote {File}", FileName);
+	}
+
+	if(bQuit)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, FileName.IsEmpty() ? 1 : 0, TEXT("es.Benchmark.Run"));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs RunEnvironmentBenchmarkCommand(
+	TEXT("es.Benchmark.Run"),
+	TEXT("Times preset switches, frame state computation, a 24h time of day sweep, save restores, world time ticks and foot effect notifies, and writes p50/p99 to Saved/Benchmarks. Sections that need rendering are skipped under -nullrhi. Usage: es.Benchmark.Run [Iterations=20] [NumMeshes=64] [Mesh=<SkeletalMeshPath>] [-quit]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunEnvironmentBenchmark));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Runs the benchmark in the first game world with the default settings, e.g. -ExecCmds="Automation RunTests EnvironmentSystem.Benchmark;Quit"
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEnvironmentBenchmarkTest, "EnvironmentSystem.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FEnvironmentBenchmarkTest::RunTest(FString const& Parameters)
+{
+	UWorld* World = nullptr;
+	for(FWorldContext const& Context : GEngine->GetWorldContexts())
+	{
+		if(Context.World() && Context.World()->IsGameWorld())
+		{
+			World = Context.World();
+			break;
+		}
+	}
+
+	if(not TestNotNull(TEXT("Game world"), World))
+	{
+		return false;
+	}
+
+	FString const FileName = RunBenchmark(World, DefaultIterations, DefaultNumMeshes, FString());
+	TestFalse(TEXT("Results written"), FileName.IsEmpty());
+	AddInfo(FString::Printf(TEXT("Wrote %s"), *FileName));
+	return true;
+}
+
+#endif
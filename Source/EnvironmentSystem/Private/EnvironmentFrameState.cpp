@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvironmentFrameState.h"
+
+#include "DynamicSkySystem.h"
+#include "Kismet/KismetMathLibrary.h"
+
+FEnvironmentFrameState FEnvironmentFrameState::Compute(FEnvironmentFrameInputs const& Inputs)
+{
+	FEnvironmentFrameState State;
+
+	float const TrueDawnTime = Inputs.DawnTime - Inputs.DawnTimeOffset;
+	float const TrueDuskTime = Inputs.DuskTime + Inputs.DuskTimeOffset;
+	float const TimeOfDay = Inputs.TimeOfDay;
+
+	State.bIsDaytime = TimeOfDay > TrueDawnTime and TimeOfDay < TrueDuskTime;
+
+	// Sun rotation between dawn and dusk
+	double const SunAngle = UKismetMathLibrary::MapRangeUnclamped(TimeOfDay, Inputs.DawnTime, Inputs.DuskTime, static_cast<double>(ESunPositions::SunRise), static_cast<double>(ESunPositions::SunSet));
+	State.SunRotation = FRotator::MakeFromEuler(FVector{ 0, SunAngle, Inputs.SunMoonRotationYaw });
+
+	// Moon rotation after dusk
+	if(TimeOfDay > TrueDuskTime)
+	{
+		double const MoonAnglePreMidnight = UKismetMathLibrary::MapRangeUnclamped(TimeOfDay, TrueDuskTime, ADynamicSkySystem::Midnight, static_cast<double>(EMoonPositions::MoonRise), static_cast<double>(EMoonPositions::Midnight));
+		State.MoonRotation = FRotator::MakeFromEuler(FVector{ 0, MoonAnglePreMidnight, Inputs.SunMoonRotationYaw });
+		State.bUpdateMoonRotation = true;
+	}
+
+	// Moon rotation before dawn
+	if(TimeOfDay < TrueDawnTime)
+	{
+		double const MoonAnglePostMidnight = UKismetMathLibrary::MapRangeUnclamped(TimeOfDay, 0, TrueDawnTime, static_cast<double>(EMoonPositions::Midnight), static_cast<double>(EMoonPositions::MoonSet));
+		State.MoonRotation = FRotator::MakeFromEuler(FVector{ 0, MoonAnglePostMidnight, Inputs.SunMoonRotationYaw });
+		State.bUpdateMoonRotation = true;
+	}
+
+	if(UWeatherDataAssetBase const* Preset = Inputs.ActivePreset)
+	{
+		State.bHasWeather = true;
+		State.WeatherConfiguration = GetWeatherConfiguration(Inputs, State.bIsDaytime);
+		State.bStarsVisible = not State.bIsDaytime && Preset->bShouldShowStars;
+		State.bMoonVisible = not State.bIsDaytime && Preset->bShouldShowMoon;
+	}
+
+	State.Cloud2DSettings = FLinearColor(
+		Inputs.Cloud2DTiling,
+		Inputs.Cloud2DPanningSpeed,
+		Inputs.Cloud2DBrightness,
+		State.bIsDaytime ? Inputs.DaytimeAtmosphereCloudTint : Inputs.NighttimeAtmosphereCloudTint);
+
+	float const CloudBrightness = State.bIsDaytime ? Inputs.DayVolumetricCloudBrightness : Inputs.NightVolumetricCloudBrightness;
+	State.VolumetricCloudAlbedo = FLinearColor(Inputs.VolumetricCloudTint.R, Inputs.VolumetricCloudTint.G, Inputs.VolumetricCloudTint.B, CloudBrightness);
+	State.VolumetricCloudPanningSpeed = Inputs.VolumetricCloudPanningSpeed;
+
+	return State;
+}
+
+FWeatherConfiguration FEnvironmentFrameState::GetWeatherConfiguration(FEnvironmentFrameInputs const& Inputs, bool const bIsDaytime)
+{
+	auto SelectConfiguration = [bIsDaytime](UWeatherDataAssetBase const* Preset) -> FWeatherConfiguration const&
+	{
+		return bIsDaytime ? Preset->DayTimeConfiguration : Preset->NightTimeConfiguration;
+	};
+
+	UWeatherDataAssetBase const* From = Inputs.BlendFromPreset;
+	UWeatherDataAssetBase const* To = Inputs.BlendToPreset;
+
+	if(not From || not To || Inputs.BlendWeight >= 1.f)
+	{
+		UWeatherDataAssetBase const* Preset = To ? To : Inputs.ActivePreset;
+		return Preset ? SelectConfiguration(Preset) : FWeatherConfiguration{};
+	}
+
+	return FWeatherConfiguration::Lerp(SelectConfiguration(From), SelectConfiguration(To), Inputs.BlendWeight);
+}
@@ -0,0 +1,426 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvironmentRecorderSubsystem.h"
+
+#include "DynamicSkySystem.h"
+#include "EnvironmentSubsystem.h"
+#include "EnvironmentSystemLogging.h"
+#include "EnvironmentSystemSettings.h"
+#include "EnvironmentSystemStats.h"
+#include "LightningComponent.h"
+#include "WeatherAccumulationSubsystem.h"
+#include "WeatherDataAssetBase.h"
+#include "WorldTimeSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Logging/StructuredLog.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+void UEnvironmentRecorderSubsystem::Deinitialize()
+{
+	StopRecording();
+	StopPlayback();
+
+	Super::Deinitialize();
+}
+
+bool UEnvironmentRecorderSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UEnvironmentRecorderSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnvironmentRecorderSubsystem, STATGROUP_EnvironmentSystem);
+}
+
+FString UEnvironmentRecorderSubsystem::GetRecordingPath(FString const& Name)
+{
+	return FPaths::ProjectSavedDir() / TEXT("EnvironmentRecordings") / FPaths::SetExtension(Name, TEXT("envrec"));
+}
+
+ADynamicSkySystem* UEnvironmentRecorderSubsystem::FindSky() const
+{
+	UEnvironmentSubsystem const* Environment = GetWorld()->GetSubsystem<UEnvironmentSubsystem>();
+	return Environment ? Environment->GetSky() : nullptr;
+}
+
+void UEnvironmentRecorderSubsystem::Tick(float DeltaTime)
+{
+	if(not Sky.IsValid())
+	{
+		StopRecording();
+		StopPlayback();
+		return;
+	}
+
+	if(IsRecording())
+	{
+		TimeSinceSample += DeltaTime;
+		if(TimeSinceSample >= Recording->SampleInterval)
+		{
+			TimeSinceSample -= Recording->SampleInterval;
+			RecordSample();
+		}
+	}
+
+	if(IsPlayingBack())
+	{
+		PlaybackTime += DeltaTime;
+		float const Interval = PlaybackRecording->SampleInterval;
+
+		while(bHasNextSample && (CurrentSampleIndex + 1) * Interval <= PlaybackTime)
+		{
+			Swap(CurrentSample, NextSample);
+			++CurrentSampleIndex;
+			ApplySample(CurrentSample, true);
+			bHasNextSample = Reader->ReadSample(NextSample);
+		}
+
+		if(not bHasNextSample && PlaybackTime >= PlaybackRecording->GetDuration())
+		{
+			UE_LOGFMT(EnvironmentSystem, Display, "Environment playback finished after {Seconds}s", PlaybackTime);
+			StopPlayback();
+			return;
+		}
+
+		ApplyTimeOfDay((PlaybackTime - CurrentSampleIndex * Interval) / Interval);
+	}
+}
+
+bool UEnvironmentRecorderSubsystem::StartRecording()
+{
+	StopPlayback();
+	StopRecording();
+
+	ADynamicSkySystem* FoundSky = FindSky();
+	if(not FoundSky)
+	{
+		return false;
+	}
+
+	Sky = FoundSky;
+	Recording = MakeShared<FEnvironmentRecording>();
+
+	if(UWeatherAccumulationSubsystem const* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>())
+	{
+		for(FWeatherAccumulationChannel const& Channel : GetDefault<UEnvironmentSystemSettings>()->AccumulationChannels)
+		{
+			if(Accumulation->FindChannel(Channel.Name) != INDEX_NONE && Recording->Channels.Num() < FEnvironmentRecording::MaxChannels)
+			{
+				Recording->Channels.AddUnique(Channel.Name);
+			}
+		}
+	}
+
+	Writer = MakeUnique<FEnvironmentRecordingWriter>(*Recording);
+	PendingStrikes.Reset();
+	TimeSinceSample = 0.f;
+
+	if(ULightningComponent* Lightning = FoundSky->GetLightning())
+	{
+		StrikeHandle = Lightning->OnLightningStrike.AddUObject(this, &UEnvironmentRecorderSubsystem::HandleLightningStrike);
+	}
+
+	ENVIRONMENT_TRACE_EVENT(TEXT("Environment recording started"));
+	RecordSample();
+	return true;
+}
+
+TSharedPtr<FEnvironmentRecording> UEnvironmentRecorderSubsystem::StopRecording()
+{
+	if(not IsRecording())
+	{
+		return nullptr;
+	}
+
+	if(ULightningComponent* Lightning = Sky.IsValid() ? Sky->GetLightning() : nullptr)
+	{
+		Lightning->OnLightningStrike.Remove(StrikeHandle);
+	}
+
+	Writer.Reset();
+	ENVIRONMENT_TRACE_EVENT(TEXT("Environment recording stopped"));
+
+	return MoveTemp(Recording);
+}
+
+void UEnvironmentRecorderSubsystem::HandleLightningStrike(FVector const Location, float const Distance)
+{
+	PendingStrikes.Add(Location);
+}
+
+void UEnvironmentRecorderSubsystem::RecordSample()
+{
+	ADynamicSkySystem const* RecordedSky = Sky.Get();
+
+	FEnvironmentRecordingSample Sample;
+	Sample.TimeOfDay = RecordedSky->GetTimeOfDay();
+	Sample.TransitionProgress = RecordedSky->GetWeatherTransitionProgress();
+	Sample.LightningStrikes = MoveTemp(PendingStrikes);
+	PendingStrikes.Reset();
+
+	if(UWeatherDataAssetBase const* Preset = RecordedSky->GetWeatherPreset())
+	{
+		Sample.PresetIndex = Recording->Presets.AddUnique(FSoftObjectPath(Preset));
+	}
+
+	if(UWorldTimeSubsystem const* WorldTime = GetWorld()->GetSubsystem<UWorldTimeSubsystem>())
+	{
+		Sample.WorldDateTime = WorldTime->GetWorldDateTime();
+	}
+
+	if(UWeatherAccumulationSubsystem const* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>())
+	{
+		for(FName const Channel : Recording->Channels)
+		{
+			Sample.AccumulationValues.Add(Accumulation->GetChannelValue(Channel));
+		}
+	}
+
+	Writer->AddSample(Sample);
+}
+
+bool UEnvironmentRecorderSubsystem::StartPlayback(TSharedRef<FEnvironmentRecording const> NewRecording)
+{
+	StopRecording();
+	StopPlayback();
+
+	ADynamicSkySystem* FoundSky = FindSky();
+	if(not FoundSky || NewRecording->GetNumSamples() == 0)
+	{
+		return false;
+	}
+
+	Sky = FoundSky;
+	PlaybackRecording = NewRecording;
+	Reader = MakeUnique<FEnvironmentRecordingReader>(*PlaybackRecording);
+
+	PlaybackPresets.Reset();
+	for(FSoftObjectPath const& Path : PlaybackRecording->Presets)
+	{
+		PlaybackPresets.Add(Cast<UWeatherDataAssetBase>(Path.TryLoad()));
+	}
+
+	// The recording decides when time moves and where lightning strikes
+	if(UWorldTimeSubsystem* WorldTime = GetWorld()->GetSubsystem<UWorldTimeSubsystem>())
+	{
+		SavedTickRate = WorldTime->GetTickRate();
+		WorldTime->SetTickRate(FTimespan::Zero());
+	}
+
+	if(ULightningComponent* Lightning = FoundSky->GetLightning())
+	{
+		Lightning->SetAutomaticStrikes(false);
+	}
+
+	ENVIRONMENT_TRACE_EVENT(TEXT("Environment playback started"));
+	Seek(0.f);
+	return true;
+}
+
+void UEnvironmentRecorderSubsystem::StopPlayback()
+{
+	if(not IsPlayingBack())
+	{
+		return;
+	}
+
+	if(UWorldTimeSubsystem* WorldTime = GetWorld()->GetSubsystem<UWorldTimeSubsystem>())
+	{
+		WorldTime->SetTickRate(SavedTickRate);
+	}
+
+	if(ULightningComponent* Lightning = Sky.IsValid() ? Sky->GetLightning() : nullptr)
+	{
+		Lightning->SetAutomaticStrikes(true);
+	}
+
+	Reader.Reset();
+	PlaybackRecording.Reset();
+	PlaybackPresets.Reset();
+	ENVIRONMENT_TRACE_EVENT(TEXT("Environment playback stopped"));
+}
+
+void UEnvironmentRecorderSubsystem::Seek(float const Time)
+{
+	if(not IsPlayingBack())
+	{
+		return;
+	}
+
+	int32 const LastSample = PlaybackRecording->GetNumSamples() - 1;
+	CurrentSampleIndex = FMath::Clamp(FMath::FloorToInt32(Time / PlaybackRecording->SampleInterval), 0, LastSample);
+	PlaybackTime = FMath::Clamp(Time, 0.f, PlaybackRecording->GetDuration());
+
+	if(not Reader->Seek(CurrentSampleIndex) || not Reader->ReadSample(CurrentSample))
+	{
+		UE_LOGFMT(EnvironmentSystem, Error, "Environment recording is corrupt at sample {Sample}", CurrentSampleIndex);
+		StopPlayback();
+		return;
+	}
+
+	// Strikes from before the seek would all flash at once
+	ApplySample(CurrentSample, false);
+	bHasNextSample = Reader->ReadSample(NextSample);
+	ApplyTimeOfDay((PlaybackTime - CurrentSampleIndex * PlaybackRecording->SampleInterval) / PlaybackRecording->SampleInterval);
+}
+
+void UEnvironmentRecorderSubsystem::ApplySample(FEnvironmentRecordingSample const& Sample, bool const bTriggerLightning)
+{
+	ADynamicSkySystem* PlaybackSky = Sky.Get();
+
+	// The preset restarts the transition, so it goes first
+	if(PlaybackPresets.IsValidIndex(Sample.PresetIndex) && PlaybackPresets[Sample.PresetIndex])
+	{
+		PlaybackSky->SetWeatherPreset(PlaybackPresets[Sample.PresetIndex]);
+	}
+	PlaybackSky->SetWeatherTransitionProgress(Sample.TransitionProgress);
+	PlaybackSky->SetTimeOfDay(Sample.TimeOfDay);
+
+	// Advancing the world time also advances the accumulation, which is then corrected to the recorded values
+	if(UWorldTimeSubsystem* WorldTime = GetWorld()->GetSubsystem<UWorldTimeSubsystem>())
+	{
+		WorldTime->SetWorldDateTime(Sample.WorldDateTime);
+	}
+
+	if(UWeatherAccumulationSubsystem* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>())
+	{
+		for(int32 i = 0; i < PlaybackRecording->Channels.Num() && i < Sample.AccumulationValues.Num(); ++i)
+		{
+			Accumulation->SetChannelValue(PlaybackRecording->Channels[i], Sample.AccumulationValues[i]);
+		}
+	}
+
+	ULightningComponent* Lightning = PlaybackSky->GetLightning();
+	if(bTriggerLightning && Lightning)
+	{
+		for(FVector const& Strike : Sample.LightningStrikes)
+		{
+			Lightning->TriggerStrike(Strike);
+		}
+	}
+}
+
+void UEnvironmentRecorderSubsystem::ApplyTimeOfDay(float const Alpha)
+{
+	if(not bHasNextSample)
+	{
+		return;
+	}
+
+	// Between samples the sun moves smoothly, the shorter way around midnight
+	float Delta = NextSample.TimeOfDay - CurrentSample.TimeOfDay;
+	Delta -= Delta > ADynamicSkySystem::Midnight * .5f ? ADynamicSkySystem::Midnight : 0.f;
+	Delta += Delta < -ADynamicSkySystem::Midnight * .5f ? ADynamicSkySystem::Midnight : 0.f;
+
+	float const TimeOfDay = FMath::Fmod(CurrentSample.TimeOfDay + Delta * FMath::Clamp(Alpha, 0.f, 1.f) + ADynamicSkySystem::Midnight, ADynamicSkySystem::Midnight);
+	Sky->SetTimeOfDay(TimeOfDay);
+}
+
+static void StartEnvironmentRecording(TArray<FString> const& Args, UWorld* World)
+{
+	UEnvironmentRecorderSubsystem* Recorder = World ? World->GetSubsystem<UEnvironmentRecorderSubsystem>() : nullptr;
+	if(not Recorder || not Recorder->StartRecording())
+	{
+		UE_LOGFMT(EnvironmentSystem, Warning, "es.Recording.Start: needs a game world with a dynamic sky");
+	}
+}
+
+static void StopEnvironmentRecording(TArray<FString> const& Args, UWorld* World)
+{
+	UEnvironmentRecorderSubsystem* Recorder = World ? World->GetSubsystem<UEnvironmentRecorderSubsystem>() : nullptr;
+	if(not Recorder)
+	{
+		return;
+	}
+
+	if(Recorder->IsPlayingBack())
+	{
+		Recorder->StopPlayback();
+		return;
+	}
+
+	TSharedPtr<FEnvironmentRecording> Recording = Recorder->StopRecording();
+	if(not Recording)
+	{
+		return;
+	}
+
+	FString const Name = Args.Num() > 0 ? Args[0] : FString::Printf(TEXT("Environment-%s"), *FDateTime::Now().ToString());
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << *Recording;
+
+	FString const FileName = UEnvironmentRecorderSubsystem::GetRecordingPath(Name);
+	if(FFileHelper::SaveArrayToFile(Bytes, *FileName))
+	{
+		float const Duration = FMath::Max(Recording->GetDuration(), Recording->SampleInterval);
+		UE_LOGFMT(EnvironmentSystem, Display, "es.Recording.Stop: wrote {File}, {Seconds}s in {Bytes} bytes ({BytesPerSecond} bytes/s)",
+			FileName, Recording->GetDuration(), Recording->GetNumBytes(), Recording->GetNumBytes() / Duration);
+	}
+	else
+	{
+		UE_LOGFMT(EnvironmentSystem, Error, "es.Recording.Stop: could not write {File}", FileName);
+	}
+}
+
+static void PlayEnvironmentRecording(TArray<FString> const& Args, UWorld* World)
+{
+	UEnvironmentRecorderSubsystem* Recorder = World ? World->GetSubsystem<UEnvironmentRecorderSubsystem>() : nullptr;
+	if(not Recorder || Args.IsEmpty())
+	{
+		UE_LOGFMT(EnvironmentSystem, Warning, "Usage: es.Recording.Play <Name>");
+		return;
+	}
+
+	FString const FileName = UEnvironmentRecorderSubsystem::GetRecordingPath(Args[0]);
+	TArray<uint8> Bytes;
+	if(not FFileHelper::LoadFileToArray(Bytes, *FileName))
+	{
+		UE_LOGFMT(EnvironmentSystem, Error, "es.Recording.Play: could not read {File}", FileName);
+		return;
+	}
+
+	TSharedRef<FEnvironmentRecording> Recording = MakeShared<FEnvironmentRecording>();
+	FMemoryReader Reader(Bytes);
+	Reader << *Recording;
+
+	if(Reader.IsError() || not Recorder->StartPlayback(Recording))
+	{
+		UE_LOGFMT(EnvironmentSystem, Error, "es.Recording.Play: could not play {File}", FileName);
+	}
+}
+
+static void SeekEnvironmentRecording(TArray<FString> const& Args, UWorld* World)
+{
+	UEnvironmentRecorderSubsystem* Recorder = World ? World->GetSubsystem<UEnvironmentRecorderSubsystem>() : nullptr;
+	if(Recorder && not Args.IsEmpty())
+	{
+		Recorder->Seek(FCString::Atof(*Args[0]));
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs StartEnvironmentRecordingCommand(
+	TEXT("es.Recording.Start"),
+	TEXT("Starts recording the time, weather, accumulation and lightning of the sky."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartEnvironmentRecording));
+
+static FAutoConsoleCommandWithWorldAndArgs StopEnvironmentRecordingCommand(
+	TEXT("es.Recording.Stop"),
+	TEXT("Stops the playback, or stops the recording and writes it to Saved/EnvironmentRecordings. Usage: es.Recording.Stop [Name]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StopEnvironmentRecording));
+
+static FAutoConsoleCommandWithWorldAndArgs PlayEnvironmentRecordingCommand(
+	TEXT("es.Recording.Play"),
+	TEXT("Plays a recording from Saved/EnvironmentRecordings. Usage: es.Recording.Play <Name>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&PlayEnvironmentRecording));
+
+static FAutoConsoleCommandWithWorldAndArgs SeekEnvironmentRecordingCommand(
+	TEXT("es.Recording.Seek"),
+	TEXT("Jumps the playback to a time in seconds. Usage: es.Recording.Seek <Seconds>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SeekEnvironmentRecording));
@@ -0,0 +1,356 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvironmentRecording.h"
+
+#include "DynamicSkySystem.h"
+#include "Misc/Timespan.h"
+
+namespace
+{
+	// Each sample starts with a byte of these flags, followed by the values that changed in this order
+	enum ESampleFields : uint8
+	{
+		TimeOfDayField = 1 << 0,
+		WorldTimeField = 1 << 1,
+		PresetField = 1 << 2,
+		TransitionField = 1 << 3,
+		AccumulationField = 1 << 4,
+		LightningField = 1 << 5,
+		StateFields = TimeOfDayField | WorldTimeField | PresetField | TransitionField | AccumulationField
+	};
+
+	// Lightning strikes are stored in whole meters
+	constexpr double StrikeLocationScale = 100.;
+
+	void WriteVarUInt(TArray<uint8>& Data, uint64 Value)
+	{
+		while(Value >= 0x80)
+		{
+			Data.Add(static_cast<uint8>(Value) | 0x80);
+			Value >>= 7;
+		}
+		Data.Add(static_cast<uint8>(Value));
+	}
+
+	// Zigzag encoding keeps small negative deltas small
+	void WriteVarInt(TArray<uint8>& Data, int64 const Value)
+	{
+		WriteVarUInt(Data, (static_cast<uint64>(Value) << 1) ^ static_cast<uint64>(Value >> 63));
+	}
+
+	class FByteReader
+	{
+	public:
+		FByteReader(TArray<uint8> const& InData, int32& InOffset) : Data(InData), Offset(InOffset) {}
+
+		uint8 ReadByte()
+		{
+			if(Offset >= Data.Num())
+			{
+				bError = true;
+				return 0;
+			}
+			return Data[Offset++];
+		}
+
+		uint64 ReadVarUInt()
+		{
+			uint64 Value = 0;
+			for(int32 Shift = 0; Shift < 64 && not bError; Shift += 7)
+			{
+				uint8 const Byte = ReadByte();
+				Value |= static_cast<uint64>(Byte & 0x7f) << Shift;
+				if((Byte & 0x80) == 0)
+				{
+					return Value;
+				}
+			}
+			bError = true;
+			return 0;
+		}
+
+		int64 ReadVarInt()
+		{
+			uint64 const Value = ReadVarUInt();
+			return static_cast<int64>(Value >> 1) ^ -static_cast<int64>(Value & 1);
+		}
+
+		bool HasError() const { return bError; }
+
+	private:
+		TArray<uint8> const& Data;
+		int32& Offset;
+		bool bError { false };
+	};
+
+	FEnvironmentRecordingState MakeKeyframeBase(int32 const NumChannels)
+	{
+		FEnvironmentRecordingState State;
+		State.AccumulationValues.Init(0, NumChannels);
+		return State;
+	}
+
+	FEnvironmentRecordingState Quantize(FEnvironmentRecordingSample const& Sample, int32 const NumChannels)
+	{
+		FEnvironmentRecordingState State;
+		State.TimeOfDay = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(Sample.TimeOfDay / ADynamicSkySystem::Midnight * MAX_uint16), 0, MAX_uint16));
+		State.WorldSeconds = Sample.WorldDateTime.GetTicks() / ETimespan::TicksPerSecond;
+		State.PresetIndex = Sample.PresetIndex;
+		State.TransitionProgress = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Sample.TransitionProgress * MAX_uint8), 0, MAX_uint8));
+
+		State.AccumulationValues.SetNumUninitialized(NumChannels);
+		for(int32 i = 0; i < NumChannels; ++i)
+		{
+			float const Value = Sample.AccumulationValues.IsValidIndex(i) ? Sample.AccumulationValues[i] : 0.f;
+			State.AccumulationValues[i] = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Value * MAX_uint8), 0, MAX_uint8));
+		}
+
+		return State;
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FEnvironmentRecording& Recording)
+{
+	uint32 Version = FEnvironmentRecording::Version;
+	Ar << Version;
+	if(Ar.IsLoading() && Version != FEnvironmentRecording::Version)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	Ar << Recording.SampleInterval;
+	Ar << Recording.SamplesPerKeyframe;
+	Ar << Recording.Presets;
+	Ar << Recording.Channels;
+	Ar << Recording.NumSamples;
+	Ar << Recording.Data;
+	Ar << Recording.KeyframeOffsets;
+
+	if(not Ar.IsLoading())
+	{
+		return Ar;
+	}
+
+	if(Recording.SamplesPerKeyframe <= 0 || Recording.SampleInterval <= 0.f || Recording.Channels.Num() > FEnvironmentRecording::MaxChannels || Recording.NumSamples < 0)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	// Seek jumps to the offsets without further checks, every sample from the first of a keyframe on starts one
+	int32 const NumKeyframes = FMath::DivideAndRoundUp(Recording.NumSamples, Recording.SamplesPerKeyframe);
+	if(Recording.KeyframeOffsets.Num() != NumKeyframes)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	for(int32 i = 0; i < NumKeyframes; ++i)
+	{
+		int32 const Offset = Recording.KeyframeOffsets[i];
+		if(Offset < 0 || Offset >= Recording.Data.Num() || (i > 0 && Offset <= Recording.KeyframeOffsets[i - 1]))
+		{
+			Ar.SetError();
+			return Ar;
+		}
+	}
+
+	return Ar;
+}
+
+FEnvironmentRecordingWriter::FEnvironmentRecordingWriter(FEnvironmentRecording& InRecording)
+	: Recording(InRecording)
+{
+	check(Recording.Channels.Num() <= FEnvironmentRecording::MaxChannels);
+}
+
+void FEnvironmentRecordingWriter::AddSample(FEnvironmentRecordingSample const& Sample)
+{
+	TArray<uint8>& Data = Recording.Data;
+	int32 const NumChannels = Recording.Channels.Num();
+
+	// A keyframe is a delta against an empty state with every value present
+	bool const bIsKeyframe = Recording.NumSamples % Recording.SamplesPerKeyframe == 0;
+	if(bIsKeyframe)
+	{
+		Recording.KeyframeOffsets.Add(Data.Num());
+		Previous = MakeKeyframeBase(NumChannels);
+	}
+
+	FEnvironmentRecordingState State = Quantize(Sample, NumChannels);
+
+	uint64 ChangedChannels = 0;
+	for(int32 i = 0; i < NumChannels; ++i)
+	{
+		ChangedChannels |= State.AccumulationValues[i] != Previous.AccumulationValues[i] ? uint64(1) << i : 0;
+	}
+
+	uint8 Fields = bIsKeyframe ? StateFields : 0;
+	Fields |= State.TimeOfDay != Previous.TimeOfDay ? TimeOfDayField : 0;
+	Fields |= State.WorldSeconds != Previous.WorldSeconds ? WorldTimeField : 0;
+	Fields |= State.PresetIndex != Previous.PresetIndex ? PresetField : 0;
+	Fields |= State.TransitionProgress != Previous.TransitionProgress ? TransitionField : 0;
+	Fields |= ChangedChannels != 0 ? AccumulationField : 0;
+	Fields |= not Sample.LightningStrikes.IsEmpty() ? LightningField : 0;
+
+	Data.Add(Fields);
+
+	if(Fields & TimeOfDayField)
+	{
+		// Wraps around at midnight
+		WriteVarInt(Data, static_cast<int16>(static_cast<uint16>(State.TimeOfDay - Previous.TimeOfDay)));
+	}
+
+	if(Fields & WorldTimeField)
+	{
+		WriteVarInt(Data, State.WorldSeconds - Previous.WorldSeconds);
+	}
+
+	if(Fields & PresetField)
+	{
+		WriteVarInt(Data, State.PresetIndex);
+	}
+
+	if(Fields & TransitionField)
+	{
+		Data.Add(State.TransitionProgress);
+	}
+
+	if(Fields & AccumulationField)
+	{
+		WriteVarUInt(Data, ChangedChannels);
+		for(int32 i = 0; i < NumChannels; ++i)
+		{
+			if(ChangedChannels & (uint64(1) << i))
+			{
+				Data.Add(State.AccumulationValues[i]);
+			}
+		}
+	}
+
+	if(Fields & LightningField)
+	{
+		WriteVarUInt(Data, Sample.LightningStrikes.Num());
+		for(FVector const& Strike : Sample.LightningStrikes)
+		{
+			WriteVarInt(Data, FMath::RoundToInt64(Strike.X / StrikeLocationScale));
+			WriteVarInt(Data, FMath::RoundToInt64(Strike.Y / StrikeLocationScale));
+			WriteVarInt(Data, FMath::RoundToInt64(Strike.Z / StrikeLocationScale));
+		}
+	}
+
+	Previous = MoveTemp(State);
+	++Recording.NumSamples;
+}
+
+FEnvironmentRecordingReader::FEnvironmentRecordingReader(FEnvironmentRecording const& InRecording)
+	: Recording(InRecording)
+{
+}
+
+bool FEnvironmentRecordingReader::Seek(int32 const SampleIndex)
+{
+	int32 const Keyframe = SampleIndex / Recording.SamplesPerKeyframe;
+	if(SampleIndex < 0 || SampleIndex >= Recording.NumSamples || not Recording.KeyframeOffsets.IsValidIndex(Keyframe))
+	{
+		return false;
+	}
+
+	Offset = Recording.KeyframeOffsets[Keyframe];
+	NextSample = Keyframe * Recording.SamplesPerKeyframe;
+
+	FEnvironmentRecordingSample Skipped;
+	while(NextSample < SampleIndex)
+	{
+		if(not ReadSample(Skipped))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FEnvironmentRecordingReader::ReadSample(FEnvironmentRecordingSample& OutSample)
+{
+	if(NextSample >= Recording.NumSamples)
+	{
+		return false;
+	}
+
+	int32 const NumChannels = Recording.Channels.Num();
+	if(NextSample % Recording.SamplesPerKeyframe == 0)
+	{
+		Current = MakeKeyframeBase(NumChannels);
+	}
+
+	FByteReader Reader(Recording.Data, Offset);
+	uint8 const Fields = Reader.ReadByte();
+
+	if(Fields & TimeOfDayField)
+	{
+		Current.TimeOfDay = static_cast<uint16>(Current.TimeOfDay + static_cast<int16>(Reader.ReadVarInt()));
+	}
+
+	if(Fields & WorldTimeField)
+	{
+		Current.WorldSeconds += Reader.ReadVarInt();
+	}
+
+	if(Fields & PresetField)
+	{
+		Current.PresetIndex = static_cast<int32>(Reader.ReadVarInt());
+	}
+
+	if(Fields & TransitionField)
+	{
+		Current.TransitionProgress = Reader.ReadByte();
+	}
+
+	if(Fields & AccumulationField)
+	{
+		uint64 const ChangedChannels = Reader.ReadVarUInt();
+		for(int32 i = 0; i < NumChannels; ++i)
+		{
+			if(ChangedChannels & (uint64(1) << i))
+			{
+				Current.AccumulationValues[i] = Reader.ReadByte();
+			}
+		}
+	}
+
+	OutSample.LightningStrikes.Reset();
+	if(Fields & LightningField)
+	{
+		uint64 const NumStrikes = Reader.ReadVarUInt();
+		for(uint64 i = 0; i < NumStrikes && not Reader.HasError(); ++i)
+		{
+			double const X = Reader.ReadVarInt() * StrikeLocationScale;
+			double const Y = Reader.ReadVarInt() * StrikeLocationScale;
+			double const Z = Reader.ReadVarInt() * StrikeLocationScale;
+			OutSample.LightningStrikes.Add(FVector(X, Y, Z));
+		}
+	}
+
+	if(Reader.HasError())
+	{
+		NextSample = Recording.NumSamples;
+		return false;
+	}
+
+	OutSample.TimeOfDay = static_cast<float>(Current.TimeOfDay) / MAX_uint16 * ADynamicSkySystem::Midnight;
+	OutSample.WorldDateTime = FDateTime(Current.WorldSeconds * ETimespan::TicksPerSecond);
+	OutSample.PresetIndex = Current.PresetIndex;
+	OutSample.TransitionProgress = static_cast<float>(Current.TransitionProgress) / MAX_uint8;
+
+	OutSample.AccumulationValues.SetNumUninitialized(NumChannels);
+	for(int32 i = 0; i < NumChannels; ++i)
+	{
+		OutSample.AccumulationValues[i] = static_cast<float>(Current.AccumulationValues[i]) / MAX_uint8;
+	}
+
+	++NextSample;
+	return true;
+}
@@ -0,0 +1,223 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvironmentSubsystem.h"
+
+#include "DynamicSkySystem.h"
+#include "EnvironmentSystemLogging.h"
+#include "EnvironmentSystemStats.h"
+#include "SolarEventSubsystem.h"
+#include "WeatherAccumulationSubsystem.h"
+#include "WeatherDataAssetBase.h"
+#include "WorldTimeSubsystem.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Logging/StructuredLog.h"
+
+void UEnvironmentSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldTime = Collection.InitializeDependency<UWorldTimeSubsystem>();
+}
+
+void UEnvironmentSubsystem::Deinitialize()
+{
+	Skies.Empty();
+	ActiveSky = nullptr;
+	WorldTime = nullptr;
+	PendingSnapshot.Reset();
+	WeatherState = {};
+
+	Super::Deinitialize();
+}
+
+bool UEnvironmentSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UEnvironmentSubsystem::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(InThis, Collector);
+
+	// The cached state can outlive the presets of the sky until the next frame
+	UEnvironmentSubsystem* This = CastChecked<UEnvironmentSubsystem>(InThis);
+	Collector.AddReferencedObject(This->WeatherState.ActivePreset);
+	Collector.AddReferencedObject(This->WeatherState.GlobalPreset);
+}
+
+bool UEnvironmentSubsystem::RegisterSky(ADynamicSkySystem* Sky)
+{
+	if(not Sky)
+	{
+		return false;
+	}
+
+	Skies.AddUnique(Sky);
+	UpdateActiveSky();
+
+	return ActiveSky == Sky;
+}
+
+void UEnvironmentSubsystem::UnregisterSky(ADynamicSkySystem* Sky)
+{
+	Skies.Remove(Sky);
+	if(ActiveSky == Sky)
+	{
+		ActiveSky = nullptr;
+	}
+
+	// No sky takes over while the world shuts down
+	if(not GetWorld()->bIsTearingDown)
+	{
+		UpdateActiveSky();
+	}
+}
+
+void UEnvironmentSubsystem::UpdateActiveSky()
+{
+	Skies.RemoveAll([](TWeakObjectPtr<ADynamicSkySystem> const& Sky) { return not Sky.IsValid(); });
+
+	// The persistent level outranks streamed levels, which come and go with the camera
+	ADynamicSkySystem* NewSky = ActiveSky.Get();
+	for(TWeakObjectPtr<ADynamicSkySystem> const& Sky : Skies)
+	{
+		if(not NewSky || (Sky->GetLevel()->IsPersistentLevel() && not NewSky->GetLevel()->IsPersistentLevel()))
+		{
+			NewSky = Sky.Get();
+		}
+	}
+
+	for(TWeakObjectPtr<ADynamicSkySystem> const& Sky : Skies)
+	{
+		if(Sky != NewSky && Sky->IsActiveSky())
+		{
+			UE_LOGFMT(EnvironmentSystem, Warning, "{Sky} stands by, {ActiveSky} is the active sky of the world", Sky->GetName(), NewSky->GetName());
+			Sky->SetIsActiveSky(false);
+		}
+	}
+
+	if(NewSky != ActiveSky)
+	{
+		ActiveSky = NewSky;
+		if(NewSky)
+		{
+			NewSky->SetIsActiveSky(true);
+		}
+
+		// Dawn and dusk of the new sky move the solar events
+		if(USolarEventSubsystem* SolarEvents = GetWorld()->GetSubsystem<USolarEventSubsystem>())
+		{
+			SolarEvents->Reschedule();
+		}
+
+		WeatherStateFrame = MAX_uint64;
+	}
+}
+
+FEnvironmentSnapshot UEnvironmentSubsystem::CaptureSnapshot() const
+{
+	FEnvironmentSnapshot Snapshot;
+
+	if(WorldTime)
+	{
+		Snapshot.WorldDateTime = WorldTime->GetWorldDateTime();
+	}
+
+	if(ADynamicSkySystem const* Sky = ActiveSky.Get())
+	{
+		Snapshot.TimeOfDay = Sky->GetTimeOfDay();
+		Snapshot.Preset = Sky->GetWeatherPreset();
+		Snapshot.TransitionProgress = Sky->GetWeatherTransitionProgress();
+	}
+
+	if(UWeatherAccumulationSubsystem const* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>())
+	{
+		Snapshot.AccumulationResolution = Accumulation->GetResolution();
+		Accumulation->SaveValues(Snapshot.AccumulationChannels, Snapshot.AccumulationValues);
+	}
+
+	return Snapshot;
+}
+
+void UEnvironmentSubsystem::RestoreSnapshot(FEnvironmentSnapshot const& Snapshot)
+{
+	if(ADynamicSkySystem* Sky = ActiveSky.Get(); Sky && Sky->HasActorBegunPlay())
+	{
+		ApplySnapshot(Sky, Snapshot);
+	}
+	else
+	{
+		PendingSnapshot = Snapshot;
+	}
+}
+
+bool UEnvironmentSubsystem::RestorePendingSnapshot()
+{
+	ADynamicSkySystem* Sky = ActiveSky.Get();
+	if(not Sky || not PendingSnapshot.IsSet())
+	{
+		return false;
+	}
+
+	ApplySnapshot(Sky, PendingSnapshot.GetValue());
+	PendingSnapshot.Reset();
+	return true;
+}
+
+void UEnvironmentSubsystem::ApplySnapshot(ADynamicSkySystem* Sky, FEnvironmentSnapshot const& Snapshot)
+{
+	// Time and surface layers first, so the sky finds them in place and nothing has to catch up
+	if(WorldTime)
+	{
+		WorldTime->RestoreWorldDateTime(Snapshot.WorldDateTime);
+	}
+
+	if(UWeatherAccumulationSubsystem* Accumulation = GetWorld()->GetSubsystem<UWeatherAccumulationSubsystem>(); Accumulation && not Snapshot.AccumulationChannels.IsEmpty())
+	{
+		Accumulation->LoadValues(Snapshot.AccumulationChannels, Snapshot.AccumulationValues, Snapshot.AccumulationResolution);
+	}
+
+	Sky->RestoreEnvironment(Snapshot.Preset.LoadSynchronous(), Snapshot.TimeOfDay, Snapshot.TransitionProgress);
+	WeatherStateFrame = MAX_uint64;
+}
+
+FEnvironmentWeatherState const& UEnvironmentSubsystem::GetWeatherState() const
+{
+	if(WeatherStateFrame == GFrameCounter)
+	{
+		return WeatherState;
+	}
+
+	WeatherStateFrame = GFrameCounter;
+	WeatherState = {};
+
+	if(WorldTime)
+	{
+		WeatherState.WorldDateTime = WorldTime->GetWorldDateTime();
+	}
+
+	ADynamicSkySystem const* Sky = ActiveSky.Get();
+	if(not Sky)
+	{
+		return WeatherState;
+	}
+
+	WeatherState.bHasSky = true;
+	WeatherState.ActivePreset = Sky->GetActiveWeatherPreset();
+	WeatherState.GlobalPreset = Sky->GetWeatherPreset();
+	WeatherState.TransitionProgress = Sky->GetWeatherTransitionProgress();
+	WeatherState.TimeOfDay = Sky->GetTimeOfDay();
+	WeatherState.bIsDaytime = Sky->IsDaytime();
+
+	if(WeatherState.ActivePreset)
+	{
+		WeatherState.PrecipitationType = WeatherState.ActivePreset->GetPrecipitationType();
+		WeatherState.PrecipitationIntensity = WeatherState.PrecipitationType != EPrecipitationType::None
+			? WeatherState.ActivePreset->PrecipitationIntensity * Sky->GetPrecipitationScale()
+			: 0.f;
+	}
+
+	return WeatherState;
+}
@@ -1,7 +1,10 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "EnvironmentSystem.h"
+#include "EnvironmentSystemCustomVersion.h"
 #include "EnvironmentSystemLogging.h"
+#include "EnvironmentSystemStats.h"
+#include "Serialization/CustomVersion.h"
 
 #define LOCTEXT_NAMESPACE "FEnvironmentSystemModule"
 
@@ -20,4 +23,38 @@ void FEnvironmentSystemModule::ShutdownModule()
 	
 IMPLEMENT_MODULE(FEnvironmentSystemModule, EnvironmentSystem)
 
-DEFINE_LOG_CATEGORY(EnvironmentSystem);
\ No newline at end of file
+DEFINE_LOG_CATEGORY(EnvironmentSystem);
+
+const FGuid FEnvironmentSystemCustomVersion::GUID(0xAA8E6145, 0x37A04F31, 0x930604FB, 0xF2BA6F4F);
+FCustomVersionRegistration GRegisterEnvironmentSystemCustomVersion(FEnvironmentSystemCustomVersion::GUID, FEnvironmentSystemCustomVersion::LatestVersion, TEXT("EnvironmentSystem"));
+
+DEFINE_STAT(STAT_EnvironmentSystem_InitSubsystems);
+DEFINE_STAT(STAT_EnvironmentSystem_SetWeatherEffects);
+DEFINE_STAT(STAT_EnvironmentSystem_SetWeatherLightProperties);
+DEFINE_STAT(STAT_EnvironmentSystem_HandleSunAndMoonRotation);
+DEFINE_STAT(STAT_EnvironmentSystem_ComputeFrameState);
+DEFINE_STAT(STAT_EnvironmentSystem_ApplyFrameState);
+DEFINE_STAT(STAT_EnvironmentSystem_WorldTimeTick);
+DEFINE_STAT(STAT_EnvironmentSystem_FootEffectsNotify);
+DEFINE_STAT(STAT_EnvironmentSystem_WeatherAccumulation);
+DEFINE_STAT(STAT_EnvironmentSystem_RestoreEnvironment);
+DEFINE_STAT(STAT_EnvironmentSystem_BuildSeasonCalendar);
+DEFINE_STAT(STAT_EnvironmentSystem_WeatherCover);
+
+DEFINE_STAT(STAT_EnvironmentSystem_Footsteps);
+DEFINE_STAT(STAT_EnvironmentSystem_Traces);
+DEFINE_STAT(STAT_EnvironmentSystem_NiagaraSpawns);
+DEFINE_STAT(STAT_EnvironmentSystem_MPCWrites);
+DEFINE_STAT(STAT_EnvironmentSystem_PrimitiveDataWrites);
+
+LLM_DEFINE_TAG(EnvironmentSystem);
+LLM_DEFINE_TAG(EnvironmentSystem_Sky, TEXT("Sky"), TEXT("EnvironmentSystem"));
+LLM_DEFINE_TAG(EnvironmentSystem_Clouds, TEXT("Clouds"), TEXT("EnvironmentSystem"));
+LLM_DEFINE_TAG(EnvironmentSystem_WeatherEffects, TEXT("WeatherEffects"), TEXT("EnvironmentSystem"));
+LLM_DEFINE_TAG(EnvironmentSystem_Footprints, TEXT("Footprints"), TEXT("EnvironmentSystem"));
+LLM_DEFINE_TAG(EnvironmentSystem_Time, TEXT("Time"), TEXT("EnvironmentSystem"));
+LLM_DEFINE_TAG(EnvironmentSystem_Presets, TEXT("Presets"), TEXT("EnvironmentSystem"));
+
+CSV_DEFINE_CATEGORY_MODULE(ENVIRONMENTSYSTEM_API, EnvironmentSystem, false);
+
+UE_TRACE_CHANNEL_DEFINE(EnvironmentSystemChannel);
\ No newline at end of file
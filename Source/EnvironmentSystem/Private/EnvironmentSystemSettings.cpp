@@ -4,4 +4,74 @@ UEnvironmentSystemSettings::UEnvironmentSystemSettings(FObjectInitializer const&
 {
 	CategoryName = "Project";
 	SectionName = "Environment System";
+
+	auto AddChannel = [this](FName const Name, FName const LegacyScalarParameterName) -> FWeatherAccumulationChannel&
+	{
+		FWeatherAccumulationChannel& Channel = AccumulationChannels.AddDefaulted_GetRef();
+		Channel.Name = Name;
+		Channel.LegacyScalarParameterName = LegacyScalarParameterName;
+		return Channel;
+	};
+
+	// Snow melts with warmth and sun, water drains and evaporates in the sun, ripples stop with the rain
+	FWeatherAccumulationChannel& Snow = AddChannel("Snow", "SnowStrength");
+	Snow.DecayRate = 0.f;
+	Snow.MeltRate = .02f;
+	Snow.SunMeltRate = .05f;
+
+	FWeatherAccumulationChannel& Wetness = AddChannel("Wetness", NAME_None);
+	Wetness.DecayRate = .1f;
+	Wetness.SunDecayRate = .5f;
+
+	FWeatherAccumulationChannel& Puddles = AddChannel("Puddles", "ShowPuddles");
+	Puddles.DecayRate = .05f;
+	Puddles.SunDecayRate = .2f;
+
+	FWeatherAccumulationChannel& Ripples = AddChannel("Ripples", "ShowRipples");
+	Ripples.DecayRate = 30.f;
+
+	DensityParameterNames = { "SpawnRate" };
+	EffectsQualityDensities = { .25f, .5f, .75f, 1.f, 1.f };
+
+	auto AddSeason = [this](FName const Name, int32 const StartDayOfYear, float const DayLength, float const MinTemperature, float const MaxTemperature,
+		float const FoliageDensity, FLinearColor const FoliageTint) -> FSeasonDefinition&
+	{
+		FSeasonDefinition& Season = Seasons.AddDefaulted_GetRef();
+		Season.Name = Name;
+		Season.StartDayOfYear = StartDayOfYear;
+		Season.DayLength = DayLength;
+		Season.MinTemperature = MinTemperature;
+		Season.MaxTemperature = MaxTemperature;
+		Season.ScalarParameters.Add("SeasonFoliageDensity", FoliageDensity);
+		Season.VectorParameters.Add("SeasonFoliageTint", FoliageTint);
+		return Season;
+	};
+
+	auto AddWeather = [](FSeasonDefinition& Season, TCHAR const* Path, float const Weight)
+	{
+		FSeasonWeatherChance& Chance = Season.Weather.AddDefaulted_GetRef();
+		Chance.Preset = TSoftObjectPtr<UWeatherDataAssetBase>(FSoftObjectPath(Path));
+		Chance.Weight = Weight;
+	};
+
+	TCHAR const* Clear = TEXT("/EnvironmentSystem/Environment/Data/DA_ClearWeather.DA_ClearWeather");
+	TCHAR const* Rain = TEXT("/EnvironmentSystem/Environment/Data/DA_HeavyRainWeather.DA_HeavyRainWeather");
+	TCHAR const* Snow = TEXT("/EnvironmentSystem/Environment/Data/DA_SnowStormWeather.DA_SnowStormWeather");
+
+	// Northern hemisphere, starting at the equinoxes and solstices. Only used once bEnableSeasons is set.
+	FSeasonDefinition& Spring = AddSeason("Spring", 80, 12.5f, 5.f, 15.f, 1.f, FLinearColor(.85f, 1.f, .8f));
+	AddWeather(Spring, Clear, 3.f);
+	AddWeather(Spring, Rain, 1.f);
+
+	FSeasonDefinition& Summer = AddSeason("Summer", 172, 15.5f, 14.f, 26.f, 1.f, FLinearColor::White);
+	AddWeather(Summer, Clear, 4.f);
+	AddWeather(Summer, Rain, 1.f);
+
+	FSeasonDefinition& Autumn = AddSeason("Autumn", 266, 11.5f, 6.f, 14.f, .8f, FLinearColor(1.f, .65f, .35f));
+	AddWeather(Autumn, Clear, 2.f);
+	AddWeather(Autumn, Rain, 2.f);
+
+	FSeasonDefinition& Winter = AddSeason("Winter", 355, 8.5f, -6.f, 2.f, .5f, FLinearColor(.8f, .8f, .75f));
+	AddWeather(Winter, Clear, 2.f);
+	AddWeather(Winter, Snow, 2.f);
 }
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvironmentViewSubsystem.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarWeatherMaxViews(
+	TEXT("es.Weather.MaxViews"),
+	4,
+	TEXT("Most views that get their own weather effects. Further views see the effects of the others."),
+	ECVF_Default);
+
+bool UEnvironmentViewSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Dedicated servers have no views
+	return not IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UEnvironmentViewSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TConstArrayView<FEnvironmentView> UEnvironmentViewSubsystem::GetViews() const
+{
+	if(GatheredFrame != GFrameCounter)
+	{
+		GatherViews();
+	}
+
+	return Views;
+}
+
+FVector UEnvironmentViewSubsystem::GetPrimaryViewLocation(FVector const& Fallback) const
+{
+	TConstArrayView<FEnvironmentView> const CurrentViews = GetViews();
+	return CurrentViews.IsEmpty() ? Fallback : CurrentViews[0].Location;
+}
+
+void UEnvironmentViewSubsystem::AddSpectatorView(AActor* ViewActor)
+{
+	if(ViewActor)
+	{
+		SpectatorViews.RemoveAll([](TWeakObjectPtr<AActor> const& View) { return not View.IsValid(); });
+		SpectatorViews.AddUnique(ViewActor);
+		GatheredFrame = MAX_uint64;
+	}
+}
+
+void UEnvironmentViewSubsystem::RemoveSpectatorView(AActor* ViewActor)
+{
+	SpectatorViews.Remove(ViewActor);
+	GatheredFrame = MAX_uint64;
+}
+
+void UEnvironmentViewSubsystem::GatherViews() const
+{
+	GatheredFrame = GFrameCounter;
+	Views.Reset();
+
+	int32 const MaxViews = FMath::Max(CVarWeatherMaxViews.GetValueOnGameThread(), 1);
+
+	// Local players in the order of their screens, the first one is also the first player controller
+	for(FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It && Views.Num() < MaxViews; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if(PlayerController && PlayerController->IsLocalController() && PlayerController->PlayerCameraManager)
+		{
+			FEnvironmentView& View = Views.AddDefaulted_GetRef();
+			View.PlayerController = PlayerController;
+			View.Location = PlayerController->PlayerCameraManager->GetCameraLocation();
+			View.Rotation = PlayerController->PlayerCameraManager->GetCameraRotation();
+		}
+	}
+
+	for(TWeakObjectPtr<AActor> const& ViewActor : SpectatorViews)
+	{
+		if(Views.Num() >= MaxViews)
+		{
+			break;
+		}
+
+		if(not ViewActor.IsValid())
+		{
+			continue;
+		}
+
+		FEnvironmentView& View = Views.AddDefaulted_GetRef();
+		ViewActor->GetActorEyesViewPoint(View.Location, View.Rotation);
+	}
+}
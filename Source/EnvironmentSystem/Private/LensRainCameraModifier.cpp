@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LensRainCameraModifier.h"
+
+#include "Materials/MaterialInstanceDynamic.h"
+
+namespace
+{
+	// Below this the drops are invisible and the blendable is left out
+	constexpr float MinVisibleWeight = 1e-3f;
+}
+
+void ULensRainCameraModifier::SetLensRain(UMaterialInterface* Material, FName const AmountParameterName, float const InWeight)
+{
+	Weight = InWeight;
+	if(Weight <= MinVisibleWeight || not Material)
+	{
+		return;
+	}
+
+	if(not MaterialInstance || MaterialInstance->Parent != Material)
+	{
+		MaterialInstance = UMaterialInstanceDynamic::Create(Material, this);
+	}
+
+	MaterialInstance->SetScalarParameterValue(AmountParameterName, Weight);
+}
+
+void ULensRainCameraModifier::ModifyPostProcess(float const DeltaTime, float& PostProcessBlendWeight, FPostProcessSettings& PostProcessSettings)
+{
+	Super::ModifyPostProcess(DeltaTime, PostProcessBlendWeight, PostProcessSettings);
+
+	// Leaving the blendable out, rather than giving it zero weight, skips the full screen pass
+	if(Weight <= MinVisibleWeight || not MaterialInstance)
+	{
+		return;
+	}
+
+	PostProcessSettings.AddBlendable(MaterialInstance, Weight);
+	PostProcessBlendWeight = 1.f;
+}
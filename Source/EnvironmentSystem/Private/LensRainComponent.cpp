@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LensRainComponent.h"
+
+#include "EnvironmentViewSubsystem.h"
+#include "LensRainCameraModifier.h"
+#include "WeatherExposureSubsystem.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+
+ULensRainComponent::ULensRainComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void ULensRainComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClearViews();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULensRainComponent::ClearViews()
+{
+	for(FLensRainView const& View : Views)
+	{
+		APlayerController const* PlayerController = View.PlayerController.Get();
+		if(PlayerController && PlayerController->PlayerCameraManager && View.Modifier)
+		{
+			PlayerController->PlayerCameraManager->RemoveCameraModifier(View.Modifier);
+		}
+	}
+
+	Views.Reset();
+}
+
+void ULensRainComponent::AddView(APlayerController* PlayerController)
+{
+	bool const bHasView = Views.ContainsByPredicate([PlayerController](FLensRainView const& View) { return View.PlayerController == PlayerController; });
+	if(bHasView || not PlayerController->PlayerCameraManager)
+	{
+		return;
+	}
+
+	UCameraModifier* Modifier = PlayerController->PlayerCameraManager->AddNewCameraModifier(ULensRainCameraModifier::StaticClass());
+	if(ULensRainCameraModifier* LensRainModifier = Cast<ULensRainCameraModifier>(Modifier))
+	{
+		FLensRainView& View = Views.AddDefaulted_GetRef();
+		View.PlayerController = PlayerController;
+		View.Modifier = LensRainModifier;
+	}
+}
+
+float ULensRainComponent::GetLensRainWeight(APlayerController const* PlayerController) const
+{
+	FLensRainView const* View = Views.FindByPredicate([PlayerController](FLensRainView const& Candidate) { return Candidate.PlayerController == PlayerController; });
+	return View ? View->Weight : 0.f;
+}
+
+void ULensRainComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	UEnvironmentViewSubsystem const* EnvironmentViews = GetWorld()->GetSubsystem<UEnvironmentViewSubsystem>();
+	UWeatherExposureSubsystem const* Exposure = GetWorld()->GetSubsystem<UWeatherExposureSubsystem>();
+	if(not EnvironmentViews || not Exposure || not LensRainMaterial)
+	{
+		return;
+	}
+
+	// Players that left, or got a new camera manager, take their modifier with them
+	Views.RemoveAll([](FLensRainView const& View)
+	{
+		return not View.PlayerController.IsValid() || not View.Modifier || View.Modifier->CameraOwner != View.PlayerController->PlayerCameraManager;
+	});
+
+	// In dry weather nothing changes once every lens has dried off
+	if(not Exposure->CanHavePrecipitation() && not Views.ContainsByPredicate([](FLensRainView const& View) { return View.Weight > 0.f; }))
+	{
+		return;
+	}
+
+	// Spectator views have no lens
+	TArray<APlayerController const*, TInlineAllocator<4>> ViewPlayers;
+	for(FEnvironmentView const& EnvironmentView : EnvironmentViews->GetViews())
+	{
+		if(APlayerController* PlayerController = EnvironmentView.PlayerController.Get())
+		{
+			AddView(PlayerController);
+			ViewPlayers.Add(PlayerController);
+		}
+	}
+
+	for(FLensRainView& View : Views)
+	{
+		APlayerController const* PlayerController = View.PlayerController.Get();
+		float const TargetWeight = ViewPlayers.Contains(PlayerController) ? GetTargetWeight(PlayerController->PlayerCameraManager) : 0.f;
+		float const PreviousWeight = View.Weight;
+
+		View.Weight = TargetWeight > View.Weight
+			? FMath::Min(TargetWeight, View.Weight + FadeInSpeed * DeltaTime)
+			: FMath::Max(TargetWeight, View.Weight - FadeOutSpeed * DeltaTime);
+
+		if(View.Weight != PreviousWeight)
+		{
+			View.Modifier->SetLensRain(LensRainMaterial, LensRainAmountParameterName, View.Weight);
+		}
+	}
+}
+
+float ULensRainComponent::GetTargetWeight(APlayerCameraManager const* CameraManager) const
+{
+	UWeatherExposureSubsystem const* Exposure = GetWorld()->GetSubsystem<UWeatherExposureSubsystem>();
+	if(not CameraManager || not Exposure)
+	{
+		return 0.f;
+	}
+
+	EPrecipitationType PrecipitationType;
+	float Intensity;
+	bool bSheltered;
+	Exposure->QueryExposureAt(CameraManager->GetCameraLocation(), PrecipitationType, Intensity, bSheltered);
+
+	if(PrecipitationType != EPrecipitationType::Rain || bSheltered)
+	{
+		return 0.f;
+	}
+
+	// Looking up catches the most drops, looking down almost none
+	float const Pitch = FRotator::NormalizeAxis(CameraManager->GetCameraRotation().Pitch);
+	float const ViewFactor = Pitch >= 0.f
+		? FMath::Lerp(LevelViewFactor, 1.f, Pitch / 90.f)
+		: FMath::Lerp(LevelViewFactor, DownViewFactor, -Pitch / 90.f);
+
+	return FMath::Clamp(Intensity * ViewFactor, 0.f, 1.f);
+}
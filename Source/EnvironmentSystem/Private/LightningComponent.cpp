@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LightningComponent.h"
+
+#include "DynamicSkySystem.h"
+#include "EnvironmentSystemStats.h"
+#include "NiagaraComponent.h"
+#include "WeatherDataAssetBase.h"
+#include "Components/AudioComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/App.h"
+#include "Sound/SoundBase.h"
+
+namespace
+{
+	// Thunder that has not been heard yet, strikes beyond this are silent
+	constexpr int32 MaxPendingThunder = 8;
+}
+
+ULightningComponent::ULightningComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+void ULightningComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	LLM_SCOPE_BYTAG(EnvironmentSystem_WeatherEffects);
+
+	RandomStream.Initialize(Seed);
+	PendingThunder.Reserve(MaxPendingThunder);
+
+	// Strikes are still scheduled and broadcast without a renderer, only the effects and thunder are skipped
+	if(not FApp::CanEverRender())
+	{
+		return;
+	}
+
+	AActor* Owner = GetOwner();
+	if(LightningEffect)
+	{
+		for(int32 i = 0; i < EffectPoolSize; ++i)
+		{
+			UNiagaraComponent* NC = NewObject<UNiagaraComponent>(Owner);
+			NC->SetAutoActivate(false);
+			NC->SetUsingAbsoluteLocation(true);
+			NC->SetAsset(LightningEffect);
+			NC->SetupAttachment(Owner->GetRootComponent());
+			NC->RegisterComponent();
+
+			EffectPool.Add(NC);
+		}
+	}
+
+	if(ThunderSound)
+	{
+		for(int32 i = 0; i < ThunderPoolSize; ++i)
+		{
+			UAudioComponent* AC = NewObject<UAudioComponent>(Owner);
+			AC->SetAutoActivate(false);
+			AC->bAutoDestroy = false;
+			AC->SetUsingAbsoluteLocation(true);
+			AC->SetSound(ThunderSound);
+			AC->SetupAttachment(Owner->GetRootComponent());
+			AC->RegisterComponent();
+
+			ThunderPool.Add(AC);
+		}
+	}
+}
+
+void ULightningComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for(UNiagaraComponent* NC : EffectPool)
+	{
+		NC->DestroyComponent();
+	}
+
+	for(UAudioComponent* AC : ThunderPool)
+	{
+		AC->DestroyComponent();
+	}
+
+	EffectPool.Empty();
+	ThunderPool.Empty();
+	PendingThunder.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULightningComponent::SetSeed(int32 const NewSeed)
+{
+	Seed = NewSeed;
+	RandomStream.Initialize(Seed);
+	TimeUntilNextStrike = -1.f;
+}
+
+void ULightningComponent::SetAutomaticStrikes(bool const bEnabled)
+{
+	bAutomaticStrikes = bEnabled;
+	TimeUntilNextStrike = -1.f;
+}
+
+void ULightningComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	UpdateFlash(DeltaTime);
+	UpdateThunder();
+
+	FLightningSettings const* Settings = GetLightningSettings();
+	if(not bAutomaticStrikes || not Settings || Settings->StrikesPerMinute <= 0.f)
+	{
+		TimeUntilNextStrike = -1.f;
+		return;
+	}
+
+	if(TimeUntilNextStrike < 0.f)
+	{
+		ScheduleNextStrike(Settings->StrikesPerMinute);
+	}
+
+	TimeUntilNextStrike -= DeltaTime;
+	if(TimeUntilNextStrike <= 0.f)
+	{
+		Strike(*Settings);
+		ScheduleNextStrike(Settings->StrikesPerMinute);
+	}
+}
+
+FLightningSettings const* ULightningComponent::GetLightningSettings() const
+{
+	ADynamicSkySystem const* Sky = Cast<ADynamicSkySystem>(GetOwner());
+	UWeatherDataAssetBase const* Preset = Sky ? Sky->GetActiveWeatherPreset() : nullptr;
+	return Preset ? &Preset->LightningSettings : nullptr;
+}
+
+bool ULightningComponent::GetListenerLocation(FVector& OutLocation) const
+{
+	APlayerController const* PlayerController = GetWorld()->GetFirstPlayerController();
+	if(not PlayerController)
+	{
+		return false;
+	}
+
+	FVector FrontDirection, RightDirection;
+	PlayerController->GetAudioListenerPosition(OutLocation, FrontDirection, RightDirection);
+	return true;
+}
+
+void ULightningComponent::ScheduleNextStrike(float const StrikesPerMinute)
+{
+	// Exponentially distributed intervals make the strikes a Poisson process with the given rate
+	float const Random = FMath::Max(RandomStream.GetFraction(), UE_SMALL_NUMBER);
+	TimeUntilNextStrike = -FMath::Loge(Random) * 60.f / StrikesPerMinute;
+}
+
+void ULightningComponent::Strike(FLightningSettings const& Settings)
+{
+	FVector ListenerLocation;
+	if(not GetListenerLocation(ListenerLocation))
+	{
+		return;
+	}
+
+	float const Distance = RandomStream.FRandRange(Settings.MinStrikeDistance, FMath::Max(Settings.MinStrikeDistance, Settings.MaxStrikeDistance));
+	float const Angle = RandomStream.FRandRange(0.f, UE_TWO_PI);
+
+	TriggerStrike(ListenerLocation + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * Distance);
+}
+
+void ULightningComponent::TriggerStrike(FVector const& Location)
+{
+	FLightningSettings const* PresetSettings = GetLightningSettings();
+	FLightningSettings const Settings = PresetSettings ? *PresetSettings : FLightningSettings{};
+
+	if(not EffectPool.IsEmpty())
+	{
+		// The oldest bolt is restarted if it is still playing
+		UNiagaraComponent* NC = EffectPool[NextEffectIndex];
+		NextEffectIndex = (NextEffectIndex + 1) % EffectPool.Num();
+
+		NC->SetWorldLocation(Location);
+		NC->Activate(true);
+	}
+
+	FlashStrength = Settings.FlashStrength;
+	FlashDuration = Settings.FlashDuration;
+	FlashTimeRemaining = FlashDuration;
+
+	FVector ListenerLocation;
+	float const Distance = GetListenerLocation(ListenerLocation) ? FVector::Dist2D(ListenerLocation, Location) : 0.f;
+
+	if(not ThunderPool.IsEmpty() && PendingThunder.Num() < MaxPendingThunder)
+	{
+		float const DistanceAlpha = FMath::Clamp(Distance / FMath::Max(Settings.MaxStrikeDistance, 1.f), 0.f, 1.f);
+		PendingThunder.Add({
+			GetWorld()->GetTimeSeconds() + Distance / SpeedOfSound,
+			Location,
+			FMath::Lerp(1.f, FarThunderVolume, DistanceAlpha) });
+	}
+
+	OnLightningStrike.Broadcast(Location, Distance);
+}
+
+void ULightningComponent::UpdateFlash(float const DeltaTime)
+{
+	if(FlashTimeRemaining <= 0.f)
+	{
+		return;
+	}
+
+	ADynamicSkySystem* Sky = Cast<ADynamicSkySystem>(GetOwner());
+	FlashTimeRemaining = FMath::Max(0.f, FlashTimeRemaining - DeltaTime);
+
+	// A bright first stroke, a short dip and a return stroke that fades out
+	float const Alpha = FlashTimeRemaining / FlashDuration;
+	float const Envelope = Alpha > .75f ? 1.f : (Alpha > .6f ? .25f : Alpha / .6f);
+
+	if(Sky)
+	{
+		Sky->SetLightningFlash(FlashStrength * Envelope);
+	}
+}
+
+void ULightningComponent::UpdateThunder()
+{
+	double const Now = GetWorld()->GetTimeSeconds();
+
+	for(int32 i = PendingThunder.Num() - 1; i >= 0; --i)
+	{
+		if(PendingThunder[i].PlayTime > Now)
+		{
+			continue;
+		}
+
+		FPendingThunder const Thunder = PendingThunder[i];
+		PendingThunder.RemoveAtSwap(i, 1, EAllowShrinking::No);
+
+		TObjectPtr<UAudioComponent>* FreeVoice = ThunderPool.FindByPredicate([](TObjectPtr<UAudioComponent> const& AC) { return not AC->IsPlaying(); });
+		if(not FreeVoice)
+		{
+			continue;
+		}
+
+		(*FreeVoice)->SetWorldLocation(Thunder.Location);
+		(*FreeVoice)->SetVolumeMultiplier(Thunder.Volume);
+		(*FreeVoice)->Play();
+	}
+}
@@ -0,0 +1,342 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PrecipitationOcclusionSubsystem.h"
+
+#include "EnvironmentSystemSettings.h"
+#include "EnvironmentSystemStats.h"
+#include "EnvironmentViewSubsystem.h"
+#include "NiagaraComponent.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "Misc/App.h"
+#include "Misc/ScopeRWLock.h"
+
+namespace
+{
+	constexpr float UnknownOccluderHeight = TNumericLimits<float>::Lowest();
+}
+
+FPrecipitationOcclusionGrid::FPrecipitationOcclusionGrid(FIntPoint const InMinCell, int32 const InResolution, float const InCellSize, float const InShelterBias, TArray<float>&& InHeights)
+	: MinCell(InMinCell)
+	, Resolution(InResolution)
+	, CellSize(InCellSize)
+	, ShelterBias(InShelterBias)
+	, Heights(MoveTemp(InHeights))
+{
+	check(Heights.Num() == Resolution * Resolution);
+}
+
+float FPrecipitationOcclusionGrid::GetOccluderHeight(FVector const& Position) const
+{
+	if(IsEmpty())
+	{
+		return UnknownOccluderHeight;
+	}
+
+	int32 const X = FMath::FloorToInt32(Position.X / CellSize) - MinCell.X;
+	int32 const Y = FMath::FloorToInt32(Position.Y / CellSize) - MinCell.Y;
+	if(X < 0 or Y < 0 or X >= Resolution or Y >= Resolution)
+	{
+		return UnknownOccluderHeight;
+	}
+
+	return Heights[Y * Resolution + X];
+}
+
+FVector4 FPrecipitationOcclusionGrid::GetGridParameters() const
+{
+	return FVector4(MinCell.X * CellSize, MinCell.Y * CellSize, CellSize, Resolution);
+}
+
+void UPrecipitationOcclusionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
+	Resolution = FMath::Clamp(Settings->OcclusionGridResolution, 8, 256);
+	CellSize = FMath::Max(Settings->OcclusionCellSize, 10.f);
+
+	ResetGrid();
+}
+
+void UPrecipitationOcclusionSubsystem::Deinitialize()
+{
+	HeightTexture = nullptr;
+	PendingCells.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UPrecipitationOcclusionSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Dedicated servers have no camera to build the grid around
+	return not IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UPrecipitationOcclusionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UPrecipitationOcclusionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPrecipitationOcclusionSubsystem, STATGROUP_EnvironmentSystem);
+}
+
+void UPrecipitationOcclusionSubsystem::ResetGrid()
+{
+	int32 const NumCells = Resolution * Resolution;
+	SlotHeights.Init(UnknownOccluderHeight, NumCells);
+	SlotCells.Init(FIntPoint(TNumericLimits<int32>::Max()), NumCells);
+	SlotValid.Init(false, NumCells);
+	PendingCells.Reset();
+	bHasCenter = false;
+}
+
+int32 UPrecipitationOcclusionSubsystem::GetSlotIndex(FIntPoint const Cell) const
+{
+	int32 const X = ((Cell.X % Resolution) + Resolution) % Resolution;
+	int32 const Y = ((Cell.Y % Resolution) + Resolution) % Resolution;
+	return Y * Resolution + X;
+}
+
+void UPrecipitationOcclusionSubsystem::Tick(float DeltaTime)
+{
+	UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
+	if(not Settings->bEnablePrecipitationOcclusion)
+	{
+		return;
+	}
+
+	// Only the primary view is covered, the sky binds the grid to the weather effects of that view alone
+	UEnvironmentViewSubsystem const* Views = GetWorld()->GetSubsystem<UEnvironmentViewSubsystem>();
+	if(not Views || Views->GetViews().IsEmpty())
+	{
+		return;
+	}
+
+	FVector const ViewLocation = Views->GetViews()[0].Location;
+	FIntPoint const ViewCell(FMath::FloorToInt32(ViewLocation.X / CellSize), FMath::FloorToInt32(ViewLocation.Y / CellSize));
+
+	if(not bHasCenter || ViewCell != CenterCell)
+	{
+		FIntPoint const OldCenter = CenterCell;
+		bool const bHadCenter = bHasCenter;
+		CenterCell = ViewCell;
+		bHasCenter = true;
+
+		// A step only exposes a strip at the edge of the grid, a jump exposes all of it
+		FIntPoint const Step = CenterCell - OldCenter;
+		if(bHadCenter && FMath::Abs(Step.X) < Resolution && FMath::Abs(Step.Y) < Resolution)
+		{
+			QueueExposedCells(OldCenter);
+		}
+		else
+		{
+			QueueInvalidCells();
+		}
+		bIsDirty = true;
+	}
+
+	int32 const HalfResolution = Resolution / 2;
+	FIntPoint const MinCell = CenterCell - FIntPoint(HalfResolution);
+	FIntPoint const MaxCell = MinCell + FIntPoint(Resolution - 1);
+
+	for(int32 Traces = 0; Traces < Settings->OcclusionTracesPerFrame && not PendingCells.IsEmpty();)
+	{
+		FIntPoint const Cell = PendingCells.Pop(EAllowShrinking::No);
+
+		// The camera may have moved on since the cell was queued
+		if(Cell.X < MinCell.X or Cell.Y < MinCell.Y or Cell.X > MaxCell.X or Cell.Y > MaxCell.Y)
+		{
+			continue;
+		}
+
+		int32 const Slot = GetSlotIndex(Cell);
+		if(SlotValid[Slot] && SlotCells[Slot] == Cell)
+		{
+			continue;
+		}
+
+		// Open sky reads the same as a cell not traced yet, so only hits change the published grid
+		bIsDirty |= TraceCell(Cell);
+		++Traces;
+	}
+
+	if(bIsDirty)
+	{
+		PublishGrid();
+		bIsDirty = false;
+	}
+}
+
+void UPrecipitationOcclusionSubsystem::QueueInvalidCells()
+{
+	int32 const HalfResolution = Resolution / 2;
+	FIntPoint const MinCell = CenterCell - FIntPoint(HalfResolution);
+
+	PendingCells.Reset();
+	for(int32 Y = 0; Y < Resolution; ++Y)
+	{
+		for(int32 X = 0; X < Resolution; ++X)
+		{
+			FIntPoint const Cell = MinCell + FIntPoint(X, Y);
+			int32 const Slot = GetSlotIndex(Cell);
+			if(not SlotValid[Slot] || SlotCells[Slot] != Cell)
+			{
+				PendingCells.Add(Cell);
+			}
+		}
+	}
+
+	// Farthest first, so that popping from the back traces the cells around the camera first
+	FIntPoint const Center = CenterCell;
+	PendingCells.Sort([Center](FIntPoint const& A, FIntPoint const& B)
+	{
+		return (A - Center).SizeSquared() > (B - Center).SizeSquared();
+	});
+}
+
+void UPrecipitationOcclusionSubsystem::QueueExposedCells(FIntPoint const OldCenter)
+{
+	int32 const HalfResolution = Resolution / 2;
+	FIntPoint const MinCell = CenterCell - FIntPoint(HalfResolution);
+	FIntPoint const MaxCell = MinCell + FIntPoint(Resolution - 1);
+	FIntPoint const OldMinCell = OldCenter - FIntPoint(HalfResolution);
+	FIntPoint const OldMaxCell = OldMinCell + FIntPoint(Resolution - 1);
+
+	auto IsInside = [](FIntPoint const Cell, FIntPoint const Min, FIntPoint const Max)
+	{
+		return Cell.X >= Min.X and Cell.Y >= Min.Y and Cell.X <= Max.X and Cell.Y <= Max.Y;
+	};
+
+	// Cells that scrolled out no longer need a trace, the rest keep their order
+	PendingCells.RemoveAll([&](FIntPoint const& Cell) { return not IsInside(Cell, MinCell, MaxCell); });
+
+	ExposedCells.Reset();
+	for(int32 Y = 0; Y < Resolution; ++Y)
+	{
+		for(int32 X = 0; X < Resolution; ++X)
+		{
+			FIntPoint const Cell = MinCell + FIntPoint(X, Y);
+			if(not IsInside(Cell, OldMinCell, OldMaxCell))
+			{
+				ExposedCells.Add(Cell);
+			}
+		}
+	}
+
+	// The exposed cells are at the edge, farther than the cells still pending. Only they are sorted, and they go to
+	// the front so that they are traced last.
+	FIntPoint const Center = CenterCell;
+	ExposedCells.Sort([Center](FIntPoint const& A, FIntPoint const& B)
+	{
+		return (A - Center).SizeSquared() > (B - Center).SizeSquared();
+	});
+	PendingCells.Insert(ExposedCells, 0);
+}
+
+bool UPrecipitationOcclusionSubsystem::TraceCell(FIntPoint const Cell)
+{
+	UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
+
+	// From a fixed ceiling rather than the camera, so the height of a cell does not depend on where it was traced from
+	FVector const TraceStart((Cell.X + .5) * CellSize, (Cell.Y + .5) * CellSize, Settings->OcclusionTraceCeiling);
+	FVector const TraceEnd = TraceStart - FVector(0, 0, Settings->OcclusionTraceRange);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(PrecipitationOcclusion), false);
+	FHitResult HitResult;
+
+	bool const bHit = GetWorld()->LineTraceSingleByObjectType(HitResult, TraceStart, TraceEnd, FCollisionObjectQueryParams(ECC_WorldStatic), QueryParams);
+	ENVIRONMENT_INC_COUNTER(Traces, 1);
+
+	int32 const Slot = GetSlotIndex(Cell);
+	SlotHeights[Slot] = bHit ? static_cast<float>(HitResult.ImpactPoint.Z) : UnknownOccluderHeight;
+	SlotCells[Slot] = Cell;
+	SlotValid[Slot] = true;
+	return bHit;
+}
+
+void UPrecipitationOcclusionSubsystem::PublishGrid()
+{
+	int32 const HalfResolution = Resolution / 2;
+	FIntPoint const MinCell = CenterCell - FIntPoint(HalfResolution);
+
+	TArray<float> Heights;
+	Heights.SetNumUninitialized(Resolution * Resolution);
+
+	for(int32 Y = 0; Y < Resolution; ++Y)
+	{
+		for(int32 X = 0; X < Resolution; ++X)
+		{
+			FIntPoint const Cell = MinCell + FIntPoint(X, Y);
+			int32 const Slot = GetSlotIndex(Cell);
+			Heights[Y * Resolution + X] = SlotValid[Slot] && SlotCells[Slot] == Cell ? SlotHeights[Slot] : UnknownOccluderHeight;
+		}
+	}
+
+	float const ShelterBias = GetDefault<UEnvironmentSystemSettings>()->OcclusionShelterBias;
+	TSharedRef<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> const Grid = MakeShared<FPrecipitationOcclusionGrid, ESPMode::ThreadSafe>(MinCell, Resolution, CellSize, ShelterBias, MoveTemp(Heights));
+
+	{
+		FWriteScopeLock WriteLock(GridLock);
+		PublishedGrid = Grid;
+	}
+
+	++GridVersion;
+	UpdateHeightTexture(*Grid);
+}
+
+void UPrecipitationOcclusionSubsystem::UpdateHeightTexture(FPrecipitationOcclusionGrid const& Grid)
+{
+	if(not FApp::CanEverRender())
+	{
+		return;
+	}
+
+	if(not HeightTexture)
+	{
+		HeightTexture = UTexture2D::CreateTransient(Resolution, Resolution, PF_R32_FLOAT, TEXT("PrecipitationOcclusionHeights"));
+		HeightTexture->Filter = TF_Nearest;
+		HeightTexture->SRGB = false;
+		HeightTexture->AddressX = TA_Clamp;
+		HeightTexture->AddressY = TA_Clamp;
+		HeightTexture->UpdateResource();
+	}
+
+	// The render thread reads the data later, so it gets its own copy
+	SIZE_T const NumBytes = Grid.GetHeights().Num() * sizeof(float);
+	uint8* const Data = static_cast<uint8*>(FMemory::Malloc(NumBytes));
+	FMemory::Memcpy(Data, Grid.GetHeights().GetData(), NumBytes);
+
+	FUpdateTextureRegion2D* const Region = new FUpdateTextureRegion2D(0, 0, 0, 0, Resolution, Resolution);
+	HeightTexture->UpdateTextureRegions(0, 1, Region, Resolution * sizeof(float), sizeof(float), Data,
+		[](uint8* SrcData, FUpdateTextureRegion2D const* Regions)
+		{
+			FMemory::Free(SrcData);
+			delete Regions;
+		});
+}
+
+TSharedRef<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> UPrecipitationOcclusionSubsystem::GetOcclusionGrid() const
+{
+	FReadScopeLock ReadLock(GridLock);
+	return PublishedGrid;
+}
+
+bool UPrecipitationOcclusionSubsystem::IsPointSheltered(FVector const& Position) const
+{
+	return GetOcclusionGrid()->IsSheltered(Position);
+}
+
+void UPrecipitationOcclusionSubsystem::ApplyToNiagaraComponent(UNiagaraComponent* Component) const
+{
+	if(not Component || not HeightTexture)
+	{
+		return;
+	}
+
+	Component->SetVariableTexture(HeightTextureParameterName, HeightTexture);
+	Component->SetVariableVec4(GridParametersParameterName, GetOcclusionGrid()->GetGridParameters());
+}
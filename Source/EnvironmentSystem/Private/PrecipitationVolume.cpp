@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PrecipitationVolume.h"
+
+FPrecipitationVolume FPrecipitationVolume::Compute(FPrecipitationVolumeSettings const& Settings, FVector const& ViewLocation, FVector const& ViewVelocity, float const CloudBaseHeight)
+{
+	FPrecipitationVolume Volume;
+
+	// Particles spawned ahead of the camera reach the ground about where the camera gets to
+	FVector2D const Velocity(ViewVelocity);
+	FVector2D const Lead = (Velocity * Settings.LeadTime).GetClampedToMaxSize(Settings.MaxLead);
+	Volume.Offset = FVector(Lead, 0.);
+
+	// Stretched along the path and narrowed across it by as much, the area stays the same
+	float const Speed = Velocity.Size();
+	float const Stretch = FMath::Lerp(1.f, FMath::Max(Settings.MaxStretch, 1.f), FMath::Clamp(Speed / Settings.StretchSpeed, 0.f, 1.f));
+	Volume.Yaw = Speed > UE_KINDA_SMALL_NUMBER ? FMath::RadiansToDegrees(FMath::Atan2(Velocity.Y, Velocity.X)) : 0.f;
+
+	// Nothing falls above the cloud base, the cut off part of the volume spawns nothing
+	float const Bottom = ViewLocation.Z - Settings.HalfHeight;
+	float const Top = FMath::Min(ViewLocation.Z + Settings.HalfHeight, CloudBaseHeight);
+	if(Top <= Bottom)
+	{
+		Volume.Extent = FVector(Settings.Radius * Stretch, Settings.Radius / Stretch, 0.f);
+		Volume.SpawnScale = 0.f;
+		return Volume;
+	}
+
+	Volume.Extent = FVector(Settings.Radius * Stretch, Settings.Radius / Stretch, (Top - Bottom) * .5f);
+	Volume.Offset.Z = (Top + Bottom) * .5f - ViewLocation.Z;
+	Volume.SpawnScale = (Top - Bottom) / (Settings.HalfHeight * 2.f);
+
+	return Volume;
+}
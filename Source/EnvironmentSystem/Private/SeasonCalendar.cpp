@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SeasonCalendar.h"
+
+#include "EnvironmentSystemStats.h"
+#include "WeatherDataAssetBase.h"
+
+namespace
+{
+	// The warmest time of the day, the coldest is dawn
+	constexpr float WarmestHour = 15.f;
+
+	// Values of every season in the order of the year, seasons without a parameter hold the value of the season before them
+	template<typename ValueType>
+	void GatherSeasonValues(TConstArrayView<FSeasonDefinition> Seasons, TConstArrayView<int32> Order, TConstArrayView<FName> Names,
+		TMap<FName, ValueType> FSeasonDefinition::* Parameters, TArray<ValueType>& OutValues)
+	{
+		OutValues.SetNum(Order.Num() * Names.Num());
+		for(int32 Name = 0; Name < Names.Num(); ++Name)
+		{
+			// Going around twice reaches the seasons before the first one that has the parameter
+			ValueType Value {};
+			for(int32 Step = 0; Step < Order.Num() * 2; ++Step)
+			{
+				int32 const Season = Step % Order.Num();
+				if(ValueType const* Found = (Seasons[Order[Season]].*Parameters).Find(Names[Name]))
+				{
+					Value = *Found;
+				}
+				OutValues[Season * Names.Num() + Name] = Value;
+			}
+		}
+	}
+}
+
+void FSeasonCalendar::Build(TConstArrayView<FSeasonDefinition> Seasons, int32 const InYear)
+{
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(BuildSeasonCalendar);
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Time);
+
+	Year = InYear;
+	NumSeasons = Seasons.Num();
+	int32 const NumDays = FDateTime::DaysInYear(FMath::Max(InYear, 1));
+
+	Presets.Reset();
+	ScalarNames.Reset();
+	VectorNames.Reset();
+	for(FSeasonDefinition const& Season : Seasons)
+	{
+		for(FSeasonWeatherChance const& Chance : Season.Weather)
+		{
+			if(not Chance.Preset.IsNull())
+			{
+				Presets.AddUnique(Chance.Preset);
+			}
+		}
+
+		for(TPair<FName, float> const& Parameter : Season.ScalarParameters)
+		{
+			ScalarNames.AddUnique(Parameter.Key);
+		}
+
+		for(TPair<FName, FLinearColor> const& Parameter : Season.VectorParameters)
+		{
+			VectorNames.AddUnique(Parameter.Key);
+		}
+	}
+
+	Days.Reset(NumDays);
+	Days.SetNum(NumDays);
+	PresetWeights.SetNumZeroed(NumDays * Presets.Num());
+	ScalarValues.SetNumZeroed(NumDays * ScalarNames.Num());
+	VectorValues.Init(FLinearColor::Transparent, NumDays * VectorNames.Num());
+
+	if(NumSeasons == 0)
+	{
+		return;
+	}
+
+	TArray<int32> Order;
+	for(int32 Season = 0; Season < NumSeasons; ++Season)
+	{
+		Order.Add(Season);
+	}
+	Order.StableSort([Seasons](int32 const A, int32 const B) { return Seasons[A].StartDayOfYear < Seasons[B].StartDayOfYear; });
+
+	// The values of a season apply fully in its middle, the last season lasts into the next year
+	TArray<float> Middles;
+	TArray<float> Weights;
+	Weights.SetNumZeroed(NumSeasons * Presets.Num());
+	for(int32 Index = 0; Index < NumSeasons; ++Index)
+	{
+		FSeasonDefinition const& Season = Seasons[Order[Index]];
+		int32 const NextStart = Index + 1 < NumSeasons ? Seasons[Order[Index + 1]].StartDayOfYear : Seasons[Order[0]].StartDayOfYear + NumDays;
+		Middles.Add((Season.StartDayOfYear + NextStart) * .5f);
+
+		// Normalized, so seasons with more presets do not outweigh their neighbours in between
+		float Total = 0.f;
+		for(FSeasonWeatherChance const& Chance : Season.Weather)
+		{
+			Total += Chance.Preset.IsNull() ? 0.f : FMath::Max(Chance.Weight, 0.f);
+		}
+
+		for(FSeasonWeatherChance const& Chance : Season.Weather)
+		{
+			if(Total > 0.f && not Chance.Preset.IsNull())
+			{
+				Weights[Index * Presets.Num() + Presets.IndexOfByKey(Chance.Preset)] += FMath::Max(Chance.Weight, 0.f) / Total;
+			}
+		}
+	}
+
+	TArray<float> Scalars;
+	GatherSeasonValues(Seasons, Order, ScalarNames, &FSeasonDefinition::ScalarParameters, Scalars);
+
+	TArray<FLinearColor> Vectors;
+	GatherSeasonValues(Seasons, Order, VectorNames, &FSeasonDefinition::VectorParameters, Vectors);
+
+	for(int32 DayIndex = 0; DayIndex < NumDays; ++DayIndex)
+	{
+		int32 const DayOfYear = DayIndex + 1;
+
+		// Days before the first middle belong to the end of the previous year
+		float Day = DayOfYear;
+		if(Day < Middles[0])
+		{
+			Day += NumDays;
+		}
+
+		int32 From = 0;
+		while(From + 1 < NumSeasons && Middles[From + 1] <= Day)
+		{
+			++From;
+		}
+
+		int32 const To = (From + 1) % NumSeasons;
+		float const ToMiddle = From + 1 < NumSeasons ? Middles[From + 1] : Middles[0] + NumDays;
+		float const Alpha = ToMiddle > Middles[From] ? FMath::SmoothStep(Middles[From], ToMiddle, Day) : 0.f;
+
+		FSeasonDefinition const& FromSeason = Seasons[Order[From]];
+		FSeasonDefinition const& ToSeason = Seasons[Order[To]];
+
+		// Days before the start of the first season are still in the last season of the previous year
+		FSeasonDay& Row = Days[DayIndex];
+		Row.Season = Order.Last();
+		for(int32 const Season : Order)
+		{
+			if(Seasons[Season].StartDayOfYear <= DayOfYear)
+			{
+				Row.Season = Season;
+			}
+		}
+
+		float const DayLength = FMath::Clamp(FMath::Lerp(FromSeason.DayLength, ToSeason.DayLength, Alpha), 0.f, 24.f);
+		Row.DawnTime = 12.f - DayLength * .5f;
+		Row.DuskTime = 12.f + DayLength * .5f;
+		Row.MinTemperature = FMath::Lerp(FromSeason.MinTemperature, ToSeason.MinTemperature, Alpha);
+		Row.MaxTemperature = FMath::Lerp(FromSeason.MaxTemperature, ToSeason.MaxTemperature, Alpha);
+
+		for(int32 Preset = 0; Preset < Presets.Num(); ++Preset)
+		{
+			PresetWeights[DayIndex * Presets.Num() + Preset] = FMath::Lerp(Weights[From * Presets.Num() + Preset], Weights[To * Presets.Num() + Preset], Alpha);
+		}
+
+		for(int32 Name = 0; Name < ScalarNames.Num(); ++Name)
+		{
+			ScalarValues[DayIndex * ScalarNames.Num() + Name] = FMath::Lerp(Scalars[From * ScalarNames.Num() + Name], Scalars[To * ScalarNames.Num() + Name], Alpha);
+		}
+
+		for(int32 Name = 0; Name < VectorNames.Num(); ++Name)
+		{
+			VectorValues[DayIndex * VectorNames.Num() + Name] = FMath::Lerp(Vectors[From * VectorNames.Num() + Name], Vectors[To * VectorNames.Num() + Name], Alpha);
+		}
+	}
+}
+
+float FSeasonCalendar::GetTemperature(FDateTime const& Date) const
+{
+	FSeasonDay const& Day = GetDay(Date);
+	float const Hour = Date.GetTimeOfDay().GetTotalHours();
+
+	// Warms up from dawn to the afternoon and cools down until the next dawn
+	float const Coldest = FMath::Min(Day.DawnTime, WarmestHour - 1.f);
+	float Warmth;
+	if(Hour >= Coldest && Hour <= WarmestHour)
+	{
+		Warmth = (Hour - Coldest) / (WarmestHour - Coldest);
+	}
+	else
+	{
+		float const CoolingHours = 24.f - (WarmestHour - Coldest);
+		Warmth = 1.f - FMath::Fmod(Hour - WarmestHour + 24.f, 24.f) / CoolingHours;
+	}
+
+	return FMath::Lerp(Day.MinTemperature, Day.MaxTemperature, .5f - .5f * FMath::Cos(Warmth * UE_PI));
+}
+
+TSoftObjectPtr<UWeatherDataAssetBase> FSeasonCalendar::PickPreset(FDateTime const& Date, FRandomStream& Random) const
+{
+	TConstArrayView<float> const Weights = GetPresetWeights(Date);
+
+	float Total = 0.f;
+	for(float const Weight : Weights)
+	{
+		Total += Weight;
+	}
+
+	if(Total <= 0.f)
+	{
+		return nullptr;
+	}
+
+	float Pick = Random.FRandRange(0.f, Total);
+	int32 Picked = INDEX_NONE;
+	for(int32 Preset = 0; Preset < Weights.Num() && (Picked == INDEX_NONE || Pick > 0.f); ++Preset)
+	{
+		if(Weights[Preset] > 0.f)
+		{
+			Pick -= Weights[Preset];
+			Picked = Preset;
+		}
+	}
+
+	return Presets[Picked];
+}
@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SeasonSubsystem.h"
+
+#include "DynamicSkySystem.h"
+#include "EnvironmentSubsystem.h"
+#include "EnvironmentSystemLogging.h"
+#include "EnvironmentSystemSettings.h"
+#include "EnvironmentSystemStats.h"
+#include "WeatherDataAssetBase.h"
+#include "WorldTimeSubsystem.h"
+#include "Engine/World.h"
+#include "Logging/StructuredLog.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+
+void USeasonSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Environment = Collection.InitializeDependency<UEnvironmentSubsystem>();
+	WorldTime = Collection.InitializeDependency<UWorldTimeSubsystem>();
+	if(WorldTime)
+	{
+		WorldTime->OnTimeAdvanced.AddUObject(this, &USeasonSubsystem::HandleTimeAdvanced);
+	}
+}
+
+void USeasonSubsystem::Deinitialize()
+{
+	if(WorldTime)
+	{
+		WorldTime->OnTimeAdvanced.RemoveAll(this);
+	}
+
+	Environment = nullptr;
+	WorldTime = nullptr;
+	AppliedSky = nullptr;
+
+	Super::Deinitialize();
+}
+
+bool USeasonSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId USeasonSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USeasonSubsystem, STATGROUP_EnvironmentSystem);
+}
+
+void USeasonSubsystem::HandleTimeAdvanced(FDateTime const OldDate, FTimespan const Elapsed)
+{
+	bDayPassed |= (OldDate + Elapsed).GetDate() != OldDate.GetDate();
+}
+
+void USeasonSubsystem::Tick(float const DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	ADynamicSkySystem* Sky = Environment ? Environment->GetSky() : nullptr;
+	if(not Sky || not WorldTime || not WorldTime->GetSeasonCalendar().HasSeasons())
+	{
+		return;
+	}
+
+	FDateTime const Date = WorldTime->GetWorldDateTime().GetDate();
+	if(Sky == AppliedSky && Date == AppliedDate)
+	{
+		return;
+	}
+
+	// A new sky keeps the weather it starts with, only days that pass draw new weather
+	ApplyDay(Sky, Date, bDayPassed && Sky == AppliedSky);
+
+	AppliedSky = Sky;
+	AppliedDate = Date;
+	bDayPassed = false;
+}
+
+void USeasonSubsystem::ApplyDay(ADynamicSkySystem* Sky, FDateTime const& Date, bool const bPickWeather) const
+{
+	FSeasonCalendar const& Calendar = WorldTime->GetSeasonCalendar();
+	FSeasonDay const& Day = Calendar.GetDay(Date);
+
+	Sky->SetDawnAndDuskTime(Day.DawnTime, Day.DuskTime);
+
+	// Landscape and foliage materials read the seasonal parameters from the weather parameter collection. Parameters
+	// the collection does not declare are skipped, the instance would warn about each of them every day.
+	UMaterialParameterCollection* Collection = Sky->GetWeatherParameterCollection();
+	if(UMaterialParameterCollectionInstance* Instance = Collection && not IsRunningDedicatedServer() ? GetWorld()->GetParameterCollectionInstance(Collection) : nullptr)
+	{
+		int32 NumWrites = 0;
+
+		TConstArrayView<FName> const ScalarNames = Calendar.GetScalarParameterNames();
+		TConstArrayView<float> const Scalars = Calendar.GetScalarParameters(Date);
+		for(int32 Parameter = 0; Parameter < ScalarNames.Num(); ++Parameter)
+		{
+			if(Collection->GetScalarParameterByName(ScalarNames[Parameter]))
+			{
+				Instance->SetScalarParameterValue(ScalarNames[Parameter], Scalars[Parameter]);
+				++NumWrites;
+			}
+		}
+
+		TConstArrayView<FName> const VectorNames = Calendar.GetVectorParameterNames();
+		TConstArrayView<FLinearColor> const Vectors = Calendar.GetVectorParameters(Date);
+		for(int32 Parameter = 0; Parameter < VectorNames.Num(); ++Parameter)
+		{
+			if(Collection->GetVectorParameterByName(VectorNames[Parameter]))
+			{
+				Instance->SetVectorParameterValue(VectorNames[Parameter], Vectors[Parameter]);
+				++NumWrites;
+			}
+		}
+
+		ENVIRONMENT_INC_COUNTER(MPCWrites, NumWrites);
+	}
+
+	if(not bPickWeather || not GetDefault<UEnvironmentSystemSettings>()->bPickDailyWeather)
+	{
+		return;
+	}
+
+	// Seeded by the date, so every machine and every replay draws the same weather
+	FRandomStream Random(Date.GetYear() * 1000 + Date.GetDayOfYear());
+	UWeatherDataAssetBase* Preset = Calendar.PickPreset(Date, Random).LoadSynchronous();
+	if(Preset && Preset != Sky->GetWeatherPreset())
+	{
+		UE_LOGFMT(EnvironmentSystem, Log, "Weather of day {Day} of {Year} is {Preset}", Date.GetDayOfYear(), Date.GetYear(), Preset->GetName());
+		Sky->SetWeatherPreset(Preset);
+	}
+}
+
+int32 USeasonSubsystem::GetSeason() const
+{
+	return WorldTime ? WorldTime->GetSeasonDay().Season : INDEX_NONE;
+}
+
+FName USeasonSubsystem::GetSeasonName() const
+{
+	TArray<FSeasonDefinition> const& Seasons = GetDefault<UEnvironmentSystemSettings>()->Seasons;
+	int32 const Season = GetSeason();
+	return Seasons.IsValidIndex(Season) ? Seasons[Season].Name : NAME_None;
+}
+
+float USeasonSubsystem::GetTemperature() const
+{
+	return WorldTime ? WorldTime->GetSeasonCalendar().GetTemperature(WorldTime->GetWorldDateTime()) : 0.f;
+}
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SolarEventSubsystem.h"
+
+#include "DynamicSkySystem.h"
+#include "EnvironmentSubsystem.h"
+#include "EnvironmentSystemStats.h"
+#include "WorldTimeSubsystem.h"
+#include "Engine/World.h"
+
+namespace
+{
+	constexpr ESolarEvent SolarEvents[] = { ESolarEvent::Midnight, ESolarEvent::CivilDawn, ESolarEvent::Sunrise, ESolarEvent::GoldenHour, ESolarEvent::Sunset, ESolarEvent::CivilDusk };
+
+	constexpr float GoldenHourLength = 1.f;
+
+	// Broadcasting the events of every skipped day does not help anyone, after long jumps only the last day is caught up
+	FTimespan const MaxCatchUp = FTimespan::FromDays(1);
+}
+
+void USolarEventSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Environment = Collection.InitializeDependency<UEnvironmentSubsystem>();
+	WorldTime = Collection.InitializeDependency<UWorldTimeSubsystem>();
+	if(WorldTime)
+	{
+		TimeAdvancedHandle = WorldTime->OnTimeAdvanced.AddUObject(this, &USolarEventSubsystem::HandleTimeAdvanced);
+		Reschedule();
+	}
+}
+
+void USolarEventSubsystem::Deinitialize()
+{
+	if(WorldTime)
+	{
+		WorldTime->OnTimeAdvanced.Remove(TimeAdvancedHandle);
+	}
+
+	Environment = nullptr;
+	WorldTime = nullptr;
+
+	Super::Deinitialize();
+}
+
+bool USolarEventSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+float USolarEventSubsystem::GetEventHour(ESolarEvent const Event, FDateTime const& Date) const
+{
+	// Offsets come from the active sky, the defaults of the sky stand in until one begins play
+	ADynamicSkySystem const* Sky = Environment && Environment->GetSky() ? Environment->GetSky() : GetDefault<ADynamicSkySystem>();
+	float DawnTime = Sky->GetDawnTime();
+	float DuskTime = Sky->GetDuskTime();
+	float const DawnOffset = DawnTime - Sky->GetTrueDawnTime();
+	float const DuskOffset = Sky->GetTrueDuskTime() - DuskTime;
+
+	// The seasons know the dawn and dusk of every day, also of days the sky has not reached yet
+	if(WorldTime && WorldTime->GetSeasonCalendar().HasSeasons())
+	{
+		FSeasonDay const& Day = WorldTime->GetSeasonCalendar().GetDay(Date);
+		DawnTime = Day.DawnTime;
+		DuskTime = Day.DuskTime;
+	}
+
+	float Hour = 0.f;
+	switch(Event)
+	{
+	case ESolarEvent::Midnight:
+		Hour = 0.f;
+		break;
+	case ESolarEvent::CivilDawn:
+		Hour = DawnTime - DawnOffset;
+		break;
+	case ESolarEvent::Sunrise:
+		Hour = DawnTime;
+		break;
+	case ESolarEvent::GoldenHour:
+		Hour = FMath::Max(DuskTime - GoldenHourLength, DawnTime);
+		break;
+	case ESolarEvent::Sunset:
+		Hour = DuskTime;
+		break;
+	case ESolarEvent::CivilDusk:
+		Hour = DuskTime + DuskOffset;
+		break;
+	}
+
+	// Events stay within their day, so the order of the events holds
+	return FMath::Clamp(Hour, 0.f, ADynamicSkySystem::Midnight - UE_KINDA_SMALL_NUMBER);
+}
+
+FDateTime USolarEventSubsystem::GetNextEventTime(ESolarEvent const Event) const
+{
+	if(not WorldTime)
+	{
+		return FDateTime::MaxValue();
+	}
+
+	FDateTime const Now = WorldTime->GetWorldDateTime();
+	FDateTime const Today = Now.GetDate();
+	FDateTime EventTime = Today + FTimespan::FromHours(GetEventHour(Event, Today));
+	if(EventTime <= Now)
+	{
+		FDateTime const Tomorrow = Today + FTimespan::FromDays(1);
+		EventTime = Tomorrow + FTimespan::FromHours(GetEventHour(Event, Tomorrow));
+	}
+
+	return EventTime;
+}
+
+float USolarEventSubsystem::GetSecondsUntil(ESolarEvent const Event) const
+{
+	if(not WorldTime || WorldTime->GetTickRate() <= FTimespan::Zero())
+	{
+		return -1.f;
+	}
+
+	double const Steps = (GetNextEventTime(Event) - WorldTime->GetWorldDateTime()).GetTotalSeconds() / WorldTime->GetTickRate().GetTotalSeconds();
+	return Steps * WorldTime->GetRealWorldTickFrequency();
+}
+
+void USolarEventSubsystem::Reschedule()
+{
+	if(WorldTime)
+	{
+		// Events at the current time are left to come unless they were just broadcast, such as midnight when a new day
+		// moves dawn and dusk
+		CheckedTime = WorldTime->GetWorldDateTime();
+		ScheduleAfter(CheckedTime, LastEventTime == CheckedTime ? LastEvent : INDEX_NONE);
+	}
+}
+
+void USolarEventSubsystem::ScheduleAfter(FDateTime const Time, int32 const AfterEvent)
+{
+	// Events are within their day, so the next one is today or tomorrow
+	NextEventTime = FDateTime::MaxValue();
+	for(int32 Days = 0; Days <= 1; ++Days)
+	{
+		FDateTime const Date = Time.GetDate() + FTimespan::FromDays(Days);
+		for(ESolarEvent const Event : SolarEvents)
+		{
+			FDateTime const EventTime = Date + FTimespan::FromHours(GetEventHour(Event, Date));
+			bool const bIsAfter = EventTime > Time || (EventTime == Time && static_cast<int32>(Event) > AfterEvent);
+			if(bIsAfter && EventTime < NextEventTime)
+			{
+				NextEvent = Event;
+				NextEventTime = EventTime;
+			}
+		}
+	}
+}
+
+void USolarEventSubsystem::HandleTimeAdvanced(FDateTime const OldDate, FTimespan const Elapsed)
+{
+	// A restored save jumps without passing any time, the events start again from where the time was restored to
+	if(OldDate != CheckedTime)
+	{
+		ScheduleAfter(OldDate, LastEventTime == OldDate ? LastEvent : INDEX_NONE);
+	}
+
+	FDateTime const NewDate = OldDate + Elapsed;
+	CheckedTime = NewDate;
+
+	if(NewDate - NextEventTime > MaxCatchUp)
+	{
+		ScheduleAfter(NewDate - MaxCatchUp);
+	}
+
+	while(NextEventTime <= NewDate)
+	{
+		ESolarEvent const Event = NextEvent;
+		FDateTime const EventTime = NextEventTime;
+		ScheduleAfter(EventTime, static_cast<int32>(Event));
+		LastEvent = static_cast<int32>(Event);
+		LastEventTime = EventTime;
+
+		ENVIRONMENT_TRACE_EVENT(TEXT("Solar event %s"), *UEnum::GetValueAsString(Event));
+		OnSolarEvent.Broadcast(Event, EventTime);
+	}
+}
@@ -0,0 +1,617 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherAccumulationSubsystem.h"
+
+#include "DynamicSkySystem.h"
+#include "EnvironmentSubsystem.h"
+#include "EnvironmentSystemLogging.h"
+#include "EnvironmentSystemSettings.h"
+#include "EnvironmentSystemStats.h"
+#include "WeatherDataAssetBase.h"
+#include "WeatherZoneSubsystem.h"
+#include "WorldTimeSubsystem.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "RenderCommandFence.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+#include "Logging/StructuredLog.h"
+#include "Misc/App.h"
+
+namespace
+{
+	constexpr int32 ChannelsPerVector = 4;
+
+	// Share of the sunshine blocked by the clouds of the heaviest precipitation
+	constexpr float PrecipitationSunShade = .8f;
+
+	// Long enough for every channel to reach the level the weather leaves it at
+	constexpr float SettleHours = 24.f * 365.f;
+
+	// Longest step of the sunlight over a partial day, the sun barely moves within it
+	const FTimespan MaxSunlightStep = FTimespan::FromHours(1.);
+
+	// The sun follows a half sine between dawn and dusk, this is its share of full sunshine summed over a day
+	double GetDailySunlightHours(float const DawnTime, float const DuskTime)
+	{
+		return FMath::Max(DuskTime - DawnTime, 0.f) * 2. / PI;
+	}
+
+	// Full sunshine hours between From and To, both hours of the same day
+	double GetSunlightHours(double From, double To, float const DawnTime, float const DuskTime)
+	{
+		double const DayLength = DuskTime - DawnTime;
+		From = FMath::Max<double>(From, DawnTime);
+		To = FMath::Min<double>(To, DuskTime);
+		if(DayLength <= 0. || To <= From)
+		{
+			return 0.;
+		}
+
+		return DayLength / PI * (FMath::Cos(PI * (From - DawnTime) / DayLength) - FMath::Cos(PI * (To - DawnTime) / DayLength));
+	}
+
+	// Mean share of full sunshine over a step of at most a day, starting at Hour
+	float GetSunlight(double const Hour, double const Hours, float const DawnTime, float const DuskTime)
+	{
+		if(Hours <= 0.)
+		{
+			return 0.f;
+		}
+
+		// A step over midnight continues at the start of the day
+		double const End = Hour + Hours;
+		double const SunlightHours = GetSunlightHours(Hour, FMath::Min(End, 24.), DawnTime, DuskTime) + GetSunlightHours(0., End - 24., DawnTime, DuskTime);
+		return static_cast<float>(SunlightHours / Hours);
+	}
+}
+
+void UWeatherAccumulationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
+	bWriteLegacyParameters = Settings->bWriteLegacyAccumulationParameters;
+	Resolution = FMath::Clamp(Settings->AccumulationGridResolution, 1, 256);
+	TileSize = FMath::Max(Settings->AccumulationTileSize, 100.f);
+
+	for(FWeatherAccumulationChannel const& Channel : Settings->AccumulationChannels)
+	{
+		if(Channel.Name.IsNone() || ChannelIndices.Contains(Channel.Name))
+		{
+			continue;
+		}
+
+		ChannelIndices.Add(Channel.Name, NumChannels++);
+		DecayRates.Add(Channel.DecayRate);
+		SunDecayRates.Add(Channel.SunDecayRate);
+		MeltRates.Add(Channel.MeltRate);
+		SunMeltRates.Add(Channel.SunMeltRate);
+		LegacyParameterNames.Add(Channel.LegacyScalarParameterName);
+	}
+
+	int32 const NumTiles = GetNumTiles();
+	Values.Init(0.f, NumChannels * NumTiles);
+	TargetValues.Init(0.f, NumChannels * NumTiles);
+	TargetRates.Init(0.f, NumChannels * NumTiles);
+	SunExposures.Init(1.f, NumTiles);
+	MeltTemperatures.Init(0.f, NumTiles);
+
+	int32 const NumVectors = FMath::DivideAndRoundUp(NumChannels, ChannelsPerVector);
+	for(int32 i = 0; i < NumVectors; ++i)
+	{
+		VectorParameterNames.Add(FName(Settings->AccumulationParameterPrefix + FString::FromInt(i)));
+	}
+	WrittenVectors.Init(FLinearColor::Transparent, NumVectors);
+	WrittenLegacyValues.Init(0.f, NumChannels);
+
+	// World time drives the simulation
+	if(UWorldTimeSubsystem* WorldTime = Collection.InitializeDependency<UWorldTimeSubsystem>())
+	{
+		TimeAdvancedHandle = WorldTime->OnTimeAdvanced.AddUObject(this, &UWeatherAccumulationSubsystem::HandleTimeAdvanced);
+	}
+
+	WorldPostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UWeatherAccumulationSubsystem::HandleWorldPostActorTick);
+}
+
+void UWeatherAccumulationSubsystem::Deinitialize()
+{
+	if(UWorldTimeSubsystem* WorldTime = GetWorld()->GetSubsystem<UWorldTimeSubsystem>())
+	{
+		WorldTime->OnTimeAdvanced.Remove(TimeAdvancedHandle);
+	}
+	FWorldDelegates::OnWorldPostActorTick.Remove(WorldPostActorTickHandle);
+
+	// The render thread may still read the last upload
+	UploadFence.Wait();
+
+	Texture = nullptr;
+	SampledZoneIndex.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UWeatherAccumulationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE || WorldType == EWorldType::Editor;
+}
+
+void UWeatherAccumulationSubsystem::SetParameterCollection(UMaterialParameterCollection* Collection)
+{
+	if(ParameterCollection != Collection)
+	{
+		ParameterCollection = Collection;
+		WriteParameters(true);
+	}
+}
+
+void UWeatherAccumulationSubsystem::SetWeatherPreset(UWeatherDataAssetBase const* Preset)
+{
+	GlobalPreset = Preset;
+	RefreshTileWeather();
+
+	// Nothing advances world time in the editor, and a level that starts in a snow storm starts snowed in
+	if(not GetWorld()->IsGameWorld() || not bHasWeather)
+	{
+		UWorldTimeSubsystem const* WorldTime = GetWorld()->GetSubsystem<UWorldTimeSubsystem>();
+		float DawnTime, DuskTime;
+		GetDayBounds(WorldTime ? WorldTime->GetWorldDateTime() : FDateTime(0), DawnTime, DuskTime);
+		Integrate(SettleHours, static_cast<float>(GetDailySunlightHours(DawnTime, DuskTime) / 24.));
+		WriteParameters(false);
+		MarkTextureDirty();
+	}
+
+	bHasWeather = true;
+}
+
+void UWeatherAccumulationSubsystem::SetViewLocation(FVector const& Location)
+{
+	int32 const Tile = GetTileIndex(Location);
+	if(Tile != ViewTile)
+	{
+		ViewTile = Tile;
+		WriteParameters(false);
+	}
+}
+
+void UWeatherAccumulationSubsystem::HandleTimeAdvanced(FDateTime const OldDate, FTimespan const Elapsed)
+{
+	Advance(OldDate, Elapsed);
+}
+
+void UWeatherAccumulationSubsystem::Advance(FDateTime const StartTime, FTimespan const Elapsed)
+{
+	if(Elapsed <= FTimespan::Zero() || NumChannels == 0)
+	{
+		return;
+	}
+
+	// Weather zones may have been refreshed since the tiles were sampled
+	UWeatherZoneSubsystem const* Zones = GetWorld()->GetSubsystem<UWeatherZoneSubsystem>();
+	if(Zones && &Zones->GetZoneIndex().Get() != SampledZoneIndex.Get())
+	{
+		RefreshTileWeather();
+	}
+
+	float DawnTime, DuskTime;
+	GetDayBounds(StartTime, DawnTime, DuskTime);
+
+	// Whole days see the daily mean of the sunshine, the rest of a day follows the sun in short steps
+	int32 const Days = FMath::FloorToInt32(Elapsed.GetTotalDays());
+	if(Days > 0)
+	{
+		Integrate(Days * 24.f, static_cast<float>(GetDailySunlightHours(DawnTime, DuskTime) / 24.));
+	}
+
+	FDateTime Time = StartTime + FTimespan::FromDays(Days);
+	FTimespan Remaining = Elapsed - FTimespan::FromDays(Days);
+	while(Remaining > FTimespan::Zero())
+	{
+		FTimespan const Step = FMath::Min(Remaining, MaxSunlightStep);
+		double const Hours = Step.GetTotalHours();
+		Integrate(static_cast<float>(Hours), GetSunlight(Time.GetTimeOfDay().GetTotalHours(), Hours, DawnTime, DuskTime));
+		Time += Step;
+		Remaining -= Step;
+	}
+
+	WriteParameters(false);
+	MarkTextureDirty();
+}
+
+void UWeatherAccumulationSubsystem::GetDayBounds(FDateTime const& Date, float& OutDawnTime, float& OutDuskTime) const
+{
+	// The seasons know the dawn and dusk of every day, the defaults of the sky stand in until one begins play
+	UWorldTimeSubsystem const* WorldTime = GetWorld()->GetSubsystem<UWorldTimeSubsystem>();
+	if(WorldTime && WorldTime->GetSeasonCalendar().HasSeasons())
+	{
+		FSeasonDay const& Day = WorldTime->GetSeasonCalendar().GetDay(Date);
+		OutDawnTime = Day.DawnTime;
+		OutDuskTime = Day.DuskTime;
+		return;
+	}
+
+	UEnvironmentSubsystem const* Environment = GetWorld()->GetSubsystem<UEnvironmentSubsystem>();
+	ADynamicSkySystem const* Sky = Environment && Environment->GetSky() ? Environment->GetSky() : GetDefault<ADynamicSkySystem>();
+	OutDawnTime = Sky->GetDawnTime();
+	OutDuskTime = Sky->GetDuskTime();
+}
+
+void UWeatherAccumulationSubsystem::Integrate(float const Hours, float const Sunlight)
+{
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(WeatherAccumulation);
+
+	int32 const NumTiles = GetNumTiles();
+	float const* const Exposures = SunExposures.GetData();
+	float const* const Temperatures = MeltTemperatures.GetData();
+
+	for(int32 Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		float* const ChannelValues = Values.GetData() + Channel * NumTiles;
+		float const* const ChannelTargetValues = TargetValues.GetData() + Channel * NumTiles;
+		float const* const ChannelTargetRates = TargetRates.GetData() + Channel * NumTiles;
+
+		float const Decay = DecayRates[Channel];
+		float const SunDecay = SunDecayRates[Channel] * Sunlight;
+		float const Melt = MeltRates[Channel];
+		float const SunMelt = SunMeltRates[Channel] * Sunlight;
+
+		// dv/dt = Net - Loss * v moves v exponentially towards Net / Loss. The path is monotonic, so clamping the
+		// closed form to 0..1 gives the same result as clamping every step. Weather that drives the channel makes up
+		// for the decay and the melting, so the channel settles on the target value of the weather.
+		for(int32 Tile = 0; Tile < NumTiles; ++Tile)
+		{
+			float const Loss = ChannelTargetRates[Tile] + Decay + SunDecay * Exposures[Tile];
+			float const Net = ChannelTargetRates[Tile] > 0.f ? ChannelTargetValues[Tile] * Loss : -Melt * Temperatures[Tile] - SunMelt * Exposures[Tile];
+
+			float Value;
+			if(Loss > UE_KINDA_SMALL_NUMBER)
+			{
+				float const Equilibrium = Net / Loss;
+				Value = Equilibrium + (ChannelValues[Tile] - Equilibrium) * FMath::Exp(-Loss * Hours);
+			}
+			else
+			{
+				Value = ChannelValues[Tile] + Net * Hours;
+			}
+
+			ChannelValues[Tile] = FMath::Clamp(Value, 0.f, 1.f);
+		}
+	}
+}
+
+void UWeatherAccumulationSubsystem::RefreshTileWeather()
+{
+	UWeatherZoneSubsystem const* Zones = GetWorld()->GetSubsystem<UWeatherZoneSubsystem>();
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> const ZoneIndex = Zones ? Zones->GetZoneIndex() : MakeShared<FWeatherZoneIndex, ESPMode::ThreadSafe>();
+	SampledZoneIndex = ZoneIndex;
+
+	int32 const NumTiles = GetNumTiles();
+	FVector4 const Grid = GetGridParameters();
+
+	// Zones are boxes, the tiles sample them halfway up
+	double const Height = ZoneIndex->IsEmpty() ? 0. : ZoneIndex->GetBounds().GetCenter().Z;
+
+	TArray<FVector> Centers;
+	Centers.SetNumUninitialized(NumTiles);
+	for(int32 Y = 0; Y < Resolution; ++Y)
+	{
+		for(int32 X = 0; X < Resolution; ++X)
+		{
+			Centers[Y * Resolution + X] = FVector(Grid.X + (X + .5) * TileSize, Grid.Y + (Y + .5) * TileSize, Height);
+		}
+	}
+
+	TArray<FWeatherZoneSample> Samples;
+	Samples.SetNum(NumTiles);
+	ZoneIndex->Query(Centers, Samples);
+
+	FMemory::Memzero(TargetValues.GetData(), TargetValues.Num() * sizeof(float));
+	FMemory::Memzero(TargetRates.GetData(), TargetRates.Num() * sizeof(float));
+
+	UWeatherDataAssetBase const* const Global = GlobalPreset.IsValid() ? GlobalPreset.Get() : GetDefault<UWeatherDataAssetBase>();
+
+	for(int32 Tile = 0; Tile < NumTiles; ++Tile)
+	{
+		UWeatherDataAssetBase const* Preset = Samples[Tile].GetDominantPreset();
+		Preset = Preset ? Preset : Global;
+
+		float const Precipitation = Preset->GetPrecipitationType() != EPrecipitationType::None ? Preset->PrecipitationIntensity : 0.f;
+		SunExposures[Tile] = 1.f - Precipitation * PrecipitationSunShade;
+		MeltTemperatures[Tile] = FMath::Max(Preset->Temperature, 0.f);
+
+		for(FWeatherAccumulationTarget const& Target : Preset->Accumulation)
+		{
+			int32 const Channel = FindChannel(Target.Channel);
+			if(Channel != INDEX_NONE)
+			{
+				TargetValues[Channel * NumTiles + Tile] = Target.Value;
+				TargetRates[Channel * NumTiles + Tile] = Target.Rate;
+			}
+		}
+	}
+}
+
+void UWeatherAccumulationSubsystem::SetChannelValue(FName const Channel, float const Value)
+{
+	int32 const Index = FindChannel(Channel);
+	if(Index != INDEX_NONE)
+	{
+		int32 const NumTiles = GetNumTiles();
+		for(int32 Tile = 0; Tile < NumTiles; ++Tile)
+		{
+			Values[Index * NumTiles + Tile] = FMath::Clamp(Value, 0.f, 1.f);
+		}
+
+		WriteParameters(false);
+		MarkTextureDirty();
+	}
+}
+
+float UWeatherAccumulationSubsystem::GetChannelValue(FName const Channel) const
+{
+	int32 const Index = FindChannel(Channel);
+	return Index != INDEX_NONE ? GetValue(Index, ViewTile) : 0.f;
+}
+
+float UWeatherAccumulationSubsystem::GetChannelValueAt(FName const Channel, FVector const& Location) const
+{
+	int32 const Index = FindChannel(Channel);
+	return Index != INDEX_NONE ? GetValue(Index, GetTileIndex(Location)) : 0.f;
+}
+
+void UWeatherAccumulationSubsystem::SaveValues(TArray<FName>& OutChannels, TArray<uint8>& OutValues) const
+{
+	OutChannels.SetNum(NumChannels);
+	for(auto const& [Name, Index] : ChannelIndices)
+	{
+		OutChannels[Index] = Name;
+	}
+
+	OutValues.SetNumUninitialized(Values.Num());
+	for(int32 i = 0; i < Values.Num(); ++i)
+	{
+		OutValues[i] = static_cast<uint8>(FMath::RoundToInt32(Values[i] * MAX_uint8));
+	}
+}
+
+void UWeatherAccumulationSubsystem::LoadValues(TConstArrayView<FName> const SavedChannels, TConstArrayView<uint8> const SavedValues, int32 const SavedResolution)
+{
+	int32 const SavedTiles = SavedResolution * SavedResolution;
+	if(SavedResolution <= 0 || SavedValues.Num() != SavedChannels.Num() * SavedTiles)
+	{
+		UE_LOGFMT(EnvironmentSystem, Warning, "Saved accumulation has {Values} values for {Channels} channels at resolution {Resolution}, keeping the current values",
+			SavedValues.Num(), SavedChannels.Num(), SavedResolution);
+		return;
+	}
+
+	int32 const NumTiles = GetNumTiles();
+	for(int32 SavedChannel = 0; SavedChannel < SavedChannels.Num(); ++SavedChannel)
+	{
+		int32 const Channel = FindChannel(SavedChannels[SavedChannel]);
+		if(Channel == INDEX_NONE)
+		{
+			continue;
+		}
+
+		uint8 const* const ChannelValues = SavedValues.GetData() + SavedChannel * SavedTiles;
+		for(int32 Y = 0; Y < Resolution; ++Y)
+		{
+			int32 const SavedY = Y * SavedResolution / Resolution;
+			for(int32 X = 0; X < Resolution; ++X)
+			{
+				int32 const SavedX = X * SavedResolution / Resolution;
+				Values[Channel * NumTiles + Y * Resolution + X] = static_cast<float>(ChannelValues[SavedY * SavedResolution + SavedX]) / MAX_uint8;
+			}
+		}
+	}
+
+	// The restored values replace the initial settling
+	bHasWeather = true;
+
+	WriteParameters(false);
+	MarkTextureDirty();
+}
+
+int32 UWeatherAccumulationSubsystem::FindChannel(FName const Channel) const
+{
+	int32 const* Index = ChannelIndices.Find(Channel);
+	return Index ? *Index : INDEX_NONE;
+}
+
+FVector4 UWeatherAccumulationSubsystem::GetGridParameters() const
+{
+	// The grid is centered on the origin of the world
+	double const Corner = -.5 * Resolution * TileSize;
+	return FVector4(Corner, Corner, TileSize, Resolution);
+}
+
+int32 UWeatherAccumulationSubsystem::GetTileIndex(FVector const& Location) const
+{
+	FVector4 const Grid = GetGridParameters();
+
+	// Locations outside of the grid use the nearest tile at its edge
+	int32 const X = FMath::Clamp(FMath::FloorToInt32((Location.X - Grid.X) / TileSize), 0, Resolution - 1);
+	int32 const Y = FMath::Clamp(FMath::FloorToInt32((Location.Y - Grid.Y) / TileSize), 0, Resolution - 1);
+	return Y * Resolution + X;
+}
+
+void UWeatherAccumulationSubsystem::ApplyToMaterial(UMaterialInstanceDynamic* Material) const
+{
+	if(not Material || not Texture)
+	{
+		return;
+	}
+
+	FVector4 const Grid = GetGridParameters();
+	Material->SetTextureParameterValue(TextureParameterName, Texture);
+	Material->SetVectorParameterValue(GridParametersParameterName, FLinearColor(Grid.X, Grid.Y, Grid.Z, Grid.W));
+}
+
+void UWeatherAccumulationSubsystem::WriteParameters(bool const bForce)
+{
+	UMaterialParameterCollectionInstance* Instance = ParameterCollection ? GetWorld()->GetParameterCollectionInstance(ParameterCollection) : nullptr;
+	if(not Instance)
+	{
+		return;
+	}
+
+	int32 NumWrites = 0;
+
+	if(bForce)
+	{
+		FVector4 const Grid = GetGridParameters();
+		Instance->SetVectorParameterValue(GridParametersParameterName, FLinearColor(Grid.X, Grid.Y, Grid.Z, Grid.W));
+		++NumWrites;
+	}
+
+	for(int32 Vector = 0; Vector < VectorParameterNames.Num(); ++Vector)
+	{
+		float Packed[ChannelsPerVector] = { 0.f, 0.f, 0.f, 0.f };
+		for(int32 Component = 0; Component < ChannelsPerVector; ++Component)
+		{
+			int32 const Channel = Vector * ChannelsPerVector + Component;
+			Packed[Component] = Channel < NumChannels ? GetValue(Channel, ViewTile) : 0.f;
+		}
+
+		FLinearColor const Value(Packed[0], Packed[1], Packed[2], Packed[3]);
+		if(bForce || Value != WrittenVectors[Vector])
+		{
+			Instance->SetVectorParameterValue(VectorParameterNames[Vector], Value);
+			WrittenVectors[Vector] = Value;
+			++NumWrites;
+		}
+	}
+
+	if(bWriteLegacyParameters)
+	{
+		for(int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			float const Value = GetValue(Channel, ViewTile);
+			if(not LegacyParameterNames[Channel].IsNone() && (bForce || Value != WrittenLegacyValues[Channel]))
+			{
+				Instance->SetScalarParameterValue(LegacyParameterNames[Channel], Value);
+				WrittenLegacyValues[Channel] = Value;
+				++NumWrites;
+			}
+		}
+	}
+
+	ENVIRONMENT_INC_COUNTER(MPCWrites, NumWrites);
+}
+
+void UWeatherAccumulationSubsystem::MarkTextureDirty()
+{
+	if(not FApp::CanEverRender() || NumChannels == 0)
+	{
+		return;
+	}
+
+	// The texture exists right away, so materials can bind it before the first upload
+	if(not Texture)
+	{
+		Texture = UTexture2D::CreateTransient(Resolution, Resolution * VectorParameterNames.Num(), PF_A32B32G32R32F, TEXT("WeatherAccumulation"));
+		Texture->Filter = TF_Bilinear;
+		Texture->SRGB = false;
+		Texture->AddressX = TA_Clamp;
+		Texture->AddressY = TA_Clamp;
+		Texture->UpdateResource();
+		StagedTexels.Reset();
+	}
+
+	// Uploaded once at the end of the frame, however often the values changed during it
+	bTextureDirty = true;
+}
+
+void UWeatherAccumulationSubsystem::HandleWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if(World == GetWorld() && bTextureDirty)
+	{
+		UpdateTexture();
+	}
+}
+
+void UWeatherAccumulationSubsystem::UpdateTexture()
+{
+	bTextureDirty = false;
+
+	if(not Texture)
+	{
+		return;
+	}
+
+	int32 const NumTiles = GetNumTiles();
+	int32 const NumVectors = VectorParameterNames.Num();
+
+	// A new texture starts with all rows uploaded
+	bool const bUploadAll = StagedTexels.Num() != NumVectors * NumTiles;
+	if(bUploadAll)
+	{
+		StagedTexels.SetNumUninitialized(NumVectors * NumTiles);
+	}
+
+	// Texel i is in row i / Resolution, only the span of rows that changed is uploaded
+	int32 FirstRow = Resolution * NumVectors;
+	int32 LastRow = INDEX_NONE;
+	for(int32 Vector = 0; Vector < NumVectors; ++Vector)
+	{
+		for(int32 Tile = 0; Tile < NumTiles; ++Tile)
+		{
+			float Packed[ChannelsPerVector] = { 0.f, 0.f, 0.f, 0.f };
+			for(int32 Component = 0; Component < ChannelsPerVector; ++Component)
+			{
+				int32 const Channel = Vector * ChannelsPerVector + Component;
+				Packed[Component] = Channel < NumChannels ? GetValue(Channel, Tile) : 0.f;
+			}
+
+			FLinearColor const Texel(Packed[0], Packed[1], Packed[2], Packed[3]);
+			int32 const Index = Vector * NumTiles + Tile;
+			if(bUploadAll || StagedTexels[Index] != Texel)
+			{
+				StagedTexels[Index] = Texel;
+				FirstRow = FMath::Min(FirstRow, Index / Resolution);
+				LastRow = FMath::Max(LastRow, Index / Resolution);
+			}
+		}
+	}
+
+	if(LastRow < FirstRow)
+	{
+		return;
+	}
+
+	// The render thread reads the rows later. The upload buffer is reused once it has read the previous upload,
+	// otherwise these rows get a copy of their own.
+	int32 const NumRows = LastRow - FirstRow + 1;
+	SIZE_T const NumBytes = NumRows * Resolution * sizeof(FLinearColor);
+	bool const bReuseUploadBuffer = UploadFence.IsFenceComplete();
+
+	uint8* Data;
+	if(bReuseUploadBuffer)
+	{
+		UploadTexels.SetNumUninitialized(NumRows * Resolution, EAllowShrinking::No);
+		Data = reinterpret_cast<uint8*>(UploadTexels.GetData());
+	}
+	else
+	{
+		Data = static_cast<uint8*>(FMemory::Malloc(NumBytes));
+	}
+	FMemory::Memcpy(Data, StagedTexels.GetData() + FirstRow * Resolution, NumBytes);
+
+	FUpdateTextureRegion2D* const Region = new FUpdateTextureRegion2D(0, FirstRow, 0, 0, Resolution, NumRows);
+	Texture->UpdateTextureRegions(0, 1, Region, Resolution * sizeof(FLinearColor), sizeof(FLinearColor), Data,
+		[bReuseUploadBuffer](uint8* SrcData, FUpdateTextureRegion2D const* Regions)
+		{
+			if(not bReuseUploadBuffer)
+			{
+				FMemory::Free(SrcData);
+			}
+			delete Regions;
+		});
+
+	if(bReuseUploadBuffer)
+	{
+		UploadFence.BeginFence();
+	}
+}
@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherAmbienceComponent.h"
+
+#include "EnvironmentViewSubsystem.h"
+#include "PrecipitationOcclusionSubsystem.h"
+#include "WeatherDataAssetBase.h"
+#include "Components/AudioComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Sound/SoundBase.h"
+
+namespace
+{
+	// Voices quieter than this are stopped and can be reused
+	constexpr float SilentVolume = 1e-3f;
+}
+
+UWeatherAmbienceComponent::UWeatherAmbienceComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+void UWeatherAmbienceComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	AActor* Owner = GetOwner();
+	for(int32 i = 0; i < VoicePoolSize; ++i)
+	{
+		UAudioComponent* AC = NewObject<UAudioComponent>(Owner);
+		AC->SetAutoActivate(false);
+		AC->bAutoDestroy = false;
+		AC->bAllowSpatialization = false;
+		AC->SetupAttachment(Owner->GetRootComponent());
+		AC->RegisterComponent();
+
+		VoiceComponents.Add(AC);
+	}
+
+	Voices.SetNum(VoicePoolSize);
+	AssignLayers();
+}
+
+void UWeatherAmbienceComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for(UAudioComponent* AC : VoiceComponents)
+	{
+		AC->DestroyComponent();
+	}
+
+	VoiceComponents.Empty();
+	Voices.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UWeatherAmbienceComponent::SetWeatherPreset(UWeatherDataAssetBase* Preset)
+{
+	if(CurrentPreset == Preset)
+	{
+		return;
+	}
+
+	CurrentPreset = Preset;
+	AssignLayers();
+}
+
+int32 UWeatherAmbienceComponent::FindVoiceForSound(USoundBase const* Sound) const
+{
+	return VoiceComponents.IndexOfByPredicate([Sound](TObjectPtr<UAudioComponent> const& AC)
+	{
+		return AC->Sound == Sound && AC->IsPlaying();
+	});
+}
+
+void UWeatherAmbienceComponent::AssignLayers()
+{
+	if(VoiceComponents.IsEmpty())
+	{
+		return;
+	}
+
+	// Everything fades out unless the new preset wants it, starting from where the last crossfade left it
+	for(FAmbienceVoice& Voice : Voices)
+	{
+		Voice.StartVolume = Voice.Volume;
+		Voice.TargetVolume = 0.f;
+	}
+
+	bFollowsTransition = false;
+	TransitionProgress = 0.f;
+
+	if(not CurrentPreset)
+	{
+		return;
+	}
+
+	for(FWeatherAmbienceLayer const& Layer : CurrentPreset->AmbienceLayers)
+	{
+		if(not Layer.Sound)
+		{
+			continue;
+		}
+
+		int32 VoiceIndex = FindVoiceForSound(Layer.Sound);
+		if(VoiceIndex == INDEX_NONE)
+		{
+			VoiceIndex = VoiceComponents.IndexOfByPredicate([](TObjectPtr<UAudioComponent> const& AC) { return not AC->IsPlaying(); });
+		}
+
+		if(VoiceIndex == INDEX_NONE)
+		{
+			// Take over the quietest voice that is on its way out
+			float QuietestVolume = TNumericLimits<float>::Max();
+			for(int32 i = 0; i < Voices.Num(); ++i)
+			{
+				if(Voices[i].TargetVolume <= 0.f && Voices[i].Volume < QuietestVolume)
+				{
+					QuietestVolume = Voices[i].Volume;
+					VoiceIndex = i;
+				}
+			}
+		}
+
+		if(VoiceIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		UAudioComponent* AC = VoiceComponents[VoiceIndex];
+		FAmbienceVoice& Voice = Voices[VoiceIndex];
+
+		if(AC->Sound != Layer.Sound || not AC->IsPlaying())
+		{
+			Voice.Volume = 0.f;
+			Voice.StartVolume = 0.f;
+			AC->SetSound(Layer.Sound);
+			AC->SetVolumeMultiplier(0.f);
+			AC->Play();
+		}
+
+		Voice.TargetVolume = Layer.Volume;
+		Voice.ShelteredVolume = Layer.ShelteredVolume;
+	}
+}
+
+void UWeatherAmbienceComponent::SetTransitionProgress(float const Progress)
+{
+	bFollowsTransition = true;
+	TransitionProgress = FMath::Clamp(Progress, 0.f, 1.f);
+}
+
+float UWeatherAmbienceComponent::GetListenerExposure() const
+{
+	UEnvironmentViewSubsystem const* Views = GetWorld()->GetSubsystem<UEnvironmentViewSubsystem>();
+	UPrecipitationOcclusionSubsystem const* Occlusion = GetWorld()->GetSubsystem<UPrecipitationOcclusionSubsystem>();
+	if(not Views || not Occlusion)
+	{
+		return 1.f;
+	}
+
+	int32 NumListeners = 0;
+	int32 NumExposed = 0;
+	for(FEnvironmentView const& View : Views->GetViews())
+	{
+		APlayerController const* PlayerController = View.PlayerController.Get();
+		if(not PlayerController)
+		{
+			continue;
+		}
+
+		FVector ListenerLocation, FrontDirection, RightDirection;
+		PlayerController->GetAudioListenerPosition(ListenerLocation, FrontDirection, RightDirection);
+		++NumListeners;
+		NumExposed += Occlusion->IsPointSheltered(ListenerLocation) ? 0 : 1;
+	}
+
+	return NumListeners > 0 ? static_cast<float>(NumExposed) / NumListeners : 1.f;
+}
+
+void UWeatherAmbienceComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	float const ShelterTarget = GetListenerExposure();
+	ShelterFactor = FMath::FInterpConstantTo(ShelterFactor, ShelterTarget, DeltaTime, 1.f / FMath::Max(ShelterFadeDuration, UE_KINDA_SMALL_NUMBER));
+
+	float const FadeSpeed = 1.f / FMath::Max(CrossfadeDuration, UE_KINDA_SMALL_NUMBER);
+
+	for(int32 i = 0; i < Voices.Num(); ++i)
+	{
+		UAudioComponent* AC = VoiceComponents[i];
+		if(not AC->IsPlaying())
+		{
+			continue;
+		}
+
+		FAmbienceVoice& Voice = Voices[i];
+		Voice.Volume = bFollowsTransition
+			? FMath::Lerp(Voice.StartVolume, Voice.TargetVolume, TransitionProgress)
+			: FMath::FInterpConstantTo(Voice.Volume, Voice.TargetVolume, DeltaTime, FadeSpeed);
+
+		if(Voice.Volume <= SilentVolume && Voice.TargetVolume <= 0.f)
+		{
+			// Back to the pool
+			AC->Stop();
+			Voice.Volume = 0.f;
+			continue;
+		}
+
+		AC->SetVolumeMultiplier(Voice.Volume * FMath::Lerp(Voice.ShelteredVolume, 1.f, ShelterFactor));
+	}
+}
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherCoverComponent.h"
+
+#include "WeatherCoverSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Actor.h"
+
+namespace
+{
+	uint8 QuantizeCover(float const Value)
+	{
+		return static_cast<uint8>(FMath::RoundToInt(FMath::Clamp(Value, 0.f, 1.f) * 255.f));
+	}
+
+	// Closed form of dv/dt = Rate * (Target - v), so long intervals of distant actors land where short steps would
+	float ApproachCover(float const Value, float const Target, float const Rate, float const Elapsed)
+	{
+		return Target + (Value - Target) * FMath::Exp(-Rate * Elapsed);
+	}
+}
+
+void UWeatherCoverComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	RefreshPrimitives();
+
+	if(UWeatherCoverSubsystem* Subsystem = GetWorld()->GetSubsystem<UWeatherCoverSubsystem>())
+	{
+		Subsystem->Register(this);
+	}
+}
+
+void UWeatherCoverComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UWeatherCoverSubsystem* Subsystem = GetWorld()->GetSubsystem<UWeatherCoverSubsystem>())
+	{
+		Subsystem->Unregister(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UWeatherCoverComponent::RefreshPrimitives()
+{
+	Primitives.Reset();
+	if(AActor const* Owner = GetOwner())
+	{
+		Owner->ForEachComponent<UPrimitiveComponent>(false, [this](UPrimitiveComponent* Primitive)
+		{
+			if(PrimitiveTag.IsNone() || Primitive->ComponentHasTag(PrimitiveTag))
+			{
+				Primitives.Add(Primitive);
+			}
+		});
+	}
+
+	// New primitives start without the cover
+	WriteCustomPrimitiveData();
+}
+
+void UWeatherCoverComponent::SetCover(float const InWetness, float const InSnowCover)
+{
+	Wetness = FMath::Clamp(InWetness, 0.f, 1.f);
+	SnowCover = FMath::Clamp(InSnowCover, 0.f, 1.f);
+
+	if(QuantizeCover(Wetness) != WrittenWetness || QuantizeCover(SnowCover) != WrittenSnowCover)
+	{
+		WriteCustomPrimitiveData();
+	}
+}
+
+bool UWeatherCoverComponent::Advance(float const Elapsed, EPrecipitationType const PrecipitationType, float const Intensity)
+{
+	float const RainTarget = PrecipitationType == EPrecipitationType::Rain ? Intensity : 0.f;
+	float const SnowTarget = PrecipitationType == EPrecipitationType::Snow ? Intensity : 0.f;
+
+	SnowCover = ApproachCover(SnowCover, SnowTarget, SnowTarget > SnowCover ? SnowingRate : MeltingRate, Elapsed);
+
+	// Melting snow keeps the actor as wet as the snow that is left
+	float const WetTarget = FMath::Max(RainTarget, SnowTarget > 0.f ? 0.f : SnowCover);
+	Wetness = ApproachCover(Wetness, WetTarget, WetTarget > Wetness ? WettingRate : DryingRate, Elapsed);
+
+	return QuantizeCover(Wetness) != WrittenWetness || QuantizeCover(SnowCover) != WrittenSnowCover;
+}
+
+int32 UWeatherCoverComponent::WriteCustomPrimitiveData()
+{
+	WrittenWetness = QuantizeCover(Wetness);
+	WrittenSnowCover = QuantizeCover(SnowCover);
+
+	// Both values in one call, so every primitive updates its render state once
+	FVector2D const Cover(WrittenWetness / 255.f, WrittenSnowCover / 255.f);
+
+	int32 NumWritten = 0;
+	for(TWeakObjectPtr<UPrimitiveComponent> const& Primitive : Primitives)
+	{
+		if(UPrimitiveComponent* PrimitiveComponent = Primitive.Get())
+		{
+			PrimitiveComponent->SetCustomPrimitiveDataVector2(CustomPrimitiveDataIndex, Cover);
+			++NumWritten;
+		}
+	}
+
+	return NumWritten;
+}
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherCoverSubsystem.h"
+
+#include "EnvironmentSystemSettings.h"
+#include "EnvironmentSystemStats.h"
+#include "EnvironmentViewSubsystem.h"
+#include "WeatherCoverComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+bool UWeatherCoverSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Dedicated servers render no materials
+	return not IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UWeatherCoverSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWeatherCoverSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeatherCoverSubsystem, STATGROUP_EnvironmentSystem);
+}
+
+void UWeatherCoverSubsystem::Register(UWeatherCoverComponent* Component)
+{
+	if(Component)
+	{
+		Component->LastUpdateTime = GetWorld()->GetTimeSeconds();
+		Components.AddUnique(Component);
+	}
+}
+
+void UWeatherCoverSubsystem::Unregister(UWeatherCoverComponent* Component)
+{
+	Components.RemoveSwap(Component);
+}
+
+float UWeatherCoverSubsystem::GetUpdateInterval(float const Distance)
+{
+	UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
+	float const Range = Settings->WeatherCoverFarDistance - Settings->WeatherCoverNearDistance;
+	float const Significance = Range > 0.f
+		? FMath::Clamp((Distance - Settings->WeatherCoverNearDistance) / Range, 0.f, 1.f)
+		: (Distance < Settings->WeatherCoverNearDistance ? 0.f : 1.f);
+
+	return Significance * Settings->WeatherCoverFarInterval;
+}
+
+void UWeatherCoverSubsystem::Tick(float const DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UWeatherExposureSubsystem const* ExposureSubsystem = GetWorld()->GetSubsystem<UWeatherExposureSubsystem>();
+	if(Components.IsEmpty() || not ExposureSubsystem)
+	{
+		return;
+	}
+
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(WeatherCover);
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	if(UEnvironmentViewSubsystem const* Views = GetWorld()->GetSubsystem<UEnvironmentViewSubsystem>())
+	{
+		for(FEnvironmentView const& View : Views->GetViews())
+		{
+			ViewLocations.Add(View.Location);
+		}
+	}
+
+	double const Now = GetWorld()->GetTimeSeconds();
+	int32 const MaxUpdates = GetDefault<UEnvironmentSystemSettings>()->WeatherCoverMaxUpdatesPerFrame;
+
+	DueComponents.Reset();
+	DuePositions.Reset();
+
+	NextComponent = NextComponent < Components.Num() ? NextComponent : 0;
+	int32 Checked = 0;
+	for(; Checked < Components.Num() && DueComponents.Num() < MaxUpdates; ++Checked)
+	{
+		UWeatherCoverComponent* Component = Components[(NextComponent + Checked) % Components.Num()];
+		AActor const* Owner = Component ? Component->GetOwner() : nullptr;
+		if(not Owner)
+		{
+			continue;
+		}
+
+		FVector const Location = Owner->GetActorLocation();
+
+		// Without a view nothing is near, everything is updated at the far interval
+		float DistanceSquared = TNumericLimits<float>::Max();
+		for(FVector const& ViewLocation : ViewLocations)
+		{
+			DistanceSquared = FMath::Min(DistanceSquared, static_cast<float>(FVector::DistSquared(Location, ViewLocation)));
+		}
+
+		if(Now - Component->LastUpdateTime >= GetUpdateInterval(FMath::Sqrt(DistanceSquared)))
+		{
+			DueComponents.Add(Component);
+			DuePositions.Add(Location);
+		}
+	}
+
+	NextComponent = (NextComponent + Checked) % Components.Num();
+
+	if(DueComponents.IsEmpty())
+	{
+		return;
+	}
+
+	// One query for all due components, spread over worker threads when there are many
+	ExposureSubsystem->QueryExposure(DuePositions, Exposure);
+
+	int32 NumWritten = 0;
+	for(int32 i = 0; i < DueComponents.Num(); ++i)
+	{
+		UWeatherCoverComponent* Component = DueComponents[i];
+		float const Elapsed = static_cast<float>(Now - Component->LastUpdateTime);
+		Component->LastUpdateTime = Now;
+
+		if(Component->Advance(Elapsed, Exposure.PrecipitationType[i], Exposure.Intensity[i]))
+		{
+			NumWritten += Component->WriteCustomPrimitiveData();
+		}
+	}
+
+	ENVIRONMENT_INC_COUNTER(PrimitiveDataWrites, NumWritten);
+	CSV_CUSTOM_STAT(EnvironmentSystem, WeatherCoverUpdates, DueComponents.Num(), ECsvCustomStatOp::Set);
+}
@@ -3,3 +3,89 @@
 
 #include "WeatherDataAssetBase.h"
 
+#include "EnvironmentSystemCustomVersion.h"
+#include "EnvironmentSystemStats.h"
+
+FWeatherConfiguration FWeatherConfiguration::Lerp(FWeatherConfiguration const& A, FWeatherConfiguration const& B, float const Alpha)
+{
+	FWeatherConfiguration Result;
+
+	Result.SkylightSettings.Intensity = FMath::Lerp(A.SkylightSettings.Intensity, B.SkylightSettings.Intensity, Alpha);
+
+	Result.DirectionalLightSettings.Intensity = FMath::Lerp(A.DirectionalLightSettings.Intensity, B.DirectionalLightSettings.Intensity, Alpha);
+	Result.DirectionalLightSettings.Color = FMath::Lerp(A.DirectionalLightSettings.Color, B.DirectionalLightSettings.Color, Alpha);
+	Result.DirectionalLightSettings.SourceAngle = FMath::Lerp(A.DirectionalLightSettings.SourceAngle, B.DirectionalLightSettings.SourceAngle, Alpha);
+	Result.DirectionalLightSettings.Temperature = FMath::Lerp(A.DirectionalLightSettings.Temperature, B.DirectionalLightSettings.Temperature, Alpha);
+
+	Result.ExponentialHeightfogSettings.EmissiveScale = FMath::Lerp(A.ExponentialHeightfogSettings.EmissiveScale, B.ExponentialHeightfogSettings.EmissiveScale, Alpha);
+	Result.ExponentialHeightfogSettings.ExtinctionScale = FMath::Lerp(A.ExponentialHeightfogSettings.ExtinctionScale, B.ExponentialHeightfogSettings.ExtinctionScale, Alpha);
+
+	Result.AtmosphereSettings.MultiScattering = FMath::Lerp(A.AtmosphereSettings.MultiScattering, B.AtmosphereSettings.MultiScattering, Alpha);
+	Result.AtmosphereSettings.RaylieghScattering = FMath::Lerp(A.AtmosphereSettings.RaylieghScattering, B.AtmosphereSettings.RaylieghScattering, Alpha);
+	Result.AtmosphereSettings.MieScatteringScale = FMath::Lerp(A.AtmosphereSettings.MieScatteringScale, B.AtmosphereSettings.MieScatteringScale, Alpha);
+	Result.AtmosphereSettings.MieAbsorbtionScale = FMath::Lerp(A.AtmosphereSettings.MieAbsorbtionScale, B.AtmosphereSettings.MieAbsorbtionScale, Alpha);
+	Result.AtmosphereSettings.MieAnisotropy = FMath::Lerp(A.AtmosphereSettings.MieAnisotropy, B.AtmosphereSettings.MieAnisotropy, Alpha);
+	Result.AtmosphereSettings.AerialPerspectiveViewDistance = FMath::Lerp(A.AtmosphereSettings.AerialPerspectiveViewDistance, B.AtmosphereSettings.AerialPerspectiveViewDistance, Alpha);
+
+	return Result;
+}
+
+void UWeatherDataAssetBase::Serialize(FArchive& Ar)
+{
+	// Attributes the loaded effect lists and parameter maps to the environment
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Presets);
+	Ar.UsingCustomVersion(FEnvironmentSystemCustomVersion::GUID);
+	Super::Serialize(Ar);
+}
+
+void UWeatherDataAssetBase::PostLoad()
+{
+	Super::PostLoad();
+
+	// Presets saved before accumulation channels existed described their surface effects through the weather type.
+	// Newer presets without channels are left dry.
+	if(GetLinkerCustomVersion(FEnvironmentSystemCustomVersion::GUID) >= FEnvironmentSystemCustomVersion::AccumulationChannels
+		|| not Accumulation.IsEmpty())
+	{
+		return;
+	}
+
+	auto AddTarget = [this](FName const Channel, float const Rate)
+	{
+		FWeatherAccumulationTarget& Target = Accumulation.AddDefaulted_GetRef();
+		Target.Channel = Channel;
+		Target.Rate = Rate;
+	};
+
+	switch(WeatherType)
+	{
+	case EWeatherTypes::Snowy:
+		AddTarget("Snow", .5f);
+		Temperature = -5.f;
+		break;
+	case EWeatherTypes::Rainy:
+		AddTarget("Wetness", 2.f);
+		if(not bOverrideCloudMode)
+		{
+			bOverrideCloudMode = true;
+			CloudMode = ECloudTypes::Texture2D;
+		}
+		break;
+	default:
+		break;
+	}
+
+	if(bShouldShowRainPuddles)
+	{
+		AddTarget("Puddles", .5f);
+		if(bShouldShowRainPuddleRipples)
+		{
+			AddTarget("Ripples", 30.f);
+		}
+	}
+}
+
+bool UWeatherDataAssetBase::HasWeatherEffects() const
+{
+	return not WeatherEffects.IsEmpty() || not Accumulation.IsEmpty();
+}
@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherEffectDensitySubsystem.h"
+
+#include "EnvironmentSystemSettings.h"
+#include "EnvironmentSystemStats.h"
+#include "FXBudget.h"
+#include "NiagaraComponent.h"
+#include "NiagaraSystem.h"
+#include "NiagaraUserRedirectionParameterStore.h"
+#include "RHI.h"
+#include "Scalability.h"
+#include "WeatherDataAssetBase.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarWeatherDensity(
+	TEXT("es.Weather.Density"),
+	1.f,
+	TEXT("Scales the density parameters of the weather effects, on top of the density of the effects quality level."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<bool> CVarWeatherGovernor(
+	TEXT("es.Weather.Governor"),
+	true,
+	TEXT("Lower the density of the weather effects while the effects or the GPU are over budget."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarWeatherGovernorGPUBudget(
+	TEXT("es.Weather.Governor.GPUBudgetMs"),
+	0.f,
+	TEXT("GPU frame time in milliseconds above which the governor lowers the density, 0 to only use the fx.Budget times. The whole frame counts, so only set this where the weather effects are the GPU cost that matters."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarWeatherGovernorMinDensity(
+	TEXT("es.Weather.Governor.MinDensity"),
+	.25f,
+	TEXT("Lowest share of the density the governor goes down to."),
+	ECVF_Default);
+
+namespace
+{
+	// The density moves in steps, so the governor does not touch the effects every frame
+	constexpr float DensitySteps = 32.f;
+
+	// Share of the density per second the governor takes away while over budget, and gives back while well within it
+	constexpr float GovernorLowerRate = .5f;
+	constexpr float GovernorRaiseRate = .1f;
+	constexpr float GovernorRecoverLoad = .85f;
+
+	float GetEffectsQualityDensity()
+	{
+		TArray<float> const& Densities = GetDefault<UEnvironmentSystemSettings>()->EffectsQualityDensities;
+		if(Densities.IsEmpty())
+		{
+			return 1.f;
+		}
+
+		return Densities[FMath::Clamp(Scalability::GetQualityLevels().EffectsQuality, 0, Densities.Num() - 1)];
+	}
+}
+
+bool UWeatherEffectDensitySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Dedicated servers have no weather effects
+	return not IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UWeatherEffectDensitySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWeatherEffectDensitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeatherEffectDensitySubsystem, STATGROUP_EnvironmentSystem);
+}
+
+void UWeatherEffectDensitySubsystem::Tick(float const DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UpdateGovernor(DeltaTime);
+
+	float const Target = FMath::Max(CVarWeatherDensity.GetValueOnGameThread(), 0.f) * GetEffectsQualityDensity() * GovernorScale;
+	float const NewDensity = FMath::RoundToFloat(Target * DensitySteps) / DensitySteps;
+	if(NewDensity != Density)
+	{
+		Density = NewDensity;
+		++DensityVersion;
+	}
+
+	CSV_CUSTOM_STAT(EnvironmentSystem, WeatherEffectDensity, Density, ECsvCustomStatOp::Set);
+}
+
+void UWeatherEffectDensitySubsystem::UpdateGovernor(float const DeltaTime)
+{
+	if(not CVarWeatherGovernor.GetValueOnGameThread())
+	{
+		GovernorScale = 1.f;
+		Load = 0.f;
+		return;
+	}
+
+	// Niagara reports its CPU time to the fx.Budget when that is enabled. Per effect GPU time is not available at runtime,
+	// the time of the whole GPU frame can stand in for it when opted in.
+	float CurrentLoad = 0.f;
+	if(FFXBudget::Enabled())
+	{
+		FFXTimeData const Usage = FFXBudget::GetAdjustedUsage();
+		CurrentLoad = FMath::Max3(Usage.GT, Usage.GTConcurrent, Usage.RT);
+	}
+
+	float const GPUBudget = CVarWeatherGovernorGPUBudget.GetValueOnGameThread();
+	if(GPUBudget > 0.f)
+	{
+		CurrentLoad = FMath::Max(CurrentLoad, FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles()) / GPUBudget);
+	}
+
+	Load = FMath::FInterpTo(Load, CurrentLoad, DeltaTime, 4.f);
+
+	float const MinScale = FMath::Clamp(CVarWeatherGovernorMinDensity.GetValueOnGameThread(), 0.f, 1.f);
+	if(Load > 1.f)
+	{
+		GovernorScale = FMath::Max(GovernorScale - GovernorLowerRate * DeltaTime, MinScale);
+	}
+	else if(Load < GovernorRecoverLoad)
+	{
+		GovernorScale = FMath::Min(GovernorScale + GovernorRaiseRate * DeltaTime, 1.f);
+	}
+}
+
+void UWeatherEffectDensitySubsystem::ApplyToNiagaraComponent(UNiagaraComponent* Component, FWeatherEffectDefinition const& Effect, float const Scale) const
+{
+	UNiagaraSystem const* System = Component ? Component->GetAsset() : nullptr;
+	if(not System)
+	{
+		return;
+	}
+
+	auto ApplyParameter = [this, Component, System, &Effect, Scale](FName const Name)
+	{
+		float BaseValue = 0.f;
+		if(float const* PresetValue = Effect.WeatherEffectsFloatParameters.Find(Name))
+		{
+			BaseValue = *PresetValue;
+		}
+		else
+		{
+			// Effects that do not expose the parameter are left alone
+			FNiagaraVariable Variable(FNiagaraTypeDefinition::GetFloatDef(), Name);
+			FNiagaraUserRedirectionParameterStore::MakeUserVariable(Variable);
+			if(not System->GetExposedParameters().FindParameterOffset(Variable))
+			{
+				return;
+			}
+			BaseValue = System->GetExposedParameters().GetParameterValue<float>(Variable);
+		}
+
+		Component->SetVariableFloat(Name, BaseValue * Density * Scale);
+	};
+
+	TArray<FName> const& DefaultParameters = GetDefault<UEnvironmentSystemSettings>()->DensityParameterNames;
+	for(FName const Name : DefaultParameters)
+	{
+		ApplyParameter(Name);
+	}
+
+	for(FName const Name : Effect.DensityParameters)
+	{
+		if(not DefaultParameters.Contains(Name))
+		{
+			ApplyParameter(Name);
+		}
+	}
+}
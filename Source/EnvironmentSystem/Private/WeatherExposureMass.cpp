@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherExposureMass.h"
+
+#include "MassCommonFragments.h"
+#include "MassEntityTemplateRegistry.h"
+#include "MassExecutionContext.h"
+#include "WeatherExposureSubsystem.h"
+#include "Engine/World.h"
+
+void UWeatherExposureTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	BuildContext.RequireFragment<FTransformFragment>();
+	BuildContext.AddFragment<FWeatherExposureFragment>();
+}
+
+UWeatherExposureProcessor::UWeatherExposureProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::All);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+	bRequiresGameThreadExecution = false;
+}
+
+void UWeatherExposureProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FWeatherExposureFragment>(EMassFragmentAccess::ReadWrite);
+}
+
+void UWeatherExposureProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	UWeatherExposureSubsystem const* Exposure = UWorld::GetSubsystem<UWeatherExposureSubsystem>(EntityManager.GetWorld());
+	if(not Exposure)
+	{
+		return;
+	}
+
+	FWeatherExposureQuery const Query = Exposure->MakeQuery();
+	float const DeltaTime = Context.GetDeltaTimeSeconds();
+
+	// Reused between chunks
+	TArray<FVector> Positions;
+	FWeatherExposureBuffer ChunkExposure;
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+	{
+		int32 const NumEntities = ChunkContext.GetNumEntities();
+		TConstArrayView<FTransformFragment> const Transforms = ChunkContext.GetFragmentView<FTransformFragment>();
+		TArrayView<FWeatherExposureFragment> const Exposures = ChunkContext.GetMutableFragmentView<FWeatherExposureFragment>();
+
+		Positions.SetNumUninitialized(NumEntities, EAllowShrinking::No);
+		for(int32 i = 0; i < NumEntities; ++i)
+		{
+			Positions[i] = Transforms[i].GetTransform().GetLocation();
+		}
+
+		ChunkExposure.SetNum(NumEntities);
+		Query.Evaluate(Positions, ChunkExposure);
+
+		for(int32 i = 0; i < NumEntities; ++i)
+		{
+			FWeatherExposureFragment& Fragment = Exposures[i];
+			EPrecipitationType const Type = ChunkExposure.PrecipitationType[i];
+			bool const bSheltered = ChunkExposure.bSheltered[i];
+			float const Intensity = bSheltered ? 0.f : ChunkExposure.Intensity[i];
+
+			float const WetnessDelta = Type == EPrecipitationType::Rain && Intensity > 0.f ? Intensity * WettingRate : -DryingRate;
+			float const SnowDelta = Type == EPrecipitationType::Snow && Intensity > 0.f ? Intensity * SnowAccumulationRate : -SnowMeltRate;
+
+			Fragment.Wetness = FMath::Clamp(Fragment.Wetness + WetnessDelta * DeltaTime, 0.f, 1.f);
+			Fragment.SnowCover = FMath::Clamp(Fragment.SnowCover + SnowDelta * DeltaTime, 0.f, 1.f);
+			Fragment.PrecipitationIntensity = Intensity;
+			Fragment.PrecipitationType = Type;
+			Fragment.bSheltered = bSheltered;
+		}
+	});
+}
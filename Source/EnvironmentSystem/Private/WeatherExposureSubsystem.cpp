@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherExposureSubsystem.h"
+
+#include "PrecipitationOcclusionSubsystem.h"
+#include "WeatherDataAssetBase.h"
+#include "WeatherZoneSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeRWLock.h"
+
+namespace
+{
+	// Positions are processed in batches small enough to keep the scratch arrays on the stack
+	constexpr int32 ExposureBatchSize = 256;
+
+	// Below this many positions a query is not worth spreading over worker threads
+	constexpr int32 MinPositionsPerTask = 2048;
+
+	float GetPrecipitationIntensity(UWeatherDataAssetBase const* Preset)
+	{
+		return Preset && Preset->GetPrecipitationType() != EPrecipitationType::None ? Preset->PrecipitationIntensity : 0.f;
+	}
+}
+
+void FWeatherExposureBuffer::SetNum(int32 const NewNum)
+{
+	PrecipitationType.SetNumUninitialized(NewNum);
+	Intensity.SetNumUninitialized(NewNum);
+	bSheltered.SetNumUninitialized(NewNum);
+}
+
+FWeatherExposureQuery::FWeatherExposureQuery(
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> InZoneIndex,
+	TSharedPtr<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> InOcclusionGrid,
+	UWeatherDataAssetBase const* InGlobalPreset,
+	float const InPrecipitationScale)
+	: ZoneIndex(MoveTemp(InZoneIndex))
+	, OcclusionGrid(MoveTemp(InOcclusionGrid))
+	, GlobalPreset(InGlobalPreset)
+	, PrecipitationScale(InPrecipitationScale)
+{
+}
+
+void FWeatherExposureQuery::Evaluate(TConstArrayView<FVector> Positions, FWeatherExposureBuffer& OutExposure, int32 const OutOffset) const
+{
+	check(OutOffset >= 0 && OutOffset + Positions.Num() <= OutExposure.Num());
+
+	Evaluate(Positions, OutExposure.PrecipitationType.GetData() + OutOffset, OutExposure.Intensity.GetData() + OutOffset, OutExposure.bSheltered.GetData() + OutOffset);
+}
+
+void FWeatherExposureQuery::Evaluate(TConstArrayView<FVector> Positions, EPrecipitationType* Types, float* Intensities, bool* Sheltered) const
+{
+	EPrecipitationType const GlobalType = GlobalPreset ? GlobalPreset->GetPrecipitationType() : EPrecipitationType::None;
+	float const GlobalIntensity = GetPrecipitationIntensity(GlobalPreset);
+
+	if(ZoneIndex->IsEmpty())
+	{
+		for(int32 i = 0; i < Positions.Num(); ++i)
+		{
+			Types[i] = GlobalType;
+			Intensities[i] = GlobalIntensity * PrecipitationScale;
+		}
+	}
+	else
+	{
+		EvaluateZones(Positions, Types, Intensities);
+	}
+
+	if(not OcclusionGrid || OcclusionGrid->IsEmpty())
+	{
+		FMemory::Memzero(Sheltered, Positions.Num() * sizeof(bool));
+		return;
+	}
+
+	for(int32 i = 0; i < Positions.Num(); ++i)
+	{
+		Sheltered[i] = OcclusionGrid->IsSheltered(Positions[i]);
+		Intensities[i] = Sheltered[i] ? 0.f : Intensities[i];
+	}
+}
+
+void FWeatherExposureQuery::EvaluateZones(TConstArrayView<FVector> Positions, EPrecipitationType* Types, float* Intensities) const
+{
+	float const GlobalIntensity = GetPrecipitationIntensity(GlobalPreset);
+
+	float FromIntensity[ExposureBatchSize];
+	float ToIntensity[ExposureBatchSize];
+	float Weight[ExposureBatchSize];
+
+	for(int32 BatchStart = 0; BatchStart < Positions.Num(); BatchStart += ExposureBatchSize)
+	{
+		int32 const BatchNum = FMath::Min(ExposureBatchSize, Positions.Num() - BatchStart);
+
+		// Zone lookups are branchy, so they fill plain arrays that the blend below can run over without branches
+		for(int32 i = 0; i < BatchNum; ++i)
+		{
+			FWeatherZoneSample const Sample = ZoneIndex->Query(Positions[BatchStart + i]);
+			UWeatherDataAssetBase const* From = Sample.FallbackPreset ? Sample.FallbackPreset.Get() : GlobalPreset;
+			UWeatherDataAssetBase const* Dominant = Sample.BlendWeight >= .5f ? Sample.Preset.Get() : From;
+
+			FromIntensity[i] = From == GlobalPreset ? GlobalIntensity : GetPrecipitationIntensity(From);
+			ToIntensity[i] = GetPrecipitationIntensity(Sample.Preset);
+			Weight[i] = Sample.Preset ? Sample.BlendWeight : 0.f;
+			Types[BatchStart + i] = Dominant ? Dominant->GetPrecipitationType() : EPrecipitationType::None;
+		}
+
+		float* const BatchIntensities = Intensities + BatchStart;
+		for(int32 i = 0; i < BatchNum; ++i)
+		{
+			BatchIntensities[i] = (FromIntensity[i] + (ToIntensity[i] - FromIntensity[i]) * Weight[i]) * PrecipitationScale;
+		}
+	}
+}
+
+void UWeatherExposureSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ZoneSubsystem = Collection.InitializeDependency<UWeatherZoneSubsystem>();
+	OcclusionSubsystem = Collection.InitializeDependency<UPrecipitationOcclusionSubsystem>();
+}
+
+void UWeatherExposureSubsystem::SetGlobalWeather(UWeatherDataAssetBase* Preset)
+{
+	FWriteScopeLock WriteLock(WeatherLock);
+	GlobalPreset = Preset;
+}
+
+void UWeatherExposureSubsystem::SetPrecipitationScale(float const Scale)
+{
+	FWriteScopeLock WriteLock(WeatherLock);
+	PrecipitationScale = FMath::Clamp(Scale, 0.f, 1.f);
+}
+
+FWeatherExposureQuery UWeatherExposureSubsystem::MakeQuery() const
+{
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> ZoneIndex = ZoneSubsystem ? ZoneSubsystem->GetZoneIndex() : MakeShared<FWeatherZoneIndex, ESPMode::ThreadSafe>();
+	TSharedPtr<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> OcclusionGrid = OcclusionSubsystem ? OcclusionSubsystem->GetOcclusionGrid().ToSharedPtr() : nullptr;
+
+	FReadScopeLock ReadLock(WeatherLock);
+	return FWeatherExposureQuery(MoveTemp(ZoneIndex), MoveTemp(OcclusionGrid), GlobalPreset, PrecipitationScale);
+}
+
+void UWeatherExposureSubsystem::QueryExposure(TConstArrayView<FVector> Positions, FWeatherExposureBuffer& OutExposure) const
+{
+	OutExposure.SetNum(Positions.Num());
+
+	FWeatherExposureQuery const Query = MakeQuery();
+	int32 const NumTasks = FMath::Max(1, Positions.Num() / MinPositionsPerTask);
+
+	if(NumTasks == 1)
+	{
+		Query.Evaluate(Positions, OutExposure);
+		return;
+	}
+
+	int32 const PositionsPerTask = FMath::DivideAndRoundUp(Positions.Num(), NumTasks);
+	ParallelFor(NumTasks, [&](int32 const TaskIndex)
+	{
+		int32 const Start = TaskIndex * PositionsPerTask;
+		int32 const Num = FMath::Min(PositionsPerTask, Positions.Num() - Start);
+		Query.Evaluate(Positions.Slice(Start, Num), OutExposure, Start);
+	});
+}
+
+bool UWeatherExposureSubsystem::CanHavePrecipitation() const
+{
+	// Zones may bring their own precipitation whatever the global weather is
+	if(ZoneSubsystem && not ZoneSubsystem->GetZoneIndex()->IsEmpty())
+	{
+		return true;
+	}
+
+	FReadScopeLock ReadLock(WeatherLock);
+	return GetPrecipitationIntensity(GlobalPreset) * PrecipitationScale > 0.f;
+}
+
+void UWeatherExposureSubsystem::QueryExposureAt(FVector const& Position, EPrecipitationType& OutPrecipitationType, float& OutIntensity, bool& bOutSheltered) const
+{
+	// Straight into the outputs, a single position needs no buffer
+	MakeQuery().Evaluate(MakeArrayView(&Position, 1), &OutPrecipitationType, &OutIntensity, &bOutSheltered);
+}
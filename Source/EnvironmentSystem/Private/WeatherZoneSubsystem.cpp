@@ -0,0 +1,358 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherZoneSubsystem.h"
+
+#include "EnvironmentSystemLogging.h"
+#include "EnvironmentSystemSettings.h"
+#include "WeatherZoneVolume.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeRWLock.h"
+#include "Logging/StructuredLog.h"
+
+namespace
+{
+	// Keeps the grid small for huge zones, the cell size grows instead
+	constexpr int32 MaxGridCellsPerAxis = 512;
+}
+
+FWeatherZoneIndex::FWeatherZoneIndex(TConstArrayView<AWeatherZoneVolume const*> Volumes, double const CellSize)
+{
+	TArray<AWeatherZoneVolume const*> SortedVolumes(Volumes);
+	SortedVolumes.StableSort([](AWeatherZoneVolume const& A, AWeatherZoneVolume const& B)
+	{
+		return A.GetPriority() > B.GetPriority();
+	});
+
+	Zones.Reserve(SortedVolumes.Num());
+	for(AWeatherZoneVolume const* Volume : SortedVolumes)
+	{
+		FBox const ZoneBounds = Volume->GetZoneBounds();
+		if(not ZoneBounds.IsValid)
+		{
+			continue;
+		}
+
+		double const BlendDistance = Volume->GetBlendDistance();
+		Zones.Add({
+			ZoneBounds.Min,
+			ZoneBounds.Max,
+			BlendDistance > UE_KINDA_SMALL_NUMBER ? 1. / BlendDistance : UE_BIG_NUMBER,
+			Volume->GetWeatherPreset() });
+
+		Bounds += ZoneBounds;
+	}
+
+	if(Zones.IsEmpty())
+	{
+		return;
+	}
+
+	FVector const Size = Bounds.GetSize();
+	double const EffectiveCellSize = FMath::Max3(CellSize, Size.X / MaxGridCellsPerAxis, Size.Y / MaxGridCellsPerAxis);
+
+	GridOrigin = FVector2D(Bounds.Min);
+	InvCellSize = 1. / EffectiveCellSize;
+	GridSizeX = FMath::Max(1, FMath::CeilToInt32(Size.X * InvCellSize));
+	GridSizeY = FMath::Max(1, FMath::CeilToInt32(Size.Y * InvCellSize));
+
+	auto GetCellRange = [this](FZone const& Zone, FIntPoint& OutMin, FIntPoint& OutMax)
+	{
+		OutMin.X = FMath::Clamp(FMath::FloorToInt32((Zone.Min.X - GridOrigin.X) * InvCellSize), 0, GridSizeX - 1);
+		OutMin.Y = FMath::Clamp(FMath::FloorToInt32((Zone.Min.Y - GridOrigin.Y) * InvCellSize), 0, GridSizeY - 1);
+		OutMax.X = FMath::Clamp(FMath::FloorToInt32((Zone.Max.X - GridOrigin.X) * InvCellSize), 0, GridSizeX - 1);
+		OutMax.Y = FMath::Clamp(FMath::FloorToInt32((Zone.Max.Y - GridOrigin.Y) * InvCellSize), 0, GridSizeY - 1);
+	};
+
+	// Counting sort of the zones into the cells they overlap, zones are visited in priority order so each cell list stays sorted
+	int32 const NumCells = GridSizeX * GridSizeY;
+	CellStarts.SetNumZeroed(NumCells + 1);
+
+	for(FZone const& Zone : Zones)
+	{
+		FIntPoint Min, Max;
+		GetCellRange(Zone, Min, Max);
+		for(int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			for(int32 X = Min.X; X <= Max.X; ++X)
+			{
+				++CellStarts[Y * GridSizeX + X + 1];
+			}
+		}
+	}
+
+	for(int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		CellStarts[Cell + 1] += CellStarts[Cell];
+	}
+
+	TArray<int32> CellFill(CellStarts.GetData(), NumCells);
+	CellZones.SetNumUninitialized(CellStarts[NumCells]);
+
+	for(int32 ZoneIndex = 0; ZoneIndex < Zones.Num(); ++ZoneIndex)
+	{
+		FIntPoint Min, Max;
+		GetCellRange(Zones[ZoneIndex], Min, Max);
+		for(int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			for(int32 X = Min.X; X <= Max.X; ++X)
+			{
+				CellZones[CellFill[Y * GridSizeX + X]++] = ZoneIndex;
+			}
+		}
+	}
+}
+
+FWeatherZoneSample FWeatherZoneIndex::Query(FVector const& Position) const
+{
+	FWeatherZoneSample Sample;
+
+	int32 const CellX = FMath::FloorToInt32((Position.X - GridOrigin.X) * InvCellSize);
+	int32 const CellY = FMath::FloorToInt32((Position.Y - GridOrigin.Y) * InvCellSize);
+	if(CellX < 0 or CellY < 0 or CellX >= GridSizeX or CellY >= GridSizeY)
+	{
+		return Sample;
+	}
+
+	int32 const Cell = CellY * GridSizeX + CellX;
+	int32 const* CellStartsData = CellStarts.GetData();
+	int32 const* CellZonesData = CellZones.GetData();
+	FZone const* ZonesData = Zones.GetData();
+
+	for(int32 i = CellStartsData[Cell], End = CellStartsData[Cell + 1]; i < End; ++i)
+	{
+		FZone const& Zone = ZonesData[CellZonesData[i]];
+
+		// Distance to the closest face, negative when outside
+		double const DistanceInside = FMath::Min3(
+			FMath::Min(Position.X - Zone.Min.X, Zone.Max.X - Position.X),
+			FMath::Min(Position.Y - Zone.Min.Y, Zone.Max.Y - Position.Y),
+			FMath::Min(Position.Z - Zone.Min.Z, Zone.Max.Z - Position.Z));
+
+		if(DistanceInside <= 0.)
+		{
+			continue;
+		}
+
+		float const Weight = static_cast<float>(FMath::Min(DistanceInside * Zone.InvBlendDistance, 1.));
+		if(not Sample.Preset)
+		{
+			Sample.Preset = Zone.Preset;
+			Sample.BlendWeight = Weight;
+			if(Weight >= 1.f)
+			{
+				break;
+			}
+		}
+		else if(Weight >= 1.f)
+		{
+			// The first zone we are fully inside is what the top zone blends from
+			Sample.FallbackPreset = Zone.Preset;
+			break;
+		}
+	}
+
+	return Sample;
+}
+
+void FWeatherZoneIndex::Query(TConstArrayView<FVector> Positions, TArrayView<FWeatherZoneSample> OutSamples) const
+{
+	check(Positions.Num() == OutSamples.Num());
+
+	if(IsEmpty())
+	{
+		for(FWeatherZoneSample& Sample : OutSamples)
+		{
+			Sample = {};
+		}
+		return;
+	}
+
+	for(int32 i = 0; i < Positions.Num(); ++i)
+	{
+		OutSamples[i] = Query(Positions[i]);
+	}
+}
+
+void UWeatherZoneSubsystem::Deinitialize()
+{
+	RegisteredZones.Empty();
+	IndexedPresets.Empty();
+	bZonesDirty = false;
+	{
+		FWriteScopeLock WriteLock(ZoneIndexLock);
+		ZoneIndex = MakeShared<FWeatherZoneIndex, ESPMode::ThreadSafe>();
+	}
+
+	Super::Deinitialize();
+}
+
+void UWeatherZoneSubsystem::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(InThis, Collector);
+
+	// The queries of a replaced index return its presets, so they must outlive the index and not just the refresh
+	UWeatherZoneSubsystem* This = CastChecked<UWeatherZoneSubsystem>(InThis);
+	for(FIndexedPresets& Entry : This->IndexedPresets)
+	{
+		Collector.AddReferencedObjects(Entry.Presets);
+	}
+}
+
+void UWeatherZoneSubsystem::RegisterZone(AWeatherZoneVolume* Zone)
+{
+	if(Zone)
+	{
+		RegisteredZones.AddUnique(Zone);
+		MarkZonesDirty();
+	}
+}
+
+void UWeatherZoneSubsystem::UnregisterZone(AWeatherZoneVolume* Zone)
+{
+	if(RegisteredZones.Remove(Zone) > 0)
+	{
+		MarkZonesDirty();
+	}
+}
+
+void UWeatherZoneSubsystem::MarkZonesDirty()
+{
+	// A level streaming in registers its zones one by one, the index is built once for all of them on first use or
+	// at the start of the next frame
+	if(not bZonesDirty)
+	{
+		bZonesDirty = true;
+		GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(this, &UWeatherZoneSubsystem::RefreshDirtyZones));
+	}
+}
+
+void UWeatherZoneSubsystem::RefreshDirtyZones()
+{
+	if(bZonesDirty)
+	{
+		RefreshZones();
+	}
+}
+
+void UWeatherZoneSubsystem::RefreshZones()
+{
+	check(IsInGameThread());
+
+	bZonesDirty = false;
+
+	RegisteredZones.RemoveAll([](TWeakObjectPtr<AWeatherZoneVolume> const& Zone) { return not Zone.IsValid(); });
+
+	TArray<AWeatherZoneVolume const*> Volumes;
+	Volumes.Reserve(RegisteredZones.Num());
+	TArray<TObjectPtr<UWeatherDataAssetBase>> Presets;
+
+	for(TWeakObjectPtr<AWeatherZoneVolume> const& Zone : RegisteredZones)
+	{
+		if(Zone->GetWeatherPreset())
+		{
+			Volumes.Add(Zone.Get());
+			Presets.AddUnique(Zone->GetWeatherPreset());
+		}
+	}
+
+	UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> NewIndex = MakeShared<FWeatherZoneIndex, ESPMode::ThreadSafe>(Volumes, FMath::Max(Settings->WeatherZoneGridCellSize, 100.f));
+
+	{
+		FWriteScopeLock WriteLock(ZoneIndexLock);
+		ZoneIndex = NewIndex;
+	}
+
+	// Once swapped out an index can only be copied from a thread that still holds it, so an index only held here is done
+	IndexedPresets.RemoveAll([](FIndexedPresets const& Entry) { return Entry.Index.IsUnique(); });
+	IndexedPresets.Add({ NewIndex, MoveTemp(Presets) });
+}
+
+TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> UWeatherZoneSubsystem::GetZoneIndex() const
+{
+	// Other threads keep the last index until the game thread has built the new one
+	if(IsInGameThread() && bZonesDirty)
+	{
+		const_cast<UWeatherZoneSubsystem*>(this)->RefreshZones();
+	}
+
+	FReadScopeLock ReadLock(ZoneIndexLock);
+	return ZoneIndex;
+}
+
+bool UWeatherZoneSubsystem::HasZones() const
+{
+	return not GetZoneIndex()->IsEmpty();
+}
+
+FWeatherZoneSample UWeatherZoneSubsystem::QueryWeatherAt(FVector const& Position) const
+{
+	return GetZoneIndex()->Query(Position);
+}
+
+void UWeatherZoneSubsystem::BatchQueryWeather(TArray<FVector> const& Positions, TArray<FWeatherZoneSample>& OutSamples) const
+{
+	OutSamples.SetNum(Positions.Num());
+	GetZoneIndex()->Query(Positions, OutSamples);
+}
+
+static void BenchmarkWeatherZoneQueries(TArray<FString> const& Args, UWorld* World)
+{
+	UWeatherZoneSubsystem const* Zones = World ? World->GetSubsystem<UWeatherZoneSubsystem>() : nullptr;
+	if(not Zones or not Zones->HasZones())
+	{
+		UE_LOGFMT(EnvironmentSystem, Warning, "es.WeatherZones.Benchmark: there are no weather zones in the world");
+		return;
+	}
+
+	int32 const NumQueries = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+	int32 const NumFrames = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 100;
+
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> const Index = Zones->GetZoneIndex();
+
+	// Sample a slightly larger box than the zones so that misses are part of the measurement
+	FBox const SampleBounds = Index->GetBounds().ExpandBy(Index->GetBounds().GetExtent() * .1);
+	FRandomStream Random(1337);
+
+	TArray<FVector> Positions;
+	Positions.SetNumUninitialized(NumQueries);
+	for(FVector& Position : Positions)
+	{
+		Position = Random.RandPointInBox(SampleBounds);
+	}
+
+	TArray<FWeatherZoneSample> Samples;
+	Samples.SetNumUninitialized(NumQueries);
+
+	double BestFrame = TNumericLimits<double>::Max();
+	double TotalTime = 0.;
+	int32 NumInside = 0;
+
+	for(int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		double const Start = FPlatformTime::Seconds();
+		Index->Query(Positions, Samples);
+		double const Elapsed = FPlatformTime::Seconds() - Start;
+
+		BestFrame = FMath::Min(BestFrame, Elapsed);
+		TotalTime += Elapsed;
+	}
+
+	for(FWeatherZoneSample const& Sample : Samples)
+	{
+		NumInside += Sample.Preset != nullptr;
+	}
+
+	double const AverageFrame = TotalTime / NumFrames;
+	UE_LOGFMT(EnvironmentSystem, Display,
+		"es.WeatherZones.Benchmark: {Queries} queries x {Frames} frames, avg {AvgMs} ms/frame, best {BestMs} ms/frame, {NsPerQuery} ns/query, {Inside} inside a zone",
+		NumQueries, NumFrames, AverageFrame * 1000., BestFrame * 1000., AverageFrame * 1e9 / NumQueries, NumInside);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkWeatherZonesCommand(
+	TEXT("es.WeatherZones.Benchmark"),
+	TEXT("Times batched weather zone point queries. Usage: es.WeatherZones.Benchmark [NumQueries=10000] [NumFrames=100]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkWeatherZoneQueries));
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeatherZoneVolume.h"
+
+#include "WeatherZoneSubsystem.h"
+#include "Components/BoxComponent.h"
+
+AWeatherZoneVolume::AWeatherZoneVolume()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	ZoneBox = CreateDefaultSubobject<UBoxComponent>(TEXT("Zone Box"));
+	ZoneBox->SetBoxExtent(FVector(10000.f));
+	ZoneBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	ZoneBox->SetGenerateOverlapEvents(false);
+	ZoneBox->SetMobility(EComponentMobility::Static);
+	SetRootComponent(ZoneBox);
+}
+
+FBox AWeatherZoneVolume::GetZoneBounds() const
+{
+	return ZoneBox->Bounds.GetBox();
+}
+
+void AWeatherZoneVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if(UWeatherZoneSubsystem* Zones = GetWorld()->GetSubsystem<UWeatherZoneSubsystem>())
+	{
+		Zones->RegisterZone(this);
+	}
+}
+
+void AWeatherZoneVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UWeatherZoneSubsystem* Zones = GetWorld()->GetSubsystem<UWeatherZoneSubsystem>())
+	{
+		Zones->UnregisterZone(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
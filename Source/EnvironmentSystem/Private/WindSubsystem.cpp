@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WindSubsystem.h"
+
+#include "DynamicSkySystem.h"
+#include "EnvironmentSubsystem.h"
+#include "EnvironmentSystemSettings.h"
+#include "EnvironmentSystemStats.h"
+#include "EnvironmentViewSubsystem.h"
+#include "NiagaraComponent.h"
+#include "WeatherDataAssetBase.h"
+#include "Engine/World.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+#include "Misc/ScopeRWLock.h"
+
+namespace
+{
+	constexpr float MetersToCentimeters = 100.f;
+	constexpr float NoisePeriod = 256.f;
+
+	// Gust fronts are wider across the wind than along it
+	constexpr double GustAspect = 4.;
+}
+
+FWindField::FWindField(FVector2D const InBaseVelocity, float const InGustStrength, float const InGustLength, float const InGustPhase)
+	: Speed(InBaseVelocity.Size())
+	, GustStrength(InGustStrength)
+	, GustLength(FMath::Max(InGustLength, 1.f))
+	, GustPhase(InGustPhase)
+{
+	Direction = Speed > UE_KINDA_SMALL_NUMBER ? InBaseVelocity / Speed : FVector2D(1., 0.);
+}
+
+FVector FWindField::Sample(FVector const& Position) const
+{
+	if(Speed <= 0.f)
+	{
+		return FVector::ZeroVector;
+	}
+
+	// The gusts move downwind with the phase
+	FVector2D const Position2D(Position);
+	double const Along = FVector2D::DotProduct(Position2D, Direction) / GustLength;
+	double const Across = FVector2D::CrossProduct(Direction, Position2D) / (GustLength * GustAspect);
+	float const Gust = FMath::PerlinNoise2D(FVector2D(FMath::Fmod(GustPhase - Along, static_cast<double>(NoisePeriod)), FMath::Fmod(Across, static_cast<double>(NoisePeriod))));
+
+	return FVector(Direction * Speed * FMath::Max(1.f + GustStrength * Gust, 0.f), 0.);
+}
+
+void UWindSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Environment = Collection.InitializeDependency<UEnvironmentSubsystem>();
+
+	// Starts with the default wind of a weather preset, so skies without one keep their clouds moving
+	FWeatherWindSettings const Default;
+	Velocity = FVector2D(MetersToCentimeters * Default.Speed, 0.);
+	GustStrength = Default.GustStrength;
+	GustsPerMinute = Default.GustsPerMinute;
+}
+
+void UWindSubsystem::Deinitialize()
+{
+	Environment = nullptr;
+
+	Super::Deinitialize();
+}
+
+bool UWindSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWindSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWindSubsystem, STATGROUP_EnvironmentSystem);
+}
+
+void UWindSubsystem::Tick(float const DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// The wind of the weather at the camera, without a preset the wind keeps blowing as it does
+	ADynamicSkySystem const* Sky = Environment ? Environment->GetSky() : nullptr;
+	if(UWeatherDataAssetBase const* Preset = Sky ? Sky->GetActiveWeatherPreset() : nullptr)
+	{
+		FWeatherWindSettings const& Wind = Preset->Wind;
+		float const BlendSpeed = GetDefault<UEnvironmentSystemSettings>()->WindBlendSpeed;
+
+		float Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Wind.Direction));
+		FVector2D const TargetVelocity = FVector2D(Cos, Sin) * Wind.Speed * MetersToCentimeters;
+
+		Velocity = FMath::Vector2DInterpTo(Velocity, TargetVelocity, DeltaTime, BlendSpeed);
+		GustStrength = FMath::FInterpTo(GustStrength, Wind.GustStrength, DeltaTime, BlendSpeed);
+		GustsPerMinute = FMath::FInterpTo(GustsPerMinute, Wind.GustsPerMinute, DeltaTime, BlendSpeed);
+	}
+
+	float const Speed = Velocity.Size();
+	float const GustsPerSecond = GustsPerMinute / 60.f;
+	float const GustLength = GustsPerSecond > 0.f ? Speed / GustsPerSecond : 1.f;
+	GustPhase = FMath::Fmod(GustPhase + GustsPerSecond * DeltaTime, NoisePeriod);
+
+	TSharedRef<FWindField, ESPMode::ThreadSafe> const Field = MakeShared<FWindField, ESPMode::ThreadSafe>(Velocity, GustsPerSecond > 0.f ? GustStrength : 0.f, GustLength, GustPhase);
+	{
+		FWriteScopeLock WriteLock(FieldLock);
+		PublishedField = Field;
+	}
+
+	// Materials only know one wind at the camera, the primary view's
+	if(UEnvironmentViewSubsystem const* Views = GetWorld()->GetSubsystem<UEnvironmentViewSubsystem>())
+	{
+		ViewLocation = Views->GetPrimaryViewLocation(ViewLocation);
+	}
+
+	// Dedicated servers answer gameplay queries, only clients render the wind
+	if(not IsRunningDedicatedServer())
+	{
+		WriteParameters(*Field);
+	}
+
+	CSV_CUSTOM_STAT(EnvironmentSystem, WindSpeed, Speed, ECsvCustomStatOp::Set);
+}
+
+void UWindSubsystem::WriteParameters(FWindField const& Field) const
+{
+	ADynamicSkySystem const* Sky = Environment ? Environment->GetSky() : nullptr;
+	UMaterialParameterCollection* Collection = Sky ? Sky->GetWeatherParameterCollection() : nullptr;
+	UMaterialParameterCollectionInstance* Instance = Collection ? GetWorld()->GetParameterCollectionInstance(Collection) : nullptr;
+	if(not Instance)
+	{
+		return;
+	}
+
+	// Only parameters the collection declares are written, so the counter matches the writes that happen
+	int32 NumWrites = 0;
+
+	// Direction of the wind, the speed at the camera with gusts and the speed without them
+	if(Collection->GetVectorParameterByName(WindParameterName))
+	{
+		FVector const Base = Field.GetBaseVelocity();
+		FVector2D const Direction = FVector2D(Base).GetSafeNormal();
+		Instance->SetVectorParameterValue(WindParameterName, FLinearColor(Direction.X, Direction.Y, Field.Sample(ViewLocation).Size(), Field.GetBaseSpeed()));
+		++NumWrites;
+	}
+
+	if(Collection->GetVectorParameterByName(GustParameterName))
+	{
+		Instance->SetVectorParameterValue(GustParameterName, Field.GetGustParameters());
+		++NumWrites;
+	}
+
+	ENVIRONMENT_INC_COUNTER(MPCWrites, NumWrites);
+}
+
+TSharedRef<FWindField const, ESPMode::ThreadSafe> UWindSubsystem::GetWindField() const
+{
+	FReadScopeLock ReadLock(FieldLock);
+	return PublishedField;
+}
+
+FVector UWindSubsystem::GetWindAt(FVector const& Position) const
+{
+	return GetWindField()->Sample(Position);
+}
+
+void UWindSubsystem::ApplyToNiagaraComponent(UNiagaraComponent* Component, FVector const& CameraLocation) const
+{
+	if(not Component)
+	{
+		return;
+	}
+
+	TSharedRef<FWindField const, ESPMode::ThreadSafe> const Field = GetWindField();
+	Component->SetVariableVec3(NiagaraVelocityParameterName, Field->Sample(CameraLocation));
+	FLinearColor const Gust = Field->GetGustParameters();
+	Component->SetVariableVec4(GustParameterName, FVector4(Gust.R, Gust.G, Gust.B, Gust.A));
+}
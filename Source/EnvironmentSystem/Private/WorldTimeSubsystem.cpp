@@ -1,10 +1,12 @@
 ﻿#include "WorldTimeSubsystem.h"
 #include "EnvironmentSystemSettings.h"
 #include "EnvironmentSystemLogging.h"
+#include "EnvironmentSystemStats.h"
 #include "Logging/StructuredLog.h"
 
 void UWorldTimeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Time);
 	Super::Initialize(Collection);
 
 	UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
@@ -17,6 +19,8 @@ void UWorldTimeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	{
 		UE_LOGFMT(EnvironmentSystem, Error, "Unable to get instance of UEnvironmentSystemSettings. This is required for the environmemt system to work.");
 	}
+
+	UpdateSeasonCalendar();
 }
 
 void UWorldTimeSubsystem::Deinitialize()
@@ -26,6 +30,9 @@ void UWorldTimeSubsystem::Deinitialize()
 
 void UWorldTimeSubsystem::Tick(float const DeltaTime)
 {
+	ENVIRONMENT_SCOPE_CYCLE_COUNTER(WorldTimeTick);
+	LLM_SCOPE_BYTAG(EnvironmentSystem_Time);
+
 	TickAccumulator += DeltaTime;
 	if (TickAccumulator < RealWorldTickFrequency)
 	{
@@ -37,32 +44,86 @@ void UWorldTimeSubsystem::Tick(float const DeltaTime)
 	TickAccumulator = 0;
 }
 
+TStatId UWorldTimeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWorldTimeSubsystem, STATGROUP_EnvironmentSystem);
+}
+
 void UWorldTimeSubsystem::HandleNotifications(FDateTime const OldDate) const
 {
-	if (OldDate.GetHour() == WorldDateTime.GetHour() and OnHourChanged.IsBound())
+	// The trace events mark the changes whether or not anything listens
+	if (OldDate.GetHour() != WorldDateTime.GetHour())
 	{
+		ENVIRONMENT_TRACE_EVENT(TEXT("Hour changed to %d"), WorldDateTime.GetHour());
 		OnHourChanged.Broadcast(WorldDateTime);
 	}
 	
-	if (OldDate.GetDayOfWeek() == WorldDateTime.GetDayOfWeek() and OnDayChanged.IsBound())
+	if (OldDate.GetDayOfWeek() != WorldDateTime.GetDayOfWeek())
 	{
+		ENVIRONMENT_TRACE_EVENT(TEXT("Day changed to %d"), WorldDateTime.GetDay());
 		OnDayChanged.Broadcast(WorldDateTime);
 	}
 
 	if (OldDate.GetDayOfWeek() == EDayOfWeek::Sunday
-		and WorldDateTime.GetDayOfWeek() == EDayOfWeek::Monday
-		and OnWeekChanged.IsBound())
+		and WorldDateTime.GetDayOfWeek() == EDayOfWeek::Monday)
 	{
+		ENVIRONMENT_TRACE_EVENT(TEXT("Week changed"));
 		OnWeekChanged.Broadcast(WorldDateTime);
 	}
 
-	// TODO: Notify season change
+	NotifySeasonChange(OldDate);
+}
+
+void UWorldTimeSubsystem::NotifySeasonChange(FDateTime const OldDate) const
+{
+	// Dates of the previous year use the day with the same number, close enough to tell the season
+	int32 const Season = SeasonCalendar.GetSeason(WorldDateTime);
+	if (SeasonCalendar.GetSeason(OldDate) != Season)
+	{
+		ENVIRONMENT_TRACE_EVENT(TEXT("Season changed to %d"), Season);
+		OnSeasonChanged.Broadcast(WorldDateTime, Season);
+	}
+}
+
+void UWorldTimeSubsystem::SetWorldDateTime(FDateTime const NewDateTime)
+{
+	FDateTime const OldDate = WorldDateTime;
+	WorldDateTime = NewDateTime;
+	UpdateSeasonCalendar();
+	NotifySeasonChange(OldDate);
+
+	if (WorldDateTime > OldDate)
+	{
+		OnTimeAdvanced.Broadcast(OldDate, WorldDateTime - OldDate);
+	}
+}
+
+void UWorldTimeSubsystem::RestoreWorldDateTime(FDateTime const NewDateTime)
+{
+	WorldDateTime = NewDateTime;
+	TickAccumulator = 0.f;
+	UpdateSeasonCalendar();
+}
+
+void UWorldTimeSubsystem::UpdateSeasonCalendar()
+{
+	if (not SeasonCalendar.IsBuiltFor(WorldDateTime.GetYear()))
+	{
+		UEnvironmentSystemSettings const* Settings = GetDefault<UEnvironmentSystemSettings>();
+		SeasonCalendar.Build(Settings->bEnableSeasons ? TConstArrayView<FSeasonDefinition>(Settings->Seasons) : TConstArrayView<FSeasonDefinition>(), WorldDateTime.GetYear());
+	}
 }
 
 void UWorldTimeSubsystem::TickInternal(float const DeltaTime)
 {
 	FDateTime const OldDate = WorldDateTime;
 	WorldDateTime += TickRate;
+	UpdateSeasonCalendar();
 
 	HandleNotifications(OldDate);
+
+	if (WorldDateTime > OldDate)
+	{
+		OnTimeAdvanced.Broadcast(OldDate, TickRate);
+	}
 }
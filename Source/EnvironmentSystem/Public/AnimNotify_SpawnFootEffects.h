@@ -31,10 +31,10 @@ protected:
 	virtual FString GetNotifyName_Implementation() const override;
 	virtual void Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference) override;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Dynamic Weather")
-	TObjectPtr<UMaterialParameterCollection> WeatherMaterialParameterCollection;
+	// No rain splashes under roofs and bridges
+	static bool IsSheltered(UWorld const* World, FVector const& Location);
 
-	// Only spawn snowy footprints or rain splashes when the snow strength is above this threshold or puddles have formed on the landscape
+	// Only spawn snowy footprints or rain splashes when the snow channel is above this threshold or puddles have formed on the landscape
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Dynamic Weather", meta = (ClampMin=0, ClampMax=1))
 	float SpawnSnowFootprintsThreshold { .5f };
 	
@@ -61,9 +61,11 @@ protected:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Notification")
 	EFootType CurrentLandingFoot;
-	
-	TObjectPtr<UMaterialParameterCollectionInstance> WeatherMaterialParameterCollectionInstance;
-	
-	FName SnowStrengthParameterName { "SnowStrength" };
-	FName ShowPuddlesParameterName { "ShowPuddles" };
+
+	// Accumulation channels that decide between footprints and splashes
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Dynamic Weather")
+	FName SnowChannelName { "Snow" };
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Dynamic Weather")
+	FName PuddlesChannelName { "Puddles" };
 };
@@ -3,15 +3,23 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "EnvironmentFrameState.h"
+#include "PrecipitationVolume.h"
 #include "Components/TimelineComponent.h"
 #include "GameFramework/Actor.h"
+#include "Tasks/Task.h"
+#include "WeatherZoneSubsystem.h"
 #include "DynamicSkySystem.generated.h"
 
+class ADynamicSkySystem;
 struct FWeatherConfiguration;
 class UWeatherDataAssetBase;
 
 class UVolumetricCloudComponent;
 class UPostProcessComponent;
+class ULensRainComponent;
+class ULightningComponent;
+class UWeatherAmbienceComponent;
 class UDirectionalLightComponent;
 class USkyAtmosphereComponent;
 class USkyLightComponent;
@@ -37,12 +45,46 @@ enum class ESunPositions
 	SunSet = -180
 };
 
-UENUM()
-enum class ECloudTypes
+// Weather effects presented to one view, all views share the weather they show
+USTRUCT()
+struct FDynamicSkyWeatherView
+{
+	GENERATED_BODY()
+
+	// One component per effect of the active preset
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UNiagaraComponent>> Components;
+
+	// Smoothed camera velocity the precipitation volume leads by
+	FVector Velocity { ForceInit };
+	FVector LastLocation { ForceInit };
+	bool bHasLastLocation { false };
+
+	// Spawn rate share of the precipitation volume, applied with the effect density
+	float SpawnScale { 1.f };
+	float AppliedSpawnScale { 1.f };
+};
+
+// Copies the environment state computed on a worker thread into the components of the sky
+USTRUCT()
+struct FDynamicSkyApplyFrameStateTickFunction : public FTickFunction
 {
-	None = 0,
-	Texture2D,
-	Volumetric
+	GENERATED_BODY()
+
+	ADynamicSkySystem* Target { nullptr };
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FDynamicSkyApplyFrameStateTickFunction> : public TStructOpsTypeTraitsBase2<FDynamicSkyApplyFrameStateTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
 };
 
 UCLASS()
@@ -56,19 +98,78 @@ public:
 
 	virtual void Tick(float DeltaTime) override;
 
-	inline bool IsDaytime() const;
-	inline bool IsNightTime() const;
+	bool IsDaytime() const;
+	bool IsNightTime() const;
 
-	// Start increasing the snow strength and enable the current weather effect
+	// False while another sky drives the environment of the world, see UEnvironmentSubsystem
+	bool IsActiveSky() const { return bIsActiveSky; }
+
+	// Start fading in the precipitation and enable the current weather effect
 	void StartWeatherAndAnimateTransition();
 
 	// Immediately go to a snowy landscape without intermediate  transition
 	void SetIsSNowing(bool bIsSNowing) const;
+
+	// The preset that drives effects and the landscape, which is the dominant weather zone at the camera or CurrentWeatherPreset
+	UWeatherDataAssetBase* GetActiveWeatherPreset() const;
+
+	// Changes the global weather, its effects fade in with the weather transition
+	UFUNCTION(BlueprintCallable, Category = "Dynamic Sky")
+	void SetWeatherPreset(UWeatherDataAssetBase* Preset);
+
+	UWeatherDataAssetBase* GetWeatherPreset() const { return CurrentWeatherPreset; }
+
+	// The lights follow with the next frame state, or immediately when the sky does not tick
+	UFUNCTION(BlueprintCallable, Category = "Dynamic Sky")
+	void SetTimeOfDay(float NewTimeOfDay);
+
+	float GetTimeOfDay() const { return TimeOfDay; }
+
+	// Moves the sunrise and sunset, used by USeasonSubsystem to follow the length of the days over the year
+	void SetDawnAndDuskTime(float NewDawnTime, float NewDuskTime);
+
+	float GetDawnTime() const { return DawnTime; }
+	float GetDuskTime() const { return DuskTime; }
+
+	// The sky turns to day and night at these times, see IsDaytime
+	float GetTrueDawnTime() const { return DawnTime - DawnTimeOffset; }
+	float GetTrueDuskTime() const { return DuskTime + DuskTimeOffset; }
+
+	UMaterialParameterCollection* GetWeatherParameterCollection() const { return WeatherMaterialParameterCollection; }
+
+	// Position of the weather transition between 0 and 1
+	float GetWeatherTransitionProgress() const;
+
+	// Stops the weather transition at a position, used to replay recorded weather
+	void SetWeatherTransitionProgress(float Progress);
+
+	ULightningComponent* GetLightning() const { return Lightning; }
+
+	// Value of the weather transition curve, which fades in the precipitation
+	float GetPrecipitationScale() const { return PrecipitationScale; }
+
+	// Applies the current time and weather to the components without waiting for the next frame
+	void RefreshEnvironment();
+
+	// Sets up the components and subsystems for the current time and weather and plays the weather transition, as on BeginPlay
+	void StartEnvironment();
+
+	// Applies a saved time and weather in one pass, with the weather transition already at TransitionProgress
+	void RestoreEnvironment(UWeatherDataAssetBase* Preset, float NewTimeOfDay, float TransitionProgress);
+
+	// Brightens the sky light and fog on top of the weather settings, 0 restores them
+	void SetLightningFlash(float FlashStrength) const;
+	
+	// Waits for the frame state started in Tick and applies it to the components, if it changed
+	void ApplyPendingFrameState();
 	
 	static constexpr float Midnight = 24.f;
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void RegisterActorTickFunctions(bool bRegister) override;
 	virtual void OnConstruction(const FTransform& Transform) override;
+	virtual void PreRegisterAllComponents() override;
 
 	TObjectPtr<USceneComponent> Root;
 
@@ -96,9 +197,19 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	TObjectPtr<UPostProcessComponent> PostProcessComponent;
 
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TObjectPtr<ULensRainComponent> LensRain;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TObjectPtr<ULightningComponent> Lightning;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TObjectPtr<UWeatherAmbienceComponent> Ambience;
+
 	// UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	// TObjectPtr<UNiagaraComponent> WeatherEffectsComponent;
 
+	// Weather effects of all views
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	TArray<TObjectPtr<UNiagaraComponent>> WeatherEffectsComponents;
 	
@@ -129,10 +240,18 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Basic Settings")
 	TObjectPtr<UMaterialParameterCollection> WeatherMaterialParameterCollection;
 
-	// Currently only affects how snow blends in onto the landscape
+	// Fades in the precipitation reported to gameplay, surface layers build up at the rates of the preset instead
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Basic Settings")
 	TObjectPtr<UCurveFloat> WeatherTransitionCurve;
 
+	// Spawn volume of the weather effects around the camera, cut off at VolumetricCloudLayerBottomAltitude
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Precipitation")
+	FPrecipitationVolumeSettings PrecipitationVolumeSettings;
+
+	// Blend in the presets of weather zones around the camera. CurrentWeatherPreset is used outside of all zones.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Weather Zones")
+	bool bBlendWeatherZones { true };
+
 
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Basic Settings|Moon", meta = (ClampMin=0))
@@ -160,6 +279,10 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Sky Sphere", meta = (ClampMin=0))
 	float SkySphereScale { 100000.f };
 
+	// Fog emission added per unit of lightning flash strength
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Lightning", meta = (ClampMin=0))
+	float LightningFogEmissive { .05f };
+
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Clouds")
 	ECloudTypes CurrentCloudMode; // TODO: Move some cloud settings to weather asset? Especially tint/brightness so we can controll that for darker weather types
@@ -193,6 +316,11 @@ protected:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Clouds|Volumetric", meta = (ClampMin=0, EditCondition="CurrentCloudMode == ECloudTypes::Volumetric"))
 	float VolumetricCloudPanningSpeed { .1f };
+
+	// Wind speed in m/s at which the clouds pan at their panning speed, they pan faster or slower with the wind of the
+	// weather. 0 keeps the panning speeds.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Clouds", meta = (ClampMin=0))
+	float CloudReferenceWindSpeed { 5.f };
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Dynamic Sky|Clouds|Volumetric", meta = (ClampMin=0, ClampMax=1, EditCondition="CurrentCloudMode == ECloudTypes::Volumetric"))
 	float DayVolumetricCloudBrightness { 1.f };
@@ -204,35 +332,100 @@ protected:
 	FLinearColor VolumetricCloudTint;
 	
 private:
+	friend class UEnvironmentSubsystem;
+
+	// A sky that stands by does not tick, render or play its weather
+	void SetIsActiveSky(bool bActive);
 
 	void InitSubsystems();
+
+	// False on dedicated servers and without a renderer, where only the time and weather state are updated
+	bool ShouldUpdateVisuals() const;
 	void InitSkySphere();
 	void HandleSunAndMoonRotation();
-	void HandleVisibility() const;
+	void ApplySunAndMoonRotation(FEnvironmentFrameState const& State) const;
+	void HandleVisibility(bool bIsDaytime) const;
 	void HandleCloudMode();
+	void HandleCloudMode(FEnvironmentFrameState const& State);
+	// Shows the clouds of the current mode without writing their parameters, the next ApplyFrameState writes them
+	void ToggleCloudMode();
+	ECloudTypes GetCloudMode() const;
 
 	void ToggleClouds2D(bool bShouldShow);
-	void SetCloud2DSettings();
+	void SetCloud2DSettings(FEnvironmentFrameState const& State) const;
 
 	void ToggleVolumetricClouds(bool bShouldShow);
-	void SetVolumetricCloudSettings();
+	void SetVolumetricCloudLayer();
+	void SetVolumetricCloudMaterialParameters(FEnvironmentFrameState const& State) const;
 
 	void HandleWeatherSettings();
+	void ApplyWeatherToSubsystems();
+	void BindWeatherTransitionCurve();
 	void SetWeatherEffects();
-	void SetWeatherLightProperties() const;
+	void SetWeatherLightProperties();
+	void ApplyWeatherLightProperties(FEnvironmentFrameState const& State) const;
+	FWeatherConfiguration GetWeatherConfiguration(bool bIsDaytime) const;
 	void SetWeatherLightProperties(FWeatherConfiguration const& Configuration, UDirectionalLightComponent* SunOrMoon) const;
-	
-	inline float GetTrueDawnTime() const;
-	inline float GetTrueDuskTime() const;
 
-	inline void ToggleWeatherEffects(bool bShowEffect) const;
-	inline void SetSnowStrength(float SnowStrength) const;
-	inline void SetRainStrength(float RainStrength) const;
+	// Copies the current settings of the sky so the frame state can be computed without touching the actor
+	FEnvironmentFrameInputs MakeFrameInputs() const;
+	FEnvironmentFrameState ComputeFrameState() const { return FEnvironmentFrameState::Compute(MakeFrameInputs()); }
+	void LaunchFrameStateTask();
 	
-	inline void TogglePuddleMaterialEffects(bool bShowPuddles, bool bShowRipples) const;
+	inline void ToggleWeatherEffects(bool bShowEffect) const;
 
+	void UpdateWeatherZoneBlend();
+
+	// Samples the weather zones at the camera, returns false when nothing changed
+	bool SampleWeatherZones();
+	void HandleActivePresetChanged();
+	void ApplyFrameState(FEnvironmentFrameState const& State);
+	void UpdatePrecipitationOcclusion();
+	void UpdateAccumulationView();
+	void UpdateWeatherEffectDensity();
+	void UpdateWind() const;
+	void UpdatePrecipitationVolume(float DeltaTime);
+	void UpdatePrecipitationVolume(FDynamicSkyWeatherView& View, FVector const& ViewLocation, float DeltaTime) const;
+
+	// Location of the primary view, the shared simulation follows it
+	FVector GetViewLocation() const;
+
+	// Locations of the views the weather effects are presented to, the sky itself without any view
+	void GetWeatherViewLocations(TArray<FVector, TInlineAllocator<4>>& OutLocations) const;
+
+	// Panning speed multiplier of the clouds for the base wind of the world
+	float GetCloudWindScale() const;
+
+	// Dominant weather zone preset at the camera, null outside of all zones
+	UPROPERTY()
+	TObjectPtr<UWeatherDataAssetBase> ZoneWeatherPreset;
+
+	FWeatherZoneSample ViewZoneSample;
+
+	// Version of the occlusion grid last bound to the weather effects
+	uint32 AppliedOcclusionGridVersion { 0 };
+
+	// Version of the effect density last applied to the weather effects
+	uint32 AppliedEffectDensityVersion { 0 };
+
+	// The components of WeatherEffectsComponents split by view, the effect density is shared among the views
+	UPROPERTY(Transient)
+	TArray<FDynamicSkyWeatherView> WeatherViews;
+
+	// Runs after the actor tick, by which time the frame state task has had physics to finish in
+	UPROPERTY()
+	FDynamicSkyApplyFrameStateTickFunction ApplyFrameStateTick;
+
+	UE::Tasks::TTask<FEnvironmentFrameState> FrameStateTask;
+
+	// Last state applied by ApplyPendingFrameState, reset whenever the components are updated directly
+	FEnvironmentFrameState AppliedFrameState;
+	bool bHasAppliedFrameState { false };
 	
+	UPROPERTY(Transient)
 	TObjectPtr<UMaterialInstanceDynamic> SkySphereMaterialInstance;
+
+	UPROPERTY(Transient)
 	TObjectPtr<UMaterialInstanceDynamic> VolumetricCloudMaterialInstance;
 
 	FName StarsVisibleMaterialParameterName { "AreStarsVisible" };
@@ -245,10 +438,17 @@ private:
 	FName VolumetricCloudSettingsMaterialParameterName { "PanningSpeed" };
 	FName VolumetricCloudAlbedoMaterialParameterName { "CloudAlbedo" };
 
-	// Parameter name for weather material collection
-	FName SnowStrengthParameterName { "SnowStrength" };  
-	FName ShowPuddlesCollectionParameterName { "ShowPuddles" }; // TODO: Change this to PuddleStrength, RainStrength or similar?
-	FName ShowRipplesCollectionParameterName { "ShowRipples" };
+	FName SpawnVolumeOriginParameterName { "SpawnVolumeOrigin" };
+	FName SpawnVolumeOffsetParameterName { "SpawnVolumeOffset" };
+	FName SpawnVolumeExtentParameterName { "SpawnVolumeExtent" };
+	FName SpawnVolumeYawParameterName { "SpawnVolumeYaw" };
+
+	// Accumulation channel set by SetIsSNowing
+	FName SnowChannelName { "Snow" };
+
+	bool bIsActiveSky { true };
+	bool bWasHiddenBeforeStandby { false };
+	float PrecipitationScale { 0.f };
 	
 
 	FOnTimelineFloat WeatherAnimationUpdateCallback;
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WeatherDataAssetBase.h"
+
+/**
+ * Everything the derived environment values of a frame depend on, copied out of the sky on the game thread.
+ * Weather presets are data assets that are not modified during play, so they can be read from a worker thread.
+ */
+struct ENVIRONMENTSYSTEM_API FEnvironmentFrameInputs
+{
+	float TimeOfDay { 9.f };
+	float DawnTime { 5.f };
+	float DawnTimeOffset { .2f };
+	float DuskTime { 19.f };
+	float DuskTimeOffset { .2f };
+	float SunMoonRotationYaw { 0.f };
+
+	// The preset that drives the sky, null when there is no weather
+	UWeatherDataAssetBase const* ActivePreset { nullptr };
+
+	// At the border of a weather zone the light blends from one preset to the other
+	UWeatherDataAssetBase const* BlendFromPreset { nullptr };
+	UWeatherDataAssetBase const* BlendToPreset { nullptr };
+	float BlendWeight { 0.f };
+
+	float Cloud2DTiling { 3.f };
+	float Cloud2DPanningSpeed { 1.f };
+	float Cloud2DBrightness { 1.f };
+	float DaytimeAtmosphereCloudTint { .1f };
+	float NighttimeAtmosphereCloudTint { .95f };
+
+	float VolumetricCloudPanningSpeed { .1f };
+	float DayVolumetricCloudBrightness { 1.f };
+	float NightVolumetricCloudBrightness { .2f };
+	FLinearColor VolumetricCloudTint { FLinearColor::White };
+};
+
+/**
+ * Derived environment values for one frame. Computing it does not touch any object, so it runs on a worker thread
+ * and the sky only copies the result into its components.
+ */
+struct ENVIRONMENTSYSTEM_API FEnvironmentFrameState
+{
+	bool bIsDaytime { true };
+
+	FRotator SunRotation { ForceInit };
+
+	// The moon only moves between dusk and dawn
+	bool bUpdateMoonRotation { false };
+	FRotator MoonRotation { ForceInit };
+
+	// False when there is no active preset, the lights are left alone in that case
+	bool bHasWeather { false };
+	FWeatherConfiguration WeatherConfiguration;
+	bool bStarsVisible { false };
+	bool bMoonVisible { false };
+
+	// Tiling, panning speed, brightness and atmosphere tint of the 2D clouds
+	FLinearColor Cloud2DSettings { ForceInit };
+
+	// Tint of the volumetric clouds, with the brightness in alpha
+	FLinearColor VolumetricCloudAlbedo { ForceInit };
+	float VolumetricCloudPanningSpeed { 0.f };
+
+	bool operator==(FEnvironmentFrameState const& Other) const = default;
+
+	static FEnvironmentFrameState Compute(FEnvironmentFrameInputs const& Inputs);
+
+	// Light and atmosphere settings of the active preset, blended at the border of a weather zone
+	static FWeatherConfiguration GetWeatherConfiguration(FEnvironmentFrameInputs const& Inputs, bool bIsDaytime);
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentRecording.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnvironmentRecorderSubsystem.generated.h"
+
+class ADynamicSkySystem;
+class UWeatherDataAssetBase;
+
+/**
+ * Records the time, weather, weather transition, accumulation and lightning of a session, and plays recordings back
+ * through the sky and the world time. While playing back, the world time does not advance on its own and the lightning
+ * of the weather is replaced by the recorded strikes.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UEnvironmentRecorderSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Stops any playback and starts a new recording with the active sky of the world
+	bool StartRecording();
+
+	// Returns the finished recording, null when nothing was recorded
+	TSharedPtr<FEnvironmentRecording> StopRecording();
+
+	bool IsRecording() const { return Writer.IsValid(); }
+
+	bool StartPlayback(TSharedRef<FEnvironmentRecording const> NewRecording);
+	void StopPlayback();
+
+	// Jumps to a time in seconds from the start of the playback
+	void Seek(float Time);
+
+	bool IsPlayingBack() const { return Reader.IsValid(); }
+	float GetPlaybackTime() const { return PlaybackTime; }
+
+	// Recordings are written to and read from Saved/EnvironmentRecordings
+	static FString GetRecordingPath(FString const& Name);
+
+private:
+	ADynamicSkySystem* FindSky() const;
+
+	void RecordSample();
+	void HandleLightningStrike(FVector Location, float Distance);
+
+	void ApplySample(FEnvironmentRecordingSample const& Sample, bool bTriggerLightning);
+	void ApplyTimeOfDay(float Alpha);
+
+	TWeakObjectPtr<ADynamicSkySystem> Sky;
+
+	// Recording
+	TSharedPtr<FEnvironmentRecording> Recording;
+	TUniquePtr<FEnvironmentRecordingWriter> Writer;
+	TArray<FVector> PendingStrikes;
+	FDelegateHandle StrikeHandle;
+	float TimeSinceSample { 0.f };
+
+	// Playback
+	TSharedPtr<FEnvironmentRecording const> PlaybackRecording;
+	TUniquePtr<FEnvironmentRecordingReader> Reader;
+	FEnvironmentRecordingSample CurrentSample;
+	FEnvironmentRecordingSample NextSample;
+	int32 CurrentSampleIndex { 0 };
+	bool bHasNextSample { false };
+	float PlaybackTime { 0.f };
+	FTimespan SavedTickRate;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UWeatherDataAssetBase>> PlaybackPresets;
+};
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/DateTime.h"
+#include "UObject/SoftObjectPath.h"
+
+// Environment state at one sample of a recording, as reproduced on playback
+struct ENVIRONMENTSYSTEM_API FEnvironmentRecordingSample
+{
+	float TimeOfDay { 0.f };
+	FDateTime WorldDateTime { 0 };
+
+	// Index into the presets of the recording, INDEX_NONE without weather
+	int32 PresetIndex { INDEX_NONE };
+
+	// Position of the weather transition between 0 and 1
+	float TransitionProgress { 0.f };
+
+	// Level of every channel of the recording at the camera
+	TArray<float> AccumulationValues;
+
+	// Strikes since the previous sample
+	TArray<FVector> LightningStrikes;
+};
+
+// A sample as it is stored. Every value is quantized, so the writer and the reader see exactly the same state.
+struct FEnvironmentRecordingState
+{
+	uint16 TimeOfDay { 0 };
+	int64 WorldSeconds { 0 };
+	int32 PresetIndex { INDEX_NONE };
+	uint8 TransitionProgress { 0 };
+	TArray<uint8> AccumulationValues;
+};
+
+/**
+ * Stream of environment samples taken at a fixed interval. Every sample only stores the values that changed since the
+ * previous one, as variable length deltas, which comes down to a few bytes per second while the weather is steady.
+ * Every SamplesPerKeyframe samples a keyframe stores all values, so seeking decodes at most one keyframe interval.
+ */
+class ENVIRONMENTSYSTEM_API FEnvironmentRecording
+{
+public:
+	static constexpr uint32 Version = 1;
+
+	// Only the first 64 channels are recorded
+	static constexpr int32 MaxChannels = 64;
+
+	float SampleInterval { .5f };
+	int32 SamplesPerKeyframe { 20 };
+
+	TArray<FSoftObjectPath> Presets;
+	TArray<FName> Channels;
+
+	int32 GetNumSamples() const { return NumSamples; }
+	float GetDuration() const { return NumSamples * SampleInterval; }
+	int32 GetNumBytes() const { return Data.Num(); }
+
+	friend ENVIRONMENTSYSTEM_API FArchive& operator<<(FArchive& Ar, FEnvironmentRecording& Recording);
+
+private:
+	friend class FEnvironmentRecordingWriter;
+	friend class FEnvironmentRecordingReader;
+
+	int32 NumSamples { 0 };
+	TArray<uint8> Data;
+
+	// Byte offset of every keyframe in Data
+	TArray<int32> KeyframeOffsets;
+};
+
+// Appends samples to a recording
+class ENVIRONMENTSYSTEM_API FEnvironmentRecordingWriter
+{
+public:
+	explicit FEnvironmentRecordingWriter(FEnvironmentRecording& InRecording);
+
+	void AddSample(FEnvironmentRecordingSample const& Sample);
+
+private:
+	FEnvironmentRecording& Recording;
+	FEnvironmentRecordingState Previous;
+};
+
+// Decodes the samples of a recording in order, starting anywhere
+class ENVIRONMENTSYSTEM_API FEnvironmentRecordingReader
+{
+public:
+	explicit FEnvironmentRecordingReader(FEnvironmentRecording const& InRecording);
+
+	// The next sample read is SampleIndex. Lightning strikes of the skipped samples are dropped.
+	bool Seek(int32 SampleIndex);
+
+	// False at the end of the recording or if the data is corrupt
+	bool ReadSample(FEnvironmentRecordingSample& OutSample);
+
+	int32 GetNextSampleIndex() const { return NextSample; }
+
+private:
+	FEnvironmentRecording const& Recording;
+	FEnvironmentRecordingState Current;
+	int32 Offset { 0 };
+	int32 NextSample { 0 };
+};
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WeatherTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnvironmentSubsystem.generated.h"
+
+class ADynamicSkySystem;
+class UWeatherDataAssetBase;
+class UWorldTimeSubsystem;
+
+// Time and weather of the active sky, gathered at most once per frame
+USTRUCT(BlueprintType)
+struct ENVIRONMENTSYSTEM_API FEnvironmentWeatherState
+{
+	GENERATED_BODY()
+
+	// Preset at the camera, which is the dominant weather zone or the global weather
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	TObjectPtr<UWeatherDataAssetBase> ActivePreset;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	TObjectPtr<UWeatherDataAssetBase> GlobalPreset;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	EPrecipitationType PrecipitationType { EPrecipitationType::None };
+
+	// Intensity of the active preset, faded in with the weather transition
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	float PrecipitationIntensity { 0.f };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	float TransitionProgress { 0.f };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	float TimeOfDay { 0.f };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	bool bIsDaytime { true };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	FDateTime WorldDateTime { 0 };
+
+	// False without an active sky, every other value is then the default
+	UPROPERTY(BlueprintReadOnly, Category = "Environment")
+	bool bHasSky { false };
+};
+
+// Time, weather and surface layers of a world, for save games. Every property is marked SaveGame.
+USTRUCT(BlueprintType)
+struct ENVIRONMENTSYSTEM_API FEnvironmentSnapshot
+{
+	GENERATED_BODY()
+
+	UPROPERTY(SaveGame, BlueprintReadOnly, Category = "Environment")
+	FDateTime WorldDateTime { 0 };
+
+	UPROPERTY(SaveGame, BlueprintReadOnly, Category = "Environment")
+	float TimeOfDay { 0.f };
+
+	// Global weather, weather zones are resolved again on restore
+	UPROPERTY(SaveGame, BlueprintReadOnly, Category = "Environment")
+	TSoftObjectPtr<UWeatherDataAssetBase> Preset;
+
+	UPROPERTY(SaveGame, BlueprintReadOnly, Category = "Environment")
+	float TransitionProgress { 0.f };
+
+	UPROPERTY(SaveGame)
+	int32 AccumulationResolution { 0 };
+
+	UPROPERTY(SaveGame)
+	TArray<FName> AccumulationChannels;
+
+	// One byte per channel and tile, the tiles of a channel are contiguous
+	UPROPERTY(SaveGame)
+	TArray<uint8> AccumulationValues;
+};
+
+/**
+ * Registry of the sky that drives the environment of the world. Skies register themselves on BeginPlay. Only one of them
+ * is active, a sky in the persistent level takes over from skies in streamed levels, otherwise the first one stays active.
+ * The others stand by without ticking or rendering until the active sky leaves the world.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UEnvironmentSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+	// Returns true when the sky is the active sky afterwards
+	bool RegisterSky(ADynamicSkySystem* Sky);
+	void UnregisterSky(ADynamicSkySystem* Sky);
+
+	UFUNCTION(BlueprintPure, Category = "Environment")
+	ADynamicSkySystem* GetSky() const { return ActiveSky.Get(); }
+
+	UFUNCTION(BlueprintPure, Category = "Environment")
+	UWorldTimeSubsystem* GetWorldTime() const { return WorldTime; }
+
+	FEnvironmentWeatherState const& GetWeatherState() const;
+
+	UFUNCTION(BlueprintPure, Category = "Environment", meta = (DisplayName = "Get Weather State"))
+	FEnvironmentWeatherState K2_GetWeatherState() const { return GetWeatherState(); }
+
+	UFUNCTION(BlueprintCallable, Category = "Environment")
+	FEnvironmentSnapshot CaptureSnapshot() const;
+
+	// Applies the final state of a snapshot in one pass, without playing the weather transition. Without an active sky
+	// the snapshot is kept until a sky begins play, where it replaces the initial setup.
+	UFUNCTION(BlueprintCallable, Category = "Environment")
+	void RestoreSnapshot(FEnvironmentSnapshot const& Snapshot);
+
+	// Called by the sky on BeginPlay, returns true when a pending snapshot was restored
+	bool RestorePendingSnapshot();
+
+private:
+	void UpdateActiveSky();
+	void ApplySnapshot(ADynamicSkySystem* Sky, FEnvironmentSnapshot const& Snapshot);
+
+	// In order of registration
+	TArray<TWeakObjectPtr<ADynamicSkySystem>> Skies;
+	TWeakObjectPtr<ADynamicSkySystem> ActiveSky;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UWorldTimeSubsystem> WorldTime;
+
+	TOptional<FEnvironmentSnapshot> PendingSnapshot;
+
+	mutable FEnvironmentWeatherState WeatherState;
+	mutable uint64 WeatherStateFrame { MAX_uint64 };
+};
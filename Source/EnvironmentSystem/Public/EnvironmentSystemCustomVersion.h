@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Version of the assets of the environment system, for data fixes on load
+struct ENVIRONMENTSYSTEM_API FEnvironmentSystemCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+
+		// Weather presets describe their surface effects through accumulation channels
+		AccumulationChannels,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+};
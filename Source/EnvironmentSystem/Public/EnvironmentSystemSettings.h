@@ -3,6 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SeasonCalendar.h"
+#include "WeatherDataAssetBase.h"
 #include "Engine/DeveloperSettings.h"
 #include "EnvironmentSystemSettings.generated.h"
 
@@ -27,4 +29,98 @@ public:
 	// How many seconds should pass between each tick of date time updates
 	UPROPERTY(EditAnywhere, Config, Category=Environment, meta = (ClampMin=0, UIMin=0))
 	float RealWorldTickFrequency { 1.f };
+
+	// Size of the grid cells used to look up weather zones. Smaller cells mean fewer zones to test per query but more memory.
+	UPROPERTY(EditAnywhere, Config, Category="Weather Zones", meta = (ClampMin=100, UIMin=100))
+	float WeatherZoneGridCellSize { 5000.f };
+
+	// Trace static geometry around the camera so that precipitation does not fall through roofs
+	UPROPERTY(EditAnywhere, Config, Category="Precipitation Occlusion")
+	bool bEnablePrecipitationOcclusion { true };
+
+	// Number of cells per side of the occlusion grid around the camera
+	UPROPERTY(EditAnywhere, Config, Category="Precipitation Occlusion", meta = (ClampMin=8, ClampMax=256, EditCondition="bEnablePrecipitationOcclusion"))
+	int32 OcclusionGridResolution { 64 };
+
+	UPROPERTY(EditAnywhere, Config, Category="Precipitation Occlusion", meta = (ClampMin=10, EditCondition="bEnablePrecipitationOcclusion"))
+	float OcclusionCellSize { 200.f };
+
+	// World height the occlusion traces start from, above the highest roof. The cells do not depend on the camera
+	// height, so they stay valid when it moves up or down.
+	UPROPERTY(EditAnywhere, Config, Category="Precipitation Occlusion", meta = (EditCondition="bEnablePrecipitationOcclusion"))
+	float OcclusionTraceCeiling { 10000.f };
+
+	// How far below the ceiling to look for occluders
+	UPROPERTY(EditAnywhere, Config, Category="Precipitation Occlusion", meta = (ClampMin=100, EditCondition="bEnablePrecipitationOcclusion"))
+	float OcclusionTraceRange { 20000.f };
+
+	// Maximum number of traces per frame used to fill in cells when the camera moves
+	UPROPERTY(EditAnywhere, Config, Category="Precipitation Occlusion", meta = (ClampMin=1, EditCondition="bEnablePrecipitationOcclusion"))
+	int32 OcclusionTracesPerFrame { 128 };
+
+	// A point counts as sheltered when it is at least this far below the occluder, so the ground does not shelter itself
+	UPROPERTY(EditAnywhere, Config, Category="Precipitation Occlusion", meta = (ClampMin=0, EditCondition="bEnablePrecipitationOcclusion"))
+	float OcclusionShelterBias { 50.f };
+
+	// Number of tiles per side of the accumulation grid, which is centered on the origin of the world
+	UPROPERTY(EditAnywhere, Config, Category="Accumulation", meta = (ClampMin=1, ClampMax=256))
+	int32 AccumulationGridResolution { 32 };
+
+	// Each tile has its own weather and surface layers, sampled from the weather zones at its center
+	UPROPERTY(EditAnywhere, Config, Category="Accumulation", meta = (ClampMin=100))
+	float AccumulationTileSize { 10000.f };
+
+	// Surface layers that weather presets can build up. Four channels share one vector of the weather parameter collection,
+	// the first four are written to Accumulation0, the next four to Accumulation1 and so on.
+	UPROPERTY(EditAnywhere, Config, Category="Accumulation")
+	TArray<FWeatherAccumulationChannel> AccumulationChannels;
+
+	UPROPERTY(EditAnywhere, Config, Category="Accumulation")
+	FString AccumulationParameterPrefix { "Accumulation" };
+
+	// Also write channels to their legacy scalar parameters, such as SnowStrength. Turn off once no material reads them.
+	UPROPERTY(EditAnywhere, Config, Category="Accumulation")
+	bool bWriteLegacyAccumulationParameters { true };
+
+	// Float parameters of every weather effect that scale with the effect density, on top of the ones listed per effect
+	UPROPERTY(EditAnywhere, Config, Category="Weather Effect Density")
+	TArray<FName> DensityParameterNames;
+
+	// Density of the weather effects at each effects quality level, from Low to Cinematic
+	UPROPERTY(EditAnywhere, Config, Category="Weather Effect Density", meta = (ClampMin=0, ClampMax=1))
+	TArray<float> EffectsQualityDensities;
+
+	// Drive the dawn, dusk, temperature and weather from the seasons. Off by default, so the sky keeps its own dawn and
+	// dusk until a project opts in.
+	UPROPERTY(EditAnywhere, Config, Category="Seasons")
+	bool bEnableSeasons { false };
+
+	// Seasons of the world year. Day length, temperatures, weather chances and material parameters blend from season to
+	// season and are precomputed for every day of the year. Without seasons the sky keeps its own dawn and dusk.
+	UPROPERTY(EditAnywhere, Config, Category="Seasons", meta = (EditCondition="bEnableSeasons"))
+	TArray<FSeasonDefinition> Seasons;
+
+	// Draw the weather of each new day from the weather chances of the season
+	UPROPERTY(EditAnywhere, Config, Category="Seasons", meta = (EditCondition="bEnableSeasons"))
+	bool bPickDailyWeather { false };
+
+	// How fast the wind turns and builds up towards the wind of a new weather, as the share of the difference per second
+	UPROPERTY(EditAnywhere, Config, Category="Wind", meta = (ClampMin=0.01))
+	float WindBlendSpeed { .5f };
+
+	// Weather cover components closer than this to a view are updated every frame
+	UPROPERTY(EditAnywhere, Config, Category="Weather Cover", meta = (ClampMin=0))
+	float WeatherCoverNearDistance { 2000.f };
+
+	// From this distance to the nearest view weather cover components are updated every WeatherCoverFarInterval
+	UPROPERTY(EditAnywhere, Config, Category="Weather Cover", meta = (ClampMin=0))
+	float WeatherCoverFarDistance { 15000.f };
+
+	// Seconds between updates of distant weather cover components, the interval grows with the distance up to it
+	UPROPERTY(EditAnywhere, Config, Category="Weather Cover", meta = (ClampMin=0))
+	float WeatherCoverFarInterval { 1.f };
+
+	// Most weather cover components updated in one frame, the others wait for the next frames
+	UPROPERTY(EditAnywhere, Config, Category="Weather Cover", meta = (ClampMin=1))
+	int32 WeatherCoverMaxUpdatesPerFrame { 256 };
 };
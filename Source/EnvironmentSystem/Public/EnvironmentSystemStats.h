@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Stats/Stats.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Trace/Trace.h"
+
+// stat EnvironmentSystem
+DECLARE_STATS_GROUP(TEXT("EnvironmentSystem"), STATGROUP_EnvironmentSystem, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Init Subsystems"), STAT_EnvironmentSystem_InitSubsystems, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Set Weather Effects"), STAT_EnvironmentSystem_SetWeatherEffects, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Set Weather Light Properties"), STAT_EnvironmentSystem_SetWeatherLightProperties, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Handle Sun And Moon Rotation"), STAT_EnvironmentSystem_HandleSunAndMoonRotation, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Compute Frame State"), STAT_EnvironmentSystem_ComputeFrameState, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Frame State"), STAT_EnvironmentSystem_ApplyFrameState, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("World Time Tick"), STAT_EnvironmentSystem_WorldTimeTick, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Foot Effects Notify"), STAT_EnvironmentSystem_FootEffectsNotify, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Weather Accumulation"), STAT_EnvironmentSystem_WeatherAccumulation, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Restore Environment"), STAT_EnvironmentSystem_RestoreEnvironment, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Season Calendar"), STAT_EnvironmentSystem_BuildSeasonCalendar, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Weather Cover"), STAT_EnvironmentSystem_WeatherCover, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Footsteps"), STAT_EnvironmentSystem_Footsteps, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces"), STAT_EnvironmentSystem_Traces, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Niagara Spawns"), STAT_EnvironmentSystem_NiagaraSpawns, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("MPC Writes"), STAT_EnvironmentSystem_MPCWrites, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Primitive Data Writes"), STAT_EnvironmentSystem_PrimitiveDataWrites, STATGROUP_EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+
+// stat LLM and memreport, every tag is a child of EnvironmentSystem
+LLM_DECLARE_TAG_API(EnvironmentSystem, ENVIRONMENTSYSTEM_API);
+LLM_DECLARE_TAG_API(EnvironmentSystem_Sky, ENVIRONMENTSYSTEM_API);
+LLM_DECLARE_TAG_API(EnvironmentSystem_Clouds, ENVIRONMENTSYSTEM_API);
+LLM_DECLARE_TAG_API(EnvironmentSystem_WeatherEffects, ENVIRONMENTSYSTEM_API);
+LLM_DECLARE_TAG_API(EnvironmentSystem_Footprints, ENVIRONMENTSYSTEM_API);
+LLM_DECLARE_TAG_API(EnvironmentSystem_Time, ENVIRONMENTSYSTEM_API);
+LLM_DECLARE_TAG_API(EnvironmentSystem_Presets, ENVIRONMENTSYSTEM_API);
+
+// -csvCategories=EnvironmentSystem
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(ENVIRONMENTSYSTEM_API, EnvironmentSystem);
+
+// -trace=default,EnvironmentSystem
+UE_TRACE_CHANNEL_EXTERN(EnvironmentSystemChannel, ENVIRONMENTSYSTEM_API);
+
+// Times a scope in the stat group, the CSV profiler and Insights at once. Name is the suffix of a STAT_EnvironmentSystem_ stat.
+#define ENVIRONMENT_SCOPE_CYCLE_COUNTER(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_EnvironmentSystem_##Name); \
+	CSV_SCOPED_TIMING_STAT(EnvironmentSystem, Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("EnvironmentSystem::" #Name, EnvironmentSystemChannel)
+
+// Adds to a per frame counter in the stat group and the CSV profiler
+#define ENVIRONMENT_INC_COUNTER(Name, Amount) \
+	do \
+	{ \
+		INC_DWORD_STAT_BY(STAT_EnvironmentSystem_##Name, Amount); \
+		CSV_CUSTOM_STAT(EnvironmentSystem, Name, static_cast<int32>(Amount), ECsvCustomStatOp::Accumulate); \
+	} while(false)
+
+// Marks a weather or time event on the Insights timeline and in the CSV profile
+#define ENVIRONMENT_TRACE_EVENT(Format, ...) \
+	do \
+	{ \
+		if(UE_TRACE_CHANNELEXPR_IS_ENABLED(EnvironmentSystemChannel)) \
+		{ \
+			TRACE_BOOKMARK(Format, ##__VA_ARGS__); \
+		} \
+		CSV_EVENT(EnvironmentSystem, Format, ##__VA_ARGS__); \
+	} while(false)
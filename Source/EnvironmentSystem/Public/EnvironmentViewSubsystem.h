@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnvironmentViewSubsystem.generated.h"
+
+class APlayerController;
+
+// A camera the weather is presented to
+struct FEnvironmentView
+{
+	// Local player the view belongs to, null for spectator views
+	TWeakObjectPtr<APlayerController> PlayerController;
+
+	FVector Location { ForceInit };
+	FRotator Rotation { ForceInit };
+};
+
+/**
+ * Cameras of a world the weather is presented to: the local players, as in split screen, followed by the registered
+ * spectator views. Time, weather and transitions are simulated once for all of them, only the precipitation volume,
+ * lens rain and ambience listener are per view. The first view is the primary view the shared simulation follows.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UEnvironmentViewSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// Gathered once per frame, at most es.Weather.MaxViews
+	TConstArrayView<FEnvironmentView> GetViews() const;
+
+	// Number of views sharing the weather effects budget, at least 1
+	UFUNCTION(BlueprintPure, Category = "Environment|Views")
+	int32 GetNumViews() const { return FMath::Max(GetViews().Num(), 1); }
+
+	// Location of the primary view, or Fallback without any view
+	FVector GetPrimaryViewLocation(FVector const& Fallback) const;
+
+	// Presents the weather to the view point of an actor, such as a spectator camera, in addition to the local players
+	UFUNCTION(BlueprintCallable, Category = "Environment|Views")
+	void AddSpectatorView(AActor* ViewActor);
+
+	UFUNCTION(BlueprintCallable, Category = "Environment|Views")
+	void RemoveSpectatorView(AActor* ViewActor);
+
+private:
+	void GatherViews() const;
+
+	TArray<TWeakObjectPtr<AActor>> SpectatorViews;
+
+	mutable TArray<FEnvironmentView> Views;
+	mutable uint64 GatheredFrame { MAX_uint64 };
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Camera/CameraModifier.h"
+#include "LensRainCameraModifier.generated.h"
+
+/**
+ * Blends the lens rain material into the post process of one player camera, so every split screen view gets the
+ * drops of its own camera. Nothing is added while the drops are invisible, so dry cameras cost no full screen pass.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API ULensRainCameraModifier : public UCameraModifier
+{
+	GENERATED_BODY()
+
+public:
+	void SetLensRain(UMaterialInterface* Material, FName AmountParameterName, float InWeight);
+
+	float GetWeight() const { return Weight; }
+
+protected:
+	virtual void ModifyPostProcess(float DeltaTime, float& PostProcessBlendWeight, FPostProcessSettings& PostProcessSettings) override;
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<UMaterialInstanceDynamic> MaterialInstance;
+
+	float Weight { 0.f };
+};
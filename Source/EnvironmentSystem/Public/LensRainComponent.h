@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LensRainComponent.generated.h"
+
+class APlayerCameraManager;
+class APlayerController;
+class ULensRainCameraModifier;
+
+// Lens rain of one local player
+USTRUCT()
+struct FLensRainView
+{
+	GENERATED_BODY()
+
+	TWeakObjectPtr<APlayerController> PlayerController;
+
+	// Owned by the camera manager of the player
+	UPROPERTY(Transient)
+	TObjectPtr<ULensRainCameraModifier> Modifier;
+
+	float Weight { 0.f };
+};
+
+/**
+ * Drives the rain drops on lens post process material from the rain at the camera, the camera pitch and shelter.
+ * Every local player gets the drops of its own camera through a camera modifier, so split screen views do not share them.
+ * The material is only part of the post process settings while drops are visible, so dry weather costs no full screen pass.
+ */
+UCLASS(ClassGroup = (Environment), meta = (BlueprintSpawnableComponent))
+class ENVIRONMENTSYSTEM_API ULensRainComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULensRainComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Weight of the drops on the camera of a local player
+	UFUNCTION(BlueprintPure, Category = "Lens Rain")
+	float GetLensRainWeight(APlayerController const* PlayerController) const;
+
+	// Dries all cameras at once and lets go of them
+	void ClearViews();
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Usually PPMI_RainDrops_OnLens
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lens Rain")
+	TObjectPtr<UMaterialInterface> LensRainMaterial;
+
+	// Weight gained per second while it rains on the camera
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lens Rain", meta = (ClampMin=0))
+	float FadeInSpeed { .5f };
+
+	// Weight lost per second once the camera is dry or sheltered, drops linger for a while
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lens Rain", meta = (ClampMin=0))
+	float FadeOutSpeed { .15f };
+
+	// Fraction of the drops that land when looking straight ahead, looking up gives the full amount
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lens Rain", meta = (ClampMin=0, ClampMax=1))
+	float LevelViewFactor { .35f };
+
+	// Fraction of the drops that land when looking straight down
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lens Rain", meta = (ClampMin=0, ClampMax=1))
+	float DownViewFactor { 0.f };
+
+	// Scalar parameter on the material receiving the current weight
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lens Rain")
+	FName LensRainAmountParameterName { "RainAmount" };
+
+private:
+	float GetTargetWeight(APlayerCameraManager const* CameraManager) const;
+	void AddView(APlayerController* PlayerController);
+
+	UPROPERTY(Transient)
+	TArray<FLensRainView> Views;
+};
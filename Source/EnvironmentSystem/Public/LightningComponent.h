@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LightningComponent.generated.h"
+
+class UAudioComponent;
+class UNiagaraComponent;
+class UNiagaraSystem;
+class USoundBase;
+struct FLightningSettings;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnLightningStrikeDelegate, FVector /* Location */, float /* Distance */);
+
+/**
+ * Schedules lightning strikes around the listener at the rate of the active weather preset, and plays thunder
+ * delayed by the distance to the strike. Effects and sounds come from fixed pools created on begin play,
+ * so a storm never creates components. When every thunder voice is busy new thunder is dropped.
+ */
+UCLASS(ClassGroup = (Environment), meta = (BlueprintSpawnableComponent))
+class ENVIRONMENTSYSTEM_API ULightningComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULightningComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Restarts the strike sequence, the same seed and weather give the same strikes
+	void SetSeed(int32 NewSeed);
+
+	// Strikes at a location right away, regardless of the weather
+	void TriggerStrike(FVector const& Location);
+
+	// Turns off the strikes of the weather, for example while a recording drives them through TriggerStrike
+	void SetAutomaticStrikes(bool bEnabled);
+
+	FOnLightningStrikeDelegate OnLightningStrike;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Usually NS_Lightning
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lightning")
+	TObjectPtr<UNiagaraSystem> LightningEffect;
+
+	// Usually MS_Thunder_Far
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lightning")
+	TObjectPtr<USoundBase> ThunderSound;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lightning", meta = (ClampMin=1, ClampMax=16))
+	int32 EffectPoolSize { 3 };
+
+	// Also the maximum number of thunder sounds playing at once
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lightning", meta = (ClampMin=1, ClampMax=16))
+	int32 ThunderPoolSize { 3 };
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lightning")
+	int32 Seed { 0 };
+
+	// In cm/s, determines how long thunder takes to arrive
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lightning", meta = (ClampMin=1))
+	float SpeedOfSound { 34300.f };
+
+	// Thunder volume at the furthest strike distance, closer strikes are louder
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Lightning", meta = (ClampMin=0, ClampMax=1))
+	float FarThunderVolume { .4f };
+
+private:
+	struct FPendingThunder
+	{
+		double PlayTime;
+		FVector Location;
+		float Volume;
+	};
+
+	FLightningSettings const* GetLightningSettings() const;
+	bool GetListenerLocation(FVector& OutLocation) const;
+	void ScheduleNextStrike(float StrikesPerMinute);
+	void Strike(FLightningSettings const& Settings);
+	void UpdateFlash(float DeltaTime);
+	void UpdateThunder();
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UNiagaraComponent>> EffectPool;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UAudioComponent>> ThunderPool;
+
+	// Fixed capacity, strikes beyond it are not heard
+	TArray<FPendingThunder> PendingThunder;
+
+	FRandomStream RandomStream;
+	int32 NextEffectIndex { 0 };
+	float TimeUntilNextStrike { -1.f };
+	bool bAutomaticStrikes { true };
+
+	float FlashTimeRemaining { 0.f };
+	float FlashDuration { 0.f };
+	float FlashStrength { 0.f };
+};
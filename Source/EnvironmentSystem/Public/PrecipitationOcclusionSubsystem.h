@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PrecipitationOcclusionSubsystem.generated.h"
+
+class UNiagaraComponent;
+class UTexture2D;
+
+/**
+ * Top down height of the highest static geometry in a square window of cells around the camera.
+ * A snapshot is never modified after it is published, which makes it safe to query from any thread.
+ */
+class ENVIRONMENTSYSTEM_API FPrecipitationOcclusionGrid
+{
+public:
+	FPrecipitationOcclusionGrid() = default;
+	FPrecipitationOcclusionGrid(FIntPoint InMinCell, int32 InResolution, float InCellSize, float InShelterBias, TArray<float>&& InHeights);
+
+	bool IsEmpty() const { return Heights.IsEmpty(); }
+
+	// Height of the highest occluder above the position, or the lowest float if unknown
+	float GetOccluderHeight(FVector const& Position) const;
+
+	// True when a static occluder blocks precipitation from reaching the position
+	bool IsSheltered(FVector const& Position) const { return Position.Z < GetOccluderHeight(Position) - ShelterBias; }
+
+	// World space XY of the corner of the grid, the size of a cell and the number of cells per side
+	FVector4 GetGridParameters() const;
+
+	TConstArrayView<float> GetHeights() const { return Heights; }
+	int32 GetResolution() const { return Resolution; }
+
+private:
+	FIntPoint MinCell { 0, 0 };
+	int32 Resolution { 0 };
+	float CellSize { 1.f };
+	float ShelterBias { 0.f };
+
+	// Row major, starting at MinCell
+	TArray<float> Heights;
+};
+
+/**
+ * Builds a precipitation occlusion grid around the camera from static geometry. Cells that scroll into the grid
+ * when the camera moves are traced nearest first, with a fixed number of traces per frame.
+ * The grid is published to C++ as snapshots and to Niagara as a height texture.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UPrecipitationOcclusionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Latest published grid. Safe to call from any thread.
+	TSharedRef<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> GetOcclusionGrid() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Precipitation Occlusion")
+	bool IsPointSheltered(FVector const& Position) const;
+
+	// Binds the occlusion height texture and grid parameters to the user parameters of a weather effect
+	void ApplyToNiagaraComponent(UNiagaraComponent* Component) const;
+
+	// Incremented every time a new grid is published
+	uint32 GetGridVersion() const { return GridVersion; }
+
+private:
+	void ResetGrid();
+	void QueueInvalidCells();
+	void QueueExposedCells(FIntPoint OldCenter);
+	// Returns true when an occluder was hit, until then the cell reads as unknown in the published grid
+	bool TraceCell(FIntPoint Cell);
+	void PublishGrid();
+	void UpdateHeightTexture(FPrecipitationOcclusionGrid const& Grid);
+	int32 GetSlotIndex(FIntPoint Cell) const;
+
+	int32 Resolution { 64 };
+	float CellSize { 200.f };
+
+	FIntPoint CenterCell { 0, 0 };
+	bool bHasCenter { false };
+	bool bIsDirty { false };
+
+	// Toroidal storage, a cell lives in the slot of its coordinates modulo the resolution
+	TArray<float> SlotHeights;
+	TArray<FIntPoint> SlotCells;
+	TArray<bool> SlotValid;
+
+	// Cells waiting to be traced, nearest to the camera last so they are popped first
+	TArray<FIntPoint> PendingCells;
+
+	// Reused when the camera steps into another cell
+	TArray<FIntPoint> ExposedCells;
+
+	mutable FRWLock GridLock;
+	TSharedRef<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> PublishedGrid { MakeShared<FPrecipitationOcclusionGrid, ESPMode::ThreadSafe>() };
+	uint32 GridVersion { 0 };
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTexture2D> HeightTexture;
+
+	FName HeightTextureParameterName { "OcclusionHeightTexture" };
+	FName GridParametersParameterName { "OcclusionGrid" };
+};
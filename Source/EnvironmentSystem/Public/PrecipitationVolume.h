@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PrecipitationVolume.generated.h"
+
+USTRUCT(BlueprintType)
+struct ENVIRONMENTSYSTEM_API FPrecipitationVolumeSettings
+{
+	GENERATED_BODY()
+
+	// Half size of the spawn volume across the ground while the camera stands still
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Precipitation", meta = (ClampMin=100))
+	float Radius { 2000.f };
+
+	// Half height of the spawn volume, centered on the camera unless the clouds cut it off
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Precipitation", meta = (ClampMin=100))
+	float HalfHeight { 1500.f };
+
+	// Seconds the volume leads the camera, about the time particles take to fall to the camera
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Precipitation", meta = (ClampMin=0))
+	float LeadTime { 1.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Precipitation", meta = (ClampMin=0))
+	float MaxLead { 6000.f };
+
+	// How far the volume stretches along the direction of travel at StretchSpeed, it narrows across by as much
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Precipitation", meta = (ClampMin=1, ClampMax=4))
+	float MaxStretch { 2.f };
+
+	// Camera speed in cm/s at which the volume is stretched the most
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Precipitation", meta = (ClampMin=1))
+	float StretchSpeed { 3000.f };
+};
+
+/**
+ * Spawn volume of the precipitation for a camera. The volume runs ahead of a moving camera and is stretched along its
+ * path without growing, and is cut off at the cloud base. The spawn rate follows the size of the volume, so the density
+ * of the precipitation and the number of particles stay the same however the camera moves.
+ */
+struct ENVIRONMENTSYSTEM_API FPrecipitationVolume
+{
+	// Center of the volume relative to the camera
+	FVector Offset { ForceInit };
+
+	// Half size along the direction of travel, across it and up
+	FVector Extent { ForceInit };
+
+	// Direction of travel in degrees around the up axis
+	float Yaw { 0.f };
+
+	// Share of the spawn rate of the full volume, 0 above the clouds
+	float SpawnScale { 1.f };
+
+	static FPrecipitationVolume Compute(FPrecipitationVolumeSettings const& Settings, FVector const& ViewLocation, FVector const& ViewVelocity, float CloudBaseHeight);
+};
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/DateTime.h"
+#include "SeasonCalendar.generated.h"
+
+class UWeatherDataAssetBase;
+
+USTRUCT(BlueprintType)
+struct ENVIRONMENTSYSTEM_API FSeasonWeatherChance
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season")
+	TSoftObjectPtr<UWeatherDataAssetBase> Preset;
+
+	// Relative to the other presets of the season
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season", meta = (ClampMin=0))
+	float Weight { 1.f };
+};
+
+// Values of a season apply fully in the middle of its days and blend into the neighbouring seasons
+USTRUCT(BlueprintType)
+struct ENVIRONMENTSYSTEM_API FSeasonDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season")
+	FName Name;
+
+	// Day of the year the season starts, 1 is January 1st. The season lasts until the next season starts.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season", meta = (ClampMin=1, ClampMax=366))
+	int32 StartDayOfYear { 1 };
+
+	// Hours between dawn and dusk, centered on noon
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season", meta = (ClampMin=0, ClampMax=24))
+	float DayLength { 12.f };
+
+	// Coldest temperature of a day in °C, reached shortly before dawn
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season")
+	float MinTemperature { 5.f };
+
+	// Warmest temperature of a day in °C, reached in the afternoon
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season")
+	float MaxTemperature { 15.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season")
+	TArray<FSeasonWeatherChance> Weather;
+
+	// Written to the weather parameter collection, for landscape and foliage materials
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season")
+	TMap<FName, float> ScalarParameters;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Season")
+	TMap<FName, FLinearColor> VectorParameters;
+};
+
+// One row of the seasonal tables
+struct FSeasonDay
+{
+	// Index into the season definitions, INDEX_NONE without seasons
+	int32 Season { INDEX_NONE };
+
+	float DawnTime { 6.f };
+	float DuskTime { 18.f };
+	float MinTemperature { 10.f };
+	float MaxTemperature { 10.f };
+};
+
+/**
+ * Seasonal values for every day of a year, precomputed from the season definitions. Looking up a day is an index into
+ * the tables, which only have to be rebuilt when the year changes.
+ */
+class ENVIRONMENTSYSTEM_API FSeasonCalendar
+{
+public:
+	void Build(TConstArrayView<FSeasonDefinition> Seasons, int32 InYear);
+
+	bool IsBuiltFor(int32 const InYear) const { return Year == InYear; }
+	bool HasSeasons() const { return NumSeasons > 0; }
+
+	// Row of the day of the year of Date. Dates of other years use the day with the same number.
+	FSeasonDay const& GetDay(FDateTime const& Date) const { return Days[GetDayIndex(Date)]; }
+	int32 GetSeason(FDateTime const& Date) const { return GetDay(Date).Season; }
+
+	// Temperature at the time of day of Date
+	float GetTemperature(FDateTime const& Date) const;
+
+	// Presets of all seasons, with their blended weight on the day of Date
+	TConstArrayView<TSoftObjectPtr<UWeatherDataAssetBase>> GetPresets() const { return Presets; }
+	TConstArrayView<float> GetPresetWeights(FDateTime const& Date) const { return MakeArrayView(PresetWeights).Slice(GetDayIndex(Date) * Presets.Num(), Presets.Num()); }
+
+	// Draws a preset by the weights of the day of Date, null without seasonal weather
+	TSoftObjectPtr<UWeatherDataAssetBase> PickPreset(FDateTime const& Date, FRandomStream& Random) const;
+
+	TConstArrayView<FName> GetScalarParameterNames() const { return ScalarNames; }
+	TConstArrayView<float> GetScalarParameters(FDateTime const& Date) const { return MakeArrayView(ScalarValues).Slice(GetDayIndex(Date) * ScalarNames.Num(), ScalarNames.Num()); }
+
+	TConstArrayView<FName> GetVectorParameterNames() const { return VectorNames; }
+	TConstArrayView<FLinearColor> GetVectorParameters(FDateTime const& Date) const { return MakeArrayView(VectorValues).Slice(GetDayIndex(Date) * VectorNames.Num(), VectorNames.Num()); }
+
+private:
+	int32 GetDayIndex(FDateTime const& Date) const { return FMath::Clamp(Date.GetDayOfYear() - 1, 0, Days.Num() - 1); }
+
+	int32 Year { INDEX_NONE };
+	int32 NumSeasons { 0 };
+
+	// One row per day of the year
+	TArray<FSeasonDay> Days { FSeasonDay() };
+
+	// One value per day and preset or parameter, the values of a day are contiguous
+	TArray<TSoftObjectPtr<UWeatherDataAssetBase>> Presets;
+	TArray<float> PresetWeights;
+
+	TArray<FName> ScalarNames;
+	TArray<float> ScalarValues;
+
+	TArray<FName> VectorNames;
+	TArray<FLinearColor> VectorValues;
+};
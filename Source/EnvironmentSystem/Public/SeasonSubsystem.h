@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SeasonSubsystem.generated.h"
+
+class ADynamicSkySystem;
+class UEnvironmentSubsystem;
+class UWorldTimeSubsystem;
+
+/**
+ * Applies the seasonal tables of the world time to the active sky. Once per day it moves dawn and dusk, writes the
+ * seasonal material parameters to the weather parameter collection and, if enabled, draws the weather of the day.
+ * Every other frame only compares the date.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API USeasonSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Index into UEnvironmentSystemSettings::Seasons, INDEX_NONE without seasons
+	UFUNCTION(BlueprintPure, Category = "Seasons")
+	int32 GetSeason() const;
+
+	UFUNCTION(BlueprintPure, Category = "Seasons")
+	FName GetSeasonName() const;
+
+	// Air temperature in °C at the current world time
+	UFUNCTION(BlueprintPure, Category = "Seasons")
+	float GetTemperature() const;
+
+private:
+	void HandleTimeAdvanced(FDateTime OldDate, FTimespan Elapsed);
+	void ApplyDay(ADynamicSkySystem* Sky, FDateTime const& Date, bool bPickWeather) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UEnvironmentSubsystem> Environment;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UWorldTimeSubsystem> WorldTime;
+
+	TWeakObjectPtr<ADynamicSkySystem> AppliedSky;
+	FDateTime AppliedDate { 0 };
+
+	// Set when time passed into a new day, restored saves jump to their day without drawing new weather
+	bool bDayPassed { false };
+};
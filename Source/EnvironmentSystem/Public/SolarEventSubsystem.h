@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SolarEventSubsystem.generated.h"
+
+class UEnvironmentSubsystem;
+class UWorldTimeSubsystem;
+
+// In the order they happen during a day
+UENUM(BlueprintType)
+enum class ESolarEvent : uint8
+{
+	Midnight,
+	// The sky turns to day, DawnTimeOffset before sunrise
+	CivilDawn,
+	Sunrise,
+	// The last hour of sunlight
+	GoldenHour,
+	Sunset,
+	// The sky turns to night, DuskTimeOffset after sunset
+	CivilDusk,
+};
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnSolarEventDelegate, ESolarEvent, FDateTime /* EventTime */);
+
+/**
+ * Solar events on the world time. The next event is computed ahead from the dawn and dusk of the day, from the seasons
+ * or the active sky, and only compared against when the world time advances. Every event passed by one step of the
+ * time is broadcast in order, with the time it happened at.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API USolarEventSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	FOnSolarEventDelegate OnSolarEvent {};
+
+	// Hour of an event on the day of Date
+	float GetEventHour(ESolarEvent Event, FDateTime const& Date) const;
+
+	// Next time the world time reaches an event
+	FDateTime GetNextEventTime(ESolarEvent Event) const;
+
+	// Real seconds until the world time reaches an event at the current tick rate, -1 while the time stands still
+	UFUNCTION(BlueprintPure, Category = "Solar Events")
+	float GetSecondsUntil(ESolarEvent Event) const;
+
+	// Computes the next event again, after dawn or dusk moved
+	void Reschedule();
+
+private:
+	void HandleTimeAdvanced(FDateTime OldDate, FTimespan Elapsed);
+
+	// Finds the first event after Time, or at Time but later in the day than AfterEvent
+	void ScheduleAfter(FDateTime Time, int32 AfterEvent = INDEX_NONE);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UEnvironmentSubsystem> Environment;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UWorldTimeSubsystem> WorldTime;
+
+	FDelegateHandle TimeAdvancedHandle;
+
+	ESolarEvent NextEvent { ESolarEvent::Midnight };
+	FDateTime NextEventTime { FDateTime::MaxValue() };
+
+	// World time the events were checked up to. The time moved without passing when it does not match the next step.
+	FDateTime CheckedTime { 0 };
+
+	// Last broadcast event, so rescheduling at the time it happened does not broadcast it again
+	int32 LastEvent { INDEX_NONE };
+	FDateTime LastEventTime { FDateTime::MinValue() };
+};
@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderCommandFence.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Misc/DateTime.h"
+#include "Misc/Timespan.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WeatherAccumulationSubsystem.generated.h"
+
+class FWeatherZoneIndex;
+class UMaterialInstanceDynamic;
+class UMaterialParameterCollection;
+class UTexture2D;
+class UWeatherDataAssetBase;
+
+/**
+ * Builds up and removes the surface layers of the weather, such as snow, wetness and puddles, over world time.
+ * Channels are declared in the project settings and presets set the level they build up to, so new layers need no code.
+ *
+ * The world is split into a coarse grid of tiles, each with its own weather from the weather zones. Within a step of
+ * world time the weather of a tile is constant, so every channel follows dv/dt = Gain - Loss * v - Melt and is advanced
+ * in closed form. Skipping a year costs as much as skipping a second.
+ *
+ * The tile values are published as a texture, with four channels per texel, and the values at the camera are packed
+ * four per vector into the weather parameter collection.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UWeatherAccumulationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void SetParameterCollection(UMaterialParameterCollection* Collection);
+
+	// The weather outside of all weather zones. Outside of game worlds the channels jump to where the weather leaves them.
+	void SetWeatherPreset(UWeatherDataAssetBase const* Preset);
+
+	// Selects the tile whose values are written to the parameter collection
+	void SetViewLocation(FVector const& Location);
+
+	// Advances all tiles by Elapsed of world time, starting at StartTime
+	void Advance(FDateTime StartTime, FTimespan Elapsed);
+
+	// Sets a channel on all tiles without transition, it then follows the weather again
+	UFUNCTION(BlueprintCallable, Category = "Weather Accumulation")
+	void SetChannelValue(FName Channel, float Value);
+
+	// Level of a channel at the camera, 0 for unknown channels
+	UFUNCTION(BlueprintCallable, Category = "Weather Accumulation")
+	float GetChannelValue(FName Channel) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Weather Accumulation")
+	float GetChannelValueAt(FName Channel, FVector const& Location) const;
+
+	// Binds the tile texture and grid parameters to a material such as the landscape
+	UFUNCTION(BlueprintCallable, Category = "Weather Accumulation")
+	void ApplyToMaterial(UMaterialInstanceDynamic* Material) const;
+
+	// Every channel and tile quantized to a byte, the tiles of a channel are contiguous
+	void SaveValues(TArray<FName>& OutChannels, TArray<uint8>& OutValues) const;
+
+	// Replaces the values of the saved channels without settling the weather. Tiles are matched by position when the
+	// grid resolution changed since the values were saved.
+	void LoadValues(TConstArrayView<FName> SavedChannels, TConstArrayView<uint8> SavedValues, int32 SavedResolution);
+
+	int32 FindChannel(FName Channel) const;
+	int32 GetResolution() const { return Resolution; }
+	int32 GetNumChannels() const { return NumChannels; }
+	int32 GetNumTiles() const { return Resolution * Resolution; }
+
+	// World space XY of the corner of the grid, the size of a tile and the number of tiles per side
+	FVector4 GetGridParameters() const;
+
+private:
+	int32 GetTileIndex(FVector const& Location) const;
+	float GetValue(int32 Channel, int32 Tile) const { return Values[Channel * GetNumTiles() + Tile]; }
+
+	// Samples the weather of every tile, which only changes with the global preset or the weather zones
+	void RefreshTileWeather();
+
+	// Advances every channel of every tile with constant weather, Sunlight is the share of full sunshine
+	void Integrate(float Hours, float Sunlight);
+
+	// Hours of dawn and dusk on the day of Date, from the seasons or the active sky
+	void GetDayBounds(FDateTime const& Date, float& OutDawnTime, float& OutDuskTime) const;
+
+	void WriteParameters(bool bForce);
+
+	// Changes of the values during a frame are uploaded to the texture once, at the end of the frame
+	void MarkTextureDirty();
+	void UpdateTexture();
+
+	void HandleTimeAdvanced(FDateTime OldDate, FTimespan Elapsed);
+	FDelegateHandle TimeAdvancedHandle;
+
+	void HandleWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	FDelegateHandle WorldPostActorTickHandle;
+
+	int32 Resolution { 32 };
+	float TileSize { 10000.f };
+	int32 NumChannels { 0 };
+
+	TMap<FName, int32> ChannelIndices;
+
+	// One entry per channel
+	TArray<float> DecayRates;
+	TArray<float> SunDecayRates;
+	TArray<float> MeltRates;
+	TArray<float> SunMeltRates;
+	TArray<FName> LegacyParameterNames;
+
+	// One entry per channel and tile, the tiles of a channel are contiguous
+	TArray<float> Values;
+	// Value and rate of the weather target, a rate of 0 when the weather does not drive the channel
+	TArray<float> TargetValues;
+	TArray<float> TargetRates;
+
+	// One entry per tile
+	TArray<float> SunExposures;
+	TArray<float> MeltTemperatures;
+
+	TWeakObjectPtr<UWeatherDataAssetBase const> GlobalPreset;
+	bool bHasWeather { false };
+	TSharedPtr<FWeatherZoneIndex const, ESPMode::ThreadSafe> SampledZoneIndex;
+
+	int32 ViewTile { 0 };
+
+	// One entry per four channels
+	TArray<FName> VectorParameterNames;
+	TArray<FLinearColor> WrittenVectors;
+
+	TArray<float> WrittenLegacyValues;
+	bool bWriteLegacyParameters { true };
+
+	UPROPERTY()
+	TObjectPtr<UMaterialParameterCollection> ParameterCollection;
+
+	// Four channels per texel, the tiles of the next four channels are stacked below
+	UPROPERTY(Transient)
+	TObjectPtr<UTexture2D> Texture;
+
+	bool bTextureDirty { false };
+
+	// Texels as last uploaded, compared against to find the rows that changed
+	TArray<FLinearColor> StagedTexels;
+
+	// Rows of the last upload, read by the render thread until UploadFence completes
+	TArray<FLinearColor> UploadTexels;
+	FRenderCommandFence UploadFence;
+
+	FName TextureParameterName { "AccumulationTexture" };
+	FName GridParametersParameterName { "AccumulationGrid" };
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "WeatherAmbienceComponent.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+class UWeatherDataAssetBase;
+
+/**
+ * Plays the ambience layers of the active weather preset on a fixed pool of audio components.
+ * Layers crossfade along the weather transition of the sky, layers shared by both presets keep playing, and voices
+ * that fade out are stopped and returned to the pool rather than destroyed.
+ */
+UCLASS(ClassGroup = (Environment), meta = (BlueprintSpawnableComponent))
+class ENVIRONMENTSYSTEM_API UWeatherAmbienceComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UWeatherAmbienceComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	void SetWeatherPreset(UWeatherDataAssetBase* Preset);
+
+	// Moves the crossfade to the last weather preset to Progress, from 0 to 1. Called by the sky while its weather
+	// transition plays.
+	void SetTransitionProgress(float Progress);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Maximum number of layers that can be heard at once, including layers that are fading out
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ambience", meta = (ClampMin=1, ClampMax=16))
+	int32 VoicePoolSize { 4 };
+
+	// Duration of the crossfade when the weather changes without a transition of the sky
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ambience", meta = (ClampMin=0))
+	float CrossfadeDuration { 10.f };
+
+	// How quickly the volume follows the listener moving in and out of shelter, in seconds
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Ambience", meta = (ClampMin=0))
+	float ShelterFadeDuration { .5f };
+
+private:
+	// State of the pooled audio component with the same index
+	struct FAmbienceVoice
+	{
+		float Volume { 0.f };
+		float StartVolume { 0.f };
+		float TargetVolume { 0.f };
+		float ShelteredVolume { 1.f };
+	};
+
+	void AssignLayers();
+	int32 FindVoiceForSound(USoundBase const* Sound) const;
+
+	// Share of the local listeners in the open, split screen players share the speakers
+	float GetListenerExposure() const;
+
+	TArray<FAmbienceVoice> Voices;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UAudioComponent>> VoiceComponents;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UWeatherDataAssetBase> CurrentPreset;
+
+	// 1 in the open, 0 under cover
+	float ShelterFactor { 1.f };
+
+	// Set by the sky once its transition plays, the crossfade runs on CrossfadeDuration otherwise
+	bool bFollowsTransition { false };
+	float TransitionProgress { 0.f };
+};
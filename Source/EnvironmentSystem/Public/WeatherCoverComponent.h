@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WeatherTypes.h"
+#include "Components/ActorComponent.h"
+#include "WeatherCoverComponent.generated.h"
+
+class UPrimitiveComponent;
+
+/**
+ * Wetness and snow cover of an actor, built up by the precipitation at the actor and lost again under shelter or in dry
+ * weather. The values are written to the custom primitive data of the primitives of the actor, so the materials need
+ * no instances of their own. Updates are batched by UWeatherCoverSubsystem, distant actors are updated less often.
+ */
+UCLASS(ClassGroup = (Environment), meta = (BlueprintSpawnableComponent))
+class ENVIRONMENTSYSTEM_API UWeatherCoverComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintPure, Category = "Weather Cover")
+	float GetWetness() const { return Wetness; }
+
+	UFUNCTION(BlueprintPure, Category = "Weather Cover")
+	float GetSnowCover() const { return SnowCover; }
+
+	// Sets the cover without transition, it then follows the weather again
+	UFUNCTION(BlueprintCallable, Category = "Weather Cover")
+	void SetCover(float InWetness, float InSnowCover);
+
+	// Gathers the primitives of the owner again, after meshes were added or removed
+	UFUNCTION(BlueprintCallable, Category = "Weather Cover")
+	void RefreshPrimitives();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Custom primitive data index of the wetness, the snow cover follows at the next index
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Cover", meta = (ClampMin=0))
+	int32 CustomPrimitiveDataIndex { 0 };
+
+	// Only primitives with this tag get the cover, all primitives of the owner when none
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Cover")
+	FName PrimitiveTag;
+
+	// Share of the remaining way to the rain intensity covered per second
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Cover", meta = (ClampMin=0))
+	float WettingRate { .1f };
+
+	// Share of the wetness lost per second while dry or sheltered
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Cover", meta = (ClampMin=0))
+	float DryingRate { .01f };
+
+	// Share of the remaining way to the snow intensity covered per second
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Cover", meta = (ClampMin=0))
+	float SnowingRate { .02f };
+
+	// Share of the snow cover lost per second while it does not snow, melting snow keeps the actor wet
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Cover", meta = (ClampMin=0))
+	float MeltingRate { .005f };
+
+private:
+	friend class UWeatherCoverSubsystem;
+
+	// Moves the cover towards the precipitation over Elapsed seconds, returns true when the written values changed
+	bool Advance(float Elapsed, EPrecipitationType PrecipitationType, float Intensity);
+
+	// Writes the cover to the custom primitive data of all primitives, returns the number of primitives written
+	int32 WriteCustomPrimitiveData();
+
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> Primitives;
+
+	// Time of the last update by the subsystem, in world seconds
+	double LastUpdateTime { 0. };
+
+	float Wetness { 0.f };
+	float SnowCover { 0.f };
+
+	// The custom primitive data is written in byte steps, smaller changes are left for later
+	uint8 WrittenWetness { 0 };
+	uint8 WrittenSnowCover { 0 };
+};
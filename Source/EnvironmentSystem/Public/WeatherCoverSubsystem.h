@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WeatherExposureSubsystem.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WeatherCoverSubsystem.generated.h"
+
+class UWeatherCoverComponent;
+
+/**
+ * Updates the weather cover components of a world in one batch per frame. Components near a view are updated every
+ * frame, distant ones at an interval that grows with the distance, and the exposure of all due components is queried
+ * at once. Only components whose cover changed by a visible step write their custom primitive data.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UWeatherCoverSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void Register(UWeatherCoverComponent* Component);
+	void Unregister(UWeatherCoverComponent* Component);
+
+private:
+	// Seconds between updates of a component at a distance to the nearest view
+	static float GetUpdateInterval(float Distance);
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UWeatherCoverComponent>> Components;
+
+	// Where the next frame starts looking for due components, so a full budget does not starve the end of the list
+	int32 NextComponent { 0 };
+
+	// Reused between frames
+	TArray<TObjectPtr<UWeatherCoverComponent>> DueComponents;
+	TArray<FVector> DuePositions;
+	FWeatherExposureBuffer Exposure;
+};
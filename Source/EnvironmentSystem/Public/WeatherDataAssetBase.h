@@ -9,6 +9,7 @@
 #include "WeatherDataAssetBase.generated.h"
 
 class UNiagaraSystem;
+class USoundBase;
 
 USTRUCT(Blueprintable)
 struct ENVIRONMENTSYSTEM_API FDirectionalLightSettings
@@ -26,6 +27,8 @@ struct ENVIRONMENTSYSTEM_API FDirectionalLightSettings
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=12000))
 	float Temperature { 6500.f };
+
+	bool operator==(FDirectionalLightSettings const& Other) const = default;
 };
 
 USTRUCT(Blueprintable)
@@ -35,6 +38,8 @@ struct ENVIRONMENTSYSTEM_API FSkylightSettings
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=50000))
 	float Intensity { 1.f };
+
+	bool operator==(FSkylightSettings const& Other) const = default;
 };
 
 USTRUCT(Blueprintable)
@@ -59,6 +64,8 @@ struct ENVIRONMENTSYSTEM_API FAtmosphereSettings
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=3))
 	float AerialPerspectiveViewDistance { 1.f };
+
+	bool operator==(FAtmosphereSettings const& Other) const = default;
 };
 
 USTRUCT(Blueprintable)
@@ -71,6 +78,8 @@ struct ENVIRONMENTSYSTEM_API FExponentialHeightfogSettings
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=10))
 	float ExtinctionScale  { .5f };
+
+	bool operator==(FExponentialHeightfogSettings const& Other) const = default;
 };
 
 // Determines the light and atmosphere parameters for a weather type.
@@ -90,6 +99,122 @@ struct ENVIRONMENTSYSTEM_API FWeatherConfiguration
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	FAtmosphereSettings AtmosphereSettings;
+
+	// Blends every setting linearly, used where two weather presets meet
+	static FWeatherConfiguration Lerp(FWeatherConfiguration const& A, FWeatherConfiguration const& B, float Alpha);
+
+	bool operator==(FWeatherConfiguration const& Other) const = default;
+};
+
+USTRUCT(Blueprintable)
+struct ENVIRONMENTSYSTEM_API FWeatherWindSettings
+{
+	GENERATED_BODY()
+
+	// Direction the wind blows towards in degrees around the up axis, 0 is along +X
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=360))
+	float Direction { 0.f };
+
+	// Average wind speed in meters per second
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=60))
+	float Speed { 5.f };
+
+	// How far gusts raise and lower the speed, as a share of the average speed
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=1))
+	float GustStrength { .3f };
+
+	// Gusts passing a point per minute
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=60))
+	float GustsPerMinute { 6.f };
+};
+
+USTRUCT(Blueprintable)
+struct ENVIRONMENTSYSTEM_API FLightningSettings
+{
+	GENERATED_BODY()
+
+	// Average number of strikes per minute, 0 disables lightning for the weather
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=120))
+	float StrikesPerMinute { 0.f };
+
+	// Strikes land between these distances from the listener
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0))
+	float MinStrikeDistance { 50000.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0))
+	float MaxStrikeDistance { 300000.f };
+
+	// How much the sky light is boosted at the peak of a flash, 1 doubles it
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=20))
+	float FlashStrength { 3.f };
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0.01, ClampMax=2))
+	float FlashDuration { .3f };
+};
+
+USTRUCT(Blueprintable)
+struct ENVIRONMENTSYSTEM_API FWeatherAmbienceLayer
+{
+	GENERATED_BODY()
+
+	// A looping sound, such as MS_Rain_1
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TObjectPtr<USoundBase> Sound;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=2))
+	float Volume { 1.f };
+
+	// Volume multiplier while the listener is under cover
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=1))
+	float ShelteredVolume { .4f };
+};
+
+// A surface layer such as snow, wetness or ash that builds up while a weather lasts and fades after it
+USTRUCT(Blueprintable)
+struct ENVIRONMENTSYSTEM_API FWeatherAccumulationChannel
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName Name;
+
+	// Share of the layer that drains or dries per hour of world time
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=100))
+	float DecayRate { .1f };
+
+	// Extra share that evaporates per hour in full sunshine
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=100))
+	float SunDecayRate { 0.f };
+
+	// Amount that melts per hour and degree Celsius above freezing, independent of how much there is
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=10))
+	float MeltRate { 0.f };
+
+	// Amount that melts per hour in full sunshine, even below freezing
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=10))
+	float SunMeltRate { 0.f };
+
+	// Scalar of the weather parameter collection that also receives the value, for materials that predate the packed vectors
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName LegacyScalarParameterName;
+};
+
+// The level an accumulation channel builds up to while a weather is active
+USTRUCT(Blueprintable)
+struct ENVIRONMENTSYSTEM_API FWeatherAccumulationTarget
+{
+	GENERATED_BODY()
+
+	// One of the accumulation channels in the project settings
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	FName Channel;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=1))
+	float Value { 1.f };
+
+	// How fast the channel moves towards the value, as the share of the remaining difference per hour of world time
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=100))
+	float Rate { 1.f };
 };
 
 USTRUCT(Blueprintable)
@@ -105,6 +230,10 @@ struct ENVIRONMENTSYSTEM_API FWeatherEffectDefinition
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects", meta = (EditCondition="WeatherEffects != nullptr"))
 	TMap<FName, FVector> WeatherEffectsVectorParameters;
+
+	// Float parameters that scale with the weather effect density, in addition to the density parameters of the project settings
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects", meta = (EditCondition="WeatherEffects != nullptr"))
+	TArray<FName> DensityParameters;
 };
 
 /**
@@ -117,14 +246,41 @@ class ENVIRONMENTSYSTEM_API UWeatherDataAssetBase : public UPrimaryDataAsset
 
 public:
 	virtual FPrimaryAssetId GetPrimaryAssetId() const override { return FPrimaryAssetId("AssetItems", GetFName()); }
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void PostLoad() override;
 
+	// Precipitation reported to gameplay. Surface effects are driven by Accumulation instead.
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	EWeatherTypes WeatherType { EWeatherTypes::Sunny };
 
+	// How hard it rains or snows in this weather, as reported to gameplay through weather exposure queries
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin=0, ClampMax=1, EditCondition="WeatherType != EWeatherTypes::Sunny"))
+	float PrecipitationIntensity { 1.f };
+
+	EPrecipitationType GetPrecipitationType() const
+	{
+		switch(WeatherType)
+		{
+		case EWeatherTypes::Snowy:
+			return EPrecipitationType::Snow;
+		case EWeatherTypes::Rainy:
+			return EPrecipitationType::Rain;
+		default:
+			return EPrecipitationType::None;
+		}
+	}
+
 	// Some weathers with a lot of fog may not need the clouds turned on. This flags disables all clouds.
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	bool bShouldHideClouds { false };
 
+	// Replaces the cloud mode of the sky while this weather is active
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (InlineEditConditionToggle))
+	bool bOverrideCloudMode { false };
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition="bOverrideCloudMode"))
+	ECloudTypes CloudMode { ECloudTypes::Texture2D };
+
 	// Light and atmosphere settings for daytime for this weather. Note that directional light here refers to the sun.
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Environment")
 	FWeatherConfiguration DayTimeConfiguration;
@@ -141,14 +297,36 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Environment|Sky")
 	bool bShouldShowMoon { true };
 
+	// Shared by precipitation, clouds and foliage through the wind subsystem
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Environment|Wind")
+	FWeatherWindSettings Wind;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Effects|Niagara")
 	TArray<FWeatherEffectDefinition> WeatherEffects;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Effects|Lightning")
+	FLightningSettings LightningSettings;
+
+	// Looping sounds that play while this weather is active
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Effects|Audio")
+	TArray<FWeatherAmbienceLayer> AmbienceLayers;
+
+	// Air temperature in degrees Celsius, snow melts above freezing
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects|Material", meta = (ClampMin=-50, ClampMax=50))
+	float Temperature { 10.f };
+
+	// Surface layers this weather builds up, channels that are not listed decay
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects|Material")
+	TArray<FWeatherAccumulationTarget> Accumulation;
 	
 	// Set to true to enable rain puddles in the landscape material
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects|Material")
-	bool bShouldShowRainPuddles;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects|Material", meta = (DeprecatedProperty, DeprecationMessage="Add a Puddles channel to Accumulation instead"))
+	bool bShouldShowRainPuddles { false };
 
 	// Set to true to enable ripple effects in the landscape material - does nothing if bShouldShowRainPuddles == false
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects|Material")
-	bool bShouldShowRainPuddleRipples;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Effects|Material", meta = (DeprecatedProperty, DeprecationMessage="Add a Ripples channel to Accumulation instead"))
+	bool bShouldShowRainPuddleRipples { false };
+
+	// True when the weather spawns effects or builds up any surface layer
+	bool HasWeatherEffects() const;
 };
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WeatherEffectDensitySubsystem.generated.h"
+
+class UNiagaraComponent;
+struct FWeatherEffectDefinition;
+
+/**
+ * Density of the weather effects. Combines the es.Weather.Density console variable, the density of the current effects
+ * quality level and a governor that thins out the effects while the effects or the GPU are over budget.
+ * Effects follow it through their density parameters, which are scaled without restarting the effects.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UWeatherEffectDensitySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	UFUNCTION(BlueprintPure, Category = "Weather Effects")
+	float GetDensity() const { return Density; }
+
+	// Share of the density the governor currently allows, 1 while within budget
+	UFUNCTION(BlueprintPure, Category = "Weather Effects")
+	float GetGovernorScale() const { return GovernorScale; }
+
+	// Incremented every time the density changes
+	uint32 GetDensityVersion() const { return DensityVersion; }
+
+	// Sets the density parameters of an effect to their preset or default value scaled by the density and Scale
+	void ApplyToNiagaraComponent(UNiagaraComponent* Component, FWeatherEffectDefinition const& Effect, float Scale = 1.f) const;
+
+private:
+	void UpdateGovernor(float DeltaTime);
+
+	float Density { 1.f };
+	float GovernorScale { 1.f };
+
+	// Highest of the effects and GPU time over their budgets, smoothed over a few frames
+	float Load { 0.f };
+
+	uint32 DensityVersion { 1 };
+};
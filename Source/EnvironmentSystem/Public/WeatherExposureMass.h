@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "MassEntityTypes.h"
+#include "MassProcessor.h"
+#include "WeatherTypes.h"
+#include "WeatherExposureMass.generated.h"
+
+// Weather exposure of a Mass entity, updated in bulk by UWeatherExposureProcessor
+USTRUCT()
+struct ENVIRONMENTSYSTEM_API FWeatherExposureFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	// 0 when dry, 1 when soaked
+	UPROPERTY()
+	float Wetness { 0.f };
+
+	// 0 when free of snow, 1 when fully covered
+	UPROPERTY()
+	float SnowCover { 0.f };
+
+	UPROPERTY()
+	float PrecipitationIntensity { 0.f };
+
+	UPROPERTY()
+	EPrecipitationType PrecipitationType { EPrecipitationType::None };
+
+	UPROPERTY()
+	bool bSheltered { false };
+};
+
+/**
+ * Adds weather exposure to entities built from a Mass entity config.
+ */
+UCLASS(meta = (DisplayName = "Weather Exposure"))
+class ENVIRONMENTSYSTEM_API UWeatherExposureTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+};
+
+/**
+ * Updates the weather exposure of all entities with a transform, and lets wetness and snow cover build up and fade over time.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UWeatherExposureProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UWeatherExposureProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	// Wetness gained per second at full rain intensity
+	UPROPERTY(EditAnywhere, Config, Category = "Weather Exposure", meta = (ClampMin=0))
+	float WettingRate { .1f };
+
+	// Wetness lost per second when not exposed to rain
+	UPROPERTY(EditAnywhere, Config, Category = "Weather Exposure", meta = (ClampMin=0))
+	float DryingRate { .01f };
+
+	// Snow cover gained per second at full snow intensity
+	UPROPERTY(EditAnywhere, Config, Category = "Weather Exposure", meta = (ClampMin=0))
+	float SnowAccumulationRate { .05f };
+
+	// Snow cover lost per second when not exposed to snow
+	UPROPERTY(EditAnywhere, Config, Category = "Weather Exposure", meta = (ClampMin=0))
+	float SnowMeltRate { .02f };
+
+private:
+	FMassEntityQuery EntityQuery;
+};
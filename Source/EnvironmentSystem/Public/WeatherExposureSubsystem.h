@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "WeatherTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WeatherExposureSubsystem.generated.h"
+
+class FPrecipitationOcclusionGrid;
+class FWeatherZoneIndex;
+class UPrecipitationOcclusionSubsystem;
+class UWeatherDataAssetBase;
+class UWeatherZoneSubsystem;
+
+/**
+ * Per position weather exposure, stored as one array per value so that callers only touch what they read.
+ */
+struct ENVIRONMENTSYSTEM_API FWeatherExposureBuffer
+{
+	TArray<EPrecipitationType> PrecipitationType;
+
+	// 0 when dry, 1 for the heaviest precipitation
+	TArray<float> Intensity;
+
+	// True when something blocks the sky above the position, the intensity is 0 in that case
+	TArray<bool> bSheltered;
+
+	void SetNum(int32 NewNum);
+	int32 Num() const { return Intensity.Num(); }
+};
+
+/**
+ * Snapshot of everything needed to answer exposure queries. It does not reference the world, so it can be
+ * evaluated on any thread and stays consistent even if the weather changes while it is in use.
+ */
+class ENVIRONMENTSYSTEM_API FWeatherExposureQuery
+{
+public:
+	FWeatherExposureQuery(
+		TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> InZoneIndex,
+		TSharedPtr<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> InOcclusionGrid,
+		UWeatherDataAssetBase const* InGlobalPreset,
+		float InPrecipitationScale);
+
+	// Writes the exposure of Positions to OutExposure, starting at OutOffset
+	void Evaluate(TConstArrayView<FVector> Positions, FWeatherExposureBuffer& OutExposure, int32 OutOffset = 0) const;
+
+	// Writes the exposure of Positions to arrays of at least as many elements
+	void Evaluate(TConstArrayView<FVector> Positions, EPrecipitationType* Types, float* Intensities, bool* Sheltered) const;
+
+private:
+	void EvaluateZones(TConstArrayView<FVector> Positions, EPrecipitationType* Types, float* Intensities) const;
+
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> ZoneIndex;
+	TSharedPtr<FPrecipitationOcclusionGrid const, ESPMode::ThreadSafe> OcclusionGrid;
+	UWeatherDataAssetBase const* GlobalPreset;
+	float PrecipitationScale;
+};
+
+/**
+ * Answers "is it raining or snowing here, and how hard" for large numbers of positions.
+ * The sky reports the global weather, weather zones are taken from UWeatherZoneSubsystem.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UWeatherExposureSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	void SetGlobalWeather(UWeatherDataAssetBase* Preset);
+
+	// Scales all precipitation, used to fade in the weather during transitions
+	void SetPrecipitationScale(float Scale);
+
+	// Captures the current weather for evaluation on any thread. Safe to call from any thread.
+	FWeatherExposureQuery MakeQuery() const;
+
+	// Evaluates all positions, spread over worker threads when there are many of them
+	void QueryExposure(TConstArrayView<FVector> Positions, FWeatherExposureBuffer& OutExposure) const;
+
+	// False while no position can have precipitation, neither from the global weather nor from a weather zone
+	bool CanHavePrecipitation() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Weather Exposure")
+	void QueryExposureAt(FVector const& Position, EPrecipitationType& OutPrecipitationType, float& OutIntensity, bool& bOutSheltered) const;
+
+private:
+	UPROPERTY()
+	TObjectPtr<UWeatherZoneSubsystem> ZoneSubsystem;
+
+	// Not created in worlds without a camera, positions are never sheltered there
+	UPROPERTY()
+	TObjectPtr<UPrecipitationOcclusionSubsystem> OcclusionSubsystem;
+
+	mutable FRWLock WeatherLock;
+
+	UPROPERTY()
+	TObjectPtr<UWeatherDataAssetBase> GlobalPreset;
+
+	float PrecipitationScale { 1.f };
+};
@@ -11,4 +11,20 @@ enum class EWeatherTypes
 
 	// Weather types that need rain on the landscape should use this
 	Rainy
+};
+
+UENUM(BlueprintType)
+enum class EPrecipitationType : uint8
+{
+	None,
+	Rain,
+	Snow
+};
+
+UENUM()
+enum class ECloudTypes
+{
+	None = 0,
+	Texture2D,
+	Volumetric
 };
\ No newline at end of file
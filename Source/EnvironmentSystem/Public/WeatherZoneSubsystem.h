@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WeatherZoneSubsystem.generated.h"
+
+class AWeatherZoneVolume;
+class UWeatherDataAssetBase;
+
+USTRUCT(BlueprintType)
+struct ENVIRONMENTSYSTEM_API FWeatherZoneSample
+{
+	GENERATED_BODY()
+
+	// Preset of the highest priority zone containing the point, null if the point is outside all zones
+	UPROPERTY(BlueprintReadOnly, Category = "Weather Zones")
+	TObjectPtr<UWeatherDataAssetBase> Preset;
+
+	// Preset to blend from at the border of the zone, null means the global preset of the sky
+	UPROPERTY(BlueprintReadOnly, Category = "Weather Zones")
+	TObjectPtr<UWeatherDataAssetBase> FallbackPreset;
+
+	// 0 at the border of the zone, 1 once the point is BlendDistance inside it
+	UPROPERTY(BlueprintReadOnly, Category = "Weather Zones")
+	float BlendWeight { 0.f };
+
+	// The preset that dominates at the sampled point, or null when the global preset does
+	UWeatherDataAssetBase* GetDominantPreset() const { return BlendWeight >= .5f ? Preset : FallbackPreset; }
+
+	bool operator==(FWeatherZoneSample const& Other) const = default;
+};
+
+/**
+ * Immutable uniform grid over the weather zones of a world. The zone lists of each cell are stored contiguously and
+ * sorted by priority, so a point query touches one cell and stops at the first zone it is fully inside.
+ * An index is never modified after it is built, which makes it safe to query from any thread.
+ */
+class ENVIRONMENTSYSTEM_API FWeatherZoneIndex
+{
+public:
+	FWeatherZoneIndex() = default;
+	FWeatherZoneIndex(TConstArrayView<AWeatherZoneVolume const*> Volumes, double CellSize);
+
+	bool IsEmpty() const { return Zones.IsEmpty(); }
+	FBox const& GetBounds() const { return Bounds; }
+
+	FWeatherZoneSample Query(FVector const& Position) const;
+	void Query(TConstArrayView<FVector> Positions, TArrayView<FWeatherZoneSample> OutSamples) const;
+
+private:
+	struct FZone
+	{
+		FVector Min;
+		FVector Max;
+		double InvBlendDistance;
+		// Kept alive by the zone subsystem for as long as the index is held anywhere
+		UWeatherDataAssetBase* Preset;
+	};
+
+	TArray<FZone> Zones;
+
+	// Cell i owns CellZones[CellStarts[i] .. CellStarts[i + 1])
+	TArray<int32> CellStarts;
+	TArray<int32> CellZones;
+
+	FBox Bounds { ForceInit };
+	FVector2D GridOrigin { 0. };
+	double InvCellSize { 0. };
+	int32 GridSizeX { 0 };
+	int32 GridSizeY { 0 };
+};
+
+/**
+ * Keeps track of all weather zones in the world and answers which weather applies at a position.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UWeatherZoneSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+	void RegisterZone(AWeatherZoneVolume* Zone);
+	void UnregisterZone(AWeatherZoneVolume* Zone);
+
+	// Rebuilds the spatial index. Must be called after moving a zone or changing its settings at runtime.
+	UFUNCTION(BlueprintCallable, Category = "Weather Zones")
+	void RefreshZones();
+
+	bool HasZones() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Weather Zones")
+	FWeatherZoneSample QueryWeatherAt(FVector const& Position) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Weather Zones")
+	void BatchQueryWeather(TArray<FVector> const& Positions, TArray<FWeatherZoneSample>& OutSamples) const;
+
+	// Returns the current index, which stays valid and unchanged even if zones are refreshed. Safe to call from any thread.
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> GetZoneIndex() const;
+
+private:
+	void MarkZonesDirty();
+	void RefreshDirtyZones();
+
+	TArray<TWeakObjectPtr<AWeatherZoneVolume>> RegisteredZones;
+
+	// Set when zones registered or left since the index was built, only touched on the game thread
+	bool bZonesDirty { false };
+
+	// Presets of an index, kept alive until the subsystem holds the last reference to the index
+	struct FIndexedPresets
+	{
+		TSharedPtr<FWeatherZoneIndex const, ESPMode::ThreadSafe> Index;
+		TArray<TObjectPtr<UWeatherDataAssetBase>> Presets;
+	};
+
+	// The current index and the replaced ones that worker threads may still query
+	TArray<FIndexedPresets> IndexedPresets;
+
+	// Guards swapping ZoneIndex against readers on worker threads
+	mutable FRWLock ZoneIndexLock;
+
+	TSharedRef<FWeatherZoneIndex const, ESPMode::ThreadSafe> ZoneIndex { MakeShared<FWeatherZoneIndex, ESPMode::ThreadSafe>() };
+};
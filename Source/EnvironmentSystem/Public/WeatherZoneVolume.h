@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WeatherZoneVolume.generated.h"
+
+class UBoxComponent;
+class UWeatherDataAssetBase;
+
+/**
+ * An axis aligned region of the world with its own weather preset. Overlapping zones are resolved by priority,
+ * and the preset fades in over BlendDistance from the border of the zone.
+ * Zones are indexed when they begin play, call UWeatherZoneSubsystem::RefreshZones after moving one at runtime.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API AWeatherZoneVolume : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AWeatherZoneVolume();
+
+	// World space bounds of the zone. Rotation is not taken into account, the zone always covers the axis aligned box.
+	FBox GetZoneBounds() const;
+
+	UWeatherDataAssetBase* GetWeatherPreset() const { return WeatherPreset; }
+	int32 GetPriority() const { return Priority; }
+	float GetBlendDistance() const { return BlendDistance; }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TObjectPtr<UBoxComponent> ZoneBox;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Zone")
+	TObjectPtr<UWeatherDataAssetBase> WeatherPreset;
+
+	// When zones overlap, the zone with the highest priority wins
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Zone")
+	int32 Priority { 0 };
+
+	// Distance from the border of the zone over which the preset blends in
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Weather Zone", meta = (ClampMin=0))
+	float BlendDistance { 2000.f };
+};
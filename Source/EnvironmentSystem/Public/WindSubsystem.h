@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WindSubsystem.generated.h"
+
+class UEnvironmentSubsystem;
+class UNiagaraComponent;
+
+/**
+ * Wind of a world for one frame, the base wind of the weather plus gusts that travel with it.
+ * A snapshot is never modified after it is published, which makes it safe to query from any thread.
+ */
+class ENVIRONMENTSYSTEM_API FWindField
+{
+public:
+	FWindField() = default;
+	FWindField(FVector2D InBaseVelocity, float InGustStrength, float InGustLength, float InGustPhase);
+
+	// Wind velocity in cm/s at a position
+	FVector Sample(FVector const& Position) const;
+
+	// Velocity without gusts in cm/s
+	FVector GetBaseVelocity() const { return FVector(Direction * Speed, 0.); }
+	float GetBaseSpeed() const { return Speed; }
+
+	// Gust strength, the distance between gusts in cm and the phase of the gusts, for materials and effects that
+	// evaluate the gusts themselves
+	FLinearColor GetGustParameters() const { return FLinearColor(GustStrength, GustLength, GustPhase, 0.f); }
+
+private:
+	FVector2D Direction { 1., 0. };
+	float Speed { 0.f };
+	float GustStrength { 0.f };
+	float GustLength { 1.f };
+	float GustPhase { 0.f };
+};
+
+/**
+ * The one wind field of a world. The wind of the weather at the camera is blended in over time, so weather changes
+ * turn and build up the wind instead of switching it. Evaluated once per frame and published to C++ as snapshots,
+ * to materials through the weather parameter collection and to Niagara as user parameters.
+ */
+UCLASS()
+class ENVIRONMENTSYSTEM_API UWindSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Latest published wind. Safe to call from any thread.
+	TSharedRef<FWindField const, ESPMode::ThreadSafe> GetWindField() const;
+
+	// Wind velocity in cm/s at a position
+	UFUNCTION(BlueprintPure, Category = "Wind")
+	FVector GetWindAt(FVector const& Position) const;
+
+	// Wind speed in cm/s without gusts
+	UFUNCTION(BlueprintPure, Category = "Wind")
+	float GetBaseWindSpeed() const { return GetWindField()->GetBaseSpeed(); }
+
+	// Sets the wind at the camera of a view and the gust parameters on the user parameters of a weather effect
+	void ApplyToNiagaraComponent(UNiagaraComponent* Component, FVector const& CameraLocation) const;
+
+private:
+	void WriteParameters(FWindField const& Field) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UEnvironmentSubsystem> Environment;
+
+	// Blended towards the wind of the weather, in cm/s
+	FVector2D Velocity { 500., 0. };
+	float GustStrength { .3f };
+	float GustsPerMinute { 6.f };
+
+	// Perlin noise repeats every 256 units, so the phase wraps there without a seam
+	float GustPhase { 0.f };
+
+	FVector ViewLocation { FVector::ZeroVector };
+
+	mutable FRWLock FieldLock;
+	TSharedRef<FWindField const, ESPMode::ThreadSafe> PublishedField { MakeShared<FWindField, ESPMode::ThreadSafe>() };
+
+	FName WindParameterName { "Wind" };
+	FName GustParameterName { "WindGust" };
+	FName NiagaraVelocityParameterName { "WindVelocity" };
+};
@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "Misc/DateTime.h"
 #include "Misc/Timespan.h"
+#include "SeasonCalendar.h"
 #include "Subsystems/WorldSubsystem.h" 
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "WorldTimeSubsystem.generated.h"
@@ -12,6 +13,8 @@
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnHourChangedDelegate, FDateTime);
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnDayChangedDelegate, FDateTime);
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnWeekChangedDelegate, FDateTime);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnWorldTimeAdvancedDelegate, FDateTime /* OldDate */, FTimespan /* Elapsed */);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnSeasonChangedDelegate, FDateTime, int32 /* Season */);
 
 /**
  * Manages the passage of (date and) time in the world.
@@ -27,11 +30,38 @@ class ENVIRONMENTSYSTEM_API UWorldTimeSubsystem : public UTickableWorldSubsystem
 	//virtual void OnWorldBeginPlay(UWorld& InWorld);
 	
 	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
 	void HandleNotifications(FDateTime OldDate) const;
+	void NotifySeasonChange(FDateTime OldDate) const;
 
 	FOnHourChangedDelegate OnHourChanged {};
 	FOnDayChangedDelegate OnDayChanged {};
 	FOnWeekChangedDelegate OnWeekChanged {};
+
+public:
+	FDateTime GetWorldDateTime() const { return WorldDateTime; }
+
+	// Moving the time forward counts as time passing, so simulations catch up on the skipped time
+	void SetWorldDateTime(FDateTime NewDateTime);
+
+	// Jumps to a time without any time passing, used to restore a saved game
+	void RestoreWorldDateTime(FDateTime NewDateTime);
+
+	FTimespan GetTickRate() const { return TickRate; }
+	void SetTickRate(FTimespan const NewTickRate) { TickRate = NewTickRate; }
+
+	// Real seconds between two steps of the simulation
+	float GetRealWorldTickFrequency() const { return RealWorldTickFrequency; }
+
+	// Broadcast every time the world time moves forward
+	FOnWorldTimeAdvancedDelegate OnTimeAdvanced {};
+
+	// Seasonal tables of the current year, see UEnvironmentSystemSettings::Seasons
+	FSeasonCalendar const& GetSeasonCalendar() const { return SeasonCalendar; }
+	FSeasonDay const& GetSeasonDay() const { return SeasonCalendar.GetDay(WorldDateTime); }
+
+	// Broadcast with the index of the new season when the time moves into another season
+	FOnSeasonChangedDelegate OnSeasonChanged {};
 	
 private:
 	/** How much to advance the time simulation each tick */
@@ -41,5 +71,9 @@ private:
 	float RealWorldTickFrequency { 1.f };
 	float TickAccumulator { 0.f };
 
+	// Rebuilt when the time moves into another year
+	FSeasonCalendar SeasonCalendar;
+
 	void TickInternal(float DeltaTime);
+	void UpdateSeasonCalendar();
 };